@@ -0,0 +1,78 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QDebug>
+#include "database/database.h"
+#include "utils/datagenerator.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+long peakRssKb()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption entriesOption("entries", "Number of time entries to back up.", "count", "100000");
+    parser.addOption(entriesOption);
+    parser.process(app);
+    const int entries = parser.value(entriesOption).toInt();
+
+    QTemporaryDir dir;
+    Database *database = Database::instance();
+    if (!database->initialize(dir.filePath("bench.db"))) {
+        return 1;
+    }
+    QSqlDatabase db = database->database();
+    if (!DataGenerator::generate(db, entries, DataGenerator::DEFAULT_SEED, {}, nullptr)) {
+        return 1;
+    }
+
+    const long rssBefore = peakRssKb();
+    const QString backupPath = dir.filePath("backup.json");
+    QElapsedTimer timer;
+    timer.start();
+    if (!database->backupToJson(backupPath)) {
+        return 1;
+    }
+    const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+    const double megabytes = QFileInfo(backupPath).size() / (1024.0 * 1024.0);
+    qInfo().noquote() << QString("backupToJson: %1 entries, %2 MB in %3 ms -> %4 MB/s")
+                         .arg(entries)
+                         .arg(megabytes, 0, 'f', 1)
+                         .arg(elapsedMs)
+                         .arg(megabytes * 1000.0 / elapsedMs, 0, 'f', 1);
+    qInfo().noquote() << QString("peak RSS: %1 KB before backup, %2 KB after").arg(rssBefore).arg(peakRssKb());
+
+    timer.restart();
+    if (!database->restoreFromJson(backupPath)) {
+        return 1;
+    }
+    const qint64 restoreMs = qMax<qint64>(1, timer.elapsed());
+    qInfo().noquote() << QString("restoreFromJson: %1 entries in %2 ms -> %3 rows/s")
+                         .arg(entries)
+                         .arg(restoreMs)
+                         .arg(qint64(entries) * 1000 / restoreMs);
+    qInfo().noquote() << QString("peak RSS after restore: %1 KB").arg(peakRssKb());
+    return 0;
+}
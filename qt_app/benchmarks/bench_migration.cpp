@@ -0,0 +1,116 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QTemporaryDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include "database/database.h"
+
+namespace {
+
+// Schema as written by the first release, before any migration ran
+bool createVersion1Database(const QString &path, int entries)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench_v1");
+    db.setDatabaseName(path);
+    if (!db.open()) {
+        qCritical() << db.lastError().text();
+        return false;
+    }
+
+    bool ok = true;
+    {
+        QSqlQuery query(db);
+        const QStringList schema = {
+            "CREATE TABLE db_version (version INTEGER PRIMARY KEY)",
+            "INSERT INTO db_version (version) VALUES (1)",
+            "CREATE TABLE projects (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE, description TEXT, "
+            "color TEXT DEFAULT '#3498db', hourly_rate REAL DEFAULT 0, currency TEXT DEFAULT 'USD', "
+            "created_at TEXT DEFAULT CURRENT_TIMESTAMP, updated_at TEXT DEFAULT CURRENT_TIMESTAMP)",
+            "CREATE TABLE time_entries (id INTEGER PRIMARY KEY AUTOINCREMENT, project_id INTEGER NOT NULL, description TEXT, "
+            "start_time TEXT NOT NULL, end_time TEXT NOT NULL, duration INTEGER NOT NULL, "
+            "created_at TEXT DEFAULT CURRENT_TIMESTAMP, updated_at TEXT DEFAULT CURRENT_TIMESTAMP, "
+            "FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE)"
+        };
+        for (const QString &sql : schema) {
+            if (!query.exec(sql)) {
+                qCritical() << query.lastError().text();
+                ok = false;
+            }
+        }
+
+        db.transaction();
+        for (int p = 1; ok && p <= 50; ++p) {
+            ok = query.exec(QString("INSERT INTO projects (id, name) VALUES (%1, 'Project %1')").arg(p));
+        }
+
+        query.prepare("INSERT INTO time_entries (project_id, description, start_time, end_time, duration) VALUES (?, ?, ?, ?, ?)");
+        QDateTime start(QDate(2015, 1, 1), QTime(8, 0));
+        for (int i = 0; ok && i < entries; ++i) {
+            query.addBindValue(1 + i % 50);
+            query.addBindValue(QString("Entry %1").arg(i));
+            query.addBindValue(start.toString(Qt::ISODate));
+            query.addBindValue(start.addSecs(1800).toString(Qt::ISODate));
+            query.addBindValue(30);
+            ok = query.exec();
+            start = start.addSecs(2 * 3600);
+        }
+        ok = ok && db.commit();
+    }
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("bench_v1");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption entriesOption("entries", "Number of time entries in the v1 database.", "count", "1000000");
+    parser.addOption(entriesOption);
+    parser.process(app);
+    const int entries = parser.value(entriesOption).toInt();
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath("v1.db");
+    QElapsedTimer timer;
+    timer.start();
+    if (!createVersion1Database(path, entries)) {
+        return 1;
+    }
+    qInfo().noquote() << QString("created v1 database with %1 entries in %2 ms").arg(entries).arg(timer.elapsed());
+
+    Database *database = Database::instance();
+    QElapsedTimer stepTimer;
+    int currentStep = 0;
+    QObject::connect(database, &Database::migrationProgress, [&](int step, qint64 rowsDone, qint64 rowsTotal) {
+        if (step != currentStep) {
+            if (currentStep > 0) {
+                qInfo().noquote() << QString("  v%1: %2 ms").arg(currentStep).arg(stepTimer.elapsed());
+            }
+            currentStep = step;
+            stepTimer.restart();
+        } else if (rowsTotal > 0 && rowsDone == rowsTotal) {
+            qInfo().noquote() << QString("  v%1: %2 rows rewritten").arg(step).arg(rowsDone);
+        }
+    });
+
+    timer.restart();
+    stepTimer.start();
+    if (!database->initialize(path)) {
+        return 1;
+    }
+    if (currentStep > 0) {
+        qInfo().noquote() << QString("  v%1: %2 ms").arg(currentStep).arg(stepTimer.elapsed());
+    }
+    qInfo().noquote() << QString("migrated v1 -> v%1 in %2 ms").arg(database->currentVersion()).arg(timer.elapsed());
+    return 0;
+}
@@ -4,7 +4,10 @@
 #include <QObject>
 #include <QBluetoothDeviceDiscoveryAgent>
 #include <QBluetoothDeviceInfo>
+#include <QUuid>
 #include <QVariantList>
+#include <QHash>
+#include <QSet>
 #include <QTimer>
 
 class BleManager : public QObject
@@ -23,6 +26,8 @@ public:
     Q_INVOKABLE void startScan();
     Q_INVOKABLE void stopScan();
     Q_INVOKABLE QVariantList getDiscoveredDevices();
+    // The monitored-device registry lives in ble_devices. It is read once at
+    // construction and written through, so lookups never touch SQLite.
     Q_INVOKABLE bool addMonitoredDevice(const QString &name, const QString &address, const QString &deviceType);
     Q_INVOKABLE bool removeMonitoredDevice(int deviceId);
     Q_INVOKABLE QVariantList getMonitoredDevices();
@@ -31,9 +36,12 @@ public:
 signals:
     void scanningChanged();
     void bluetoothAvailableChanged();
+    // Once per device per scan
     void deviceDiscovered(const QVariantMap &device);
+    // Once per scan, and only for monitored devices
     void deviceDetected(const QString &address);
     void deviceLost(const QString &address);
+    void monitoredDevicesChanged();
     void scanFinished();
     void error(const QString &message);
 
@@ -46,9 +54,20 @@ private:
     QBluetoothDeviceDiscoveryAgent *m_deviceDiscoveryAgent;
     bool m_scanning;
     bool m_bluetoothAvailable;
-    QList<QBluetoothDeviceInfo> m_discoveredDevices;
+    // Keyed by the 48-bit MAC; cleared when a scan starts
+    QHash<quint64, QBluetoothDeviceInfo> m_discoveredDevices;
+    // Devices reported without an address (Apple platforms), by device UUID
+    QHash<QUuid, QBluetoothDeviceInfo> m_discoveredByUuid;
+    // Registry rows by id, their enabled addresses, and the list handed to
+    // QML, rebuilt on every registry write
+    QHash<int, QVariantMap> m_monitoredDevices;
+    QSet<quint64> m_monitoredAddresses;
+    QVariantList m_monitoredSnapshot;
     
     void checkBluetoothAvailability();
+    bool loadMonitoredDevices();
+    void rebuildMonitoredSnapshot();
+    static quint64 addressKey(const QString &address);
 };
 
 #endif // BLEMANAGER_H
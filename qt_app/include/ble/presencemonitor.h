@@ -45,6 +45,12 @@ private slots:
     void saveCurrentSession();
 
 private:
+    // Sets the session clock directly instead of waiting minutes
+    friend class TestPresenceMonitor;
+
+    void endSession();
+    
+
     BleManager *m_bleManager;
     QTimer *m_scanTimer;
     QTimer *m_timeoutTimer;
@@ -54,6 +60,12 @@ private:
     bool m_inOffice;
     QDateTime m_sessionStartTime;
     QDateTime m_lastDeviceDetection;
+    // office_presence row of the current session once its INSERT committed;
+    // later saves only move its end_time and duration
+    qint64 m_sessionRowId;
+    bool m_sessionInsertQueued;
+    // Tells a late INSERT completion which session it belonged to
+    int m_sessionSerial;
     
     static const int SCAN_INTERVAL_MS;
     static const int SCAN_DURATION_MS;
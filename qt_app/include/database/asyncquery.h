@@ -0,0 +1,64 @@
+#ifndef ASYNCQUERY_H
+#define ASYNCQUERY_H
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QJSEngine>
+#include <QJSValue>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QtConcurrent>
+#include <type_traits>
+#include <utility>
+#include "database/database.h"
+
+namespace AsyncQuery {
+
+// Runs function(QString *errorMessage) on the Qt Concurrent pool.
+// Database::database() hands the worker its own pooled connection, so the
+// GUI thread never waits on SQLite. Queued writes to the tables the function
+// reads are committed first so the worker sees them. The function must
+// capture values only: the owner may be gone by the time it runs. A reported
+// error is emitted as owner->error() on the owner's thread; the result is
+// cancelled if the owner is destroyed first.
+template <typename Owner, typename Function>
+auto run(Owner *owner, const QStringList &tables, Function &&function)
+{
+    using Result = std::invoke_result_t<Function &, QString *>;
+
+    Database::instance()->flushPendingWrites(tables);
+    return QtConcurrent::run([function = std::forward<Function>(function)]() mutable {
+        QString errorMessage;
+        Result result = function(&errorMessage);
+        return std::make_pair(std::move(result), errorMessage);
+    }).then(owner, [owner](std::pair<Result, QString> outcome) {
+        if (!outcome.second.isEmpty()) {
+            emit owner->error(outcome.second);
+        }
+        return std::move(outcome.first);
+    });
+}
+
+// Invokes a QML callback with the future's result on the context object's
+// thread once the worker has finished. Must be called on that thread: the
+// watcher holding the callback lives there, so the QJSValue is never copied,
+// called or destroyed anywhere else.
+template <typename T>
+void deliver(QObject *context, QFuture<T> future, const QJSValue &callback)
+{
+    auto *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [context, watcher, callback]() {
+        watcher->deleteLater();
+        QJSEngine *engine = qjsEngine(context);
+        if (!engine || !callback.isCallable() || watcher->isCanceled() || watcher->future().resultCount() == 0) {
+            return;
+        }
+        callback.call(QJSValueList{ engine->toScriptValue(watcher->result()) });
+    });
+    watcher->setFuture(future);
+}
+
+} // namespace AsyncQuery
+
+#endif // ASYNCQUERY_H
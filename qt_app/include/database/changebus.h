@@ -0,0 +1,88 @@
+#ifndef CHANGEBUS_H
+#define CHANGEBUS_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+struct sqlite3;
+
+struct RowChange
+{
+    enum Operation {
+        Insert,
+        Update,
+        Delete,
+        Reset   // Too many rows changed to list; reload the whole table
+    };
+
+    QString table;
+    Operation operation;
+    qint64 rowId;
+};
+
+Q_DECLARE_METATYPE(RowChange)
+
+// Reports which rows changed on the primary connection. Changes are
+// collected from the SQLite update hook when the native API is available,
+// and from the write queue otherwise. Everything that changed during one
+// event-loop turn is coalesced per row and delivered as a single
+// rowsChanged() batch.
+//
+// A row rolled back to a savepoint may still be reported, so consumers
+// should treat a change as "re-read this row", not as the row's contents.
+class ChangeBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChangeBus(QObject *parent = nullptr);
+    ~ChangeBus();
+
+    // Installs the update hook on db; returns false without the native API
+    bool attach(const QSqlDatabase &db);
+    void detach();
+    bool isHooked() const { return m_handle != nullptr; }
+
+    // Fallback entry point for writes the hook cannot see
+    void record(const QString &table, RowChange::Operation operation, qint64 rowId);
+    
+    // Delivers committed changes now instead of on the next event-loop turn,
+    // for readers that must see their own writes right after a flush
+    void flush();
+
+    static const int MAX_ROWS_PER_TABLE;
+
+signals:
+    void rowsChanged(const QList<RowChange> &changes);
+
+private:
+    void recordUncommitted(const QString &table, RowChange::Operation operation, qint64 rowId);
+    void commitPending();
+    void discardUncommitted();
+    void scheduleDelivery();
+    void deliver();
+
+#ifdef HAVE_SQLITE3_API
+    static void updateHook(void *context, int operation, const char *databaseName, const char *table, qint64 rowId);
+    static int commitHook(void *context);
+    static void rollbackHook(void *context);
+#endif
+
+    sqlite3 *m_handle;
+    QList<RowChange> m_uncommitted;
+    // Rows recorded per table in the open transaction; past
+    // MAX_ROWS_PER_TABLE the table is in m_uncommittedResets instead
+    QHash<QString, int> m_uncommittedCounts;
+    QSet<QString> m_uncommittedResets;
+    // table -> rowid -> coalesced operation; tables in first-seen order
+    QHash<QString, QHash<qint64, RowChange::Operation>> m_pending;
+    QStringList m_pendingTables;
+    QSet<QString> m_resetTables;
+    bool m_deliveryScheduled;
+};
+
+#endif // CHANGEBUS_H
@@ -4,13 +4,21 @@
 #include <QObject>
 #include <QSqlDatabase>
 #include <QString>
+#include <QStringList>
 #include <QVariantMap>
+#include <QThreadStorage>
+#include <QPointer>
+
+class OnlineBackup;
+class WriteQueue;
+class ChangeBus;
 
 class Database : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool isInitialized READ isInitialized NOTIFY initializedChanged)
     Q_PROPERTY(int currentVersion READ currentVersion NOTIFY versionChanged)
+    Q_PROPERTY(bool backupRunning READ isBackupRunning NOTIFY backupRunningChanged)
 
 public:
     explicit Database(QObject *parent = nullptr);
@@ -22,12 +30,38 @@ public:
     bool isInitialized() const { return m_initialized; }
     int currentVersion() const { return m_currentVersion; }
     
-    QSqlDatabase database() const { return m_db; }
+    // Connection for the calling thread: the primary connection on the thread
+    // that owns the Database, a pooled per-thread connection everywhere else
+    QSqlDatabase database() const;
+    
+    // Group-commit queue for writes made on the owning thread
+    WriteQueue *writeQueue() const { return m_writeQueue; }
+    // Commits queued writes; does nothing when called from a worker thread
+    void flushPendingWrites();
+    // For readers: commits only when a queued write targets one of tables,
+    // so reads of other tables leave the batch to fill up. Tables kept by
+    // triggers count as their sources (time_entries for daily_project_totals,
+    // subtasks for the task counters).
+    void flushPendingWrites(const QStringList &tables);
+    
+    // Row-level change notifications for the primary connection
+    ChangeBus *changeBus() const { return m_changeBus; }
     
     // Database operations
     Q_INVOKABLE bool backupToJson(const QString &filePath);
     Q_INVOKABLE bool restoreFromJson(const QString &filePath);
     
+    // Compares the daily_project_totals rollup with time_entries and, when
+    // rebuild is set, recomputes it on mismatch; true if it ends up consistent
+    Q_INVOKABLE bool verifyDailyTotals(bool rebuild = true);
+    // Same for the tasks.subtask_total / subtask_done counters
+    Q_INVOKABLE bool verifySubtaskCounters(bool rebuild = true);
+    
+    // Incremental binary snapshot of the live database (also works in demo mode)
+    Q_INVOKABLE bool backupTo(const QString &filePath);
+    Q_INVOKABLE void cancelBackup();
+    bool isBackupRunning() const;
+    
     // Demo mode support
     void setDemoMode(bool enabled);
     bool isDemoMode() const { return m_demoMode; }
@@ -36,14 +70,42 @@ signals:
     void initializedChanged();
     void versionChanged();
     void databaseError(const QString &error);
+    void restoreProgress(qint64 bytesRead, qint64 totalBytes);
+    // For the UI; caches follow a restore through the change bus resets
+    void databaseRestored();
+    void migrationProgress(int step, qint64 rowsDone, qint64 rowsTotal);
+    void backupRunningChanged();
+    void backupProgress(int pagesDone, int pagesTotal);
+    void backupFinished(bool success, const QString &error);
 
 private:
+    // Owned by QThreadStorage; removes the worker's connection at thread exit
+    class PooledConnection
+    {
+    public:
+        explicit PooledConnection(const QString &name) : m_name(name) {}
+        ~PooledConnection();
+        QString name() const { return m_name; }
+    private:
+        QString m_name;
+    };
+
+    QSqlDatabase openThreadConnection() const;
     bool createTables();
     bool runMigrations();
+    QByteArray computeSchemaHash();
+    bool schemaFingerprintMatches();
+    bool storeSchemaFingerprint();
     bool executeSql(const QString &sql);
     
     static Database* s_instance;
     QSqlDatabase m_db;
+    QString m_databasePath;
+    QString m_connectOptions;
+    mutable QThreadStorage<PooledConnection *> m_threadConnections;
+    QPointer<OnlineBackup> m_onlineBackup;
+    WriteQueue *m_writeQueue;
+    ChangeBus *m_changeBus;
     bool m_initialized;
     bool m_demoMode;
     int m_currentVersion;
@@ -0,0 +1,30 @@
+#ifndef DATABASEBACKUP_H
+#define DATABASEBACKUP_H
+
+#include <QSqlDatabase>
+#include <QStringList>
+#include <functional>
+
+// JSON backup and restore of the application tables. Stateless: callers
+// pass the connection to use.
+namespace DatabaseBackup {
+
+// Tables included in a JSON backup, parents before children
+QStringList backupTables();
+
+// Streams every backup table to filePath one row at a time, so memory
+// use does not depend on the number of rows
+bool writeJson(QSqlDatabase &db, const QString &filePath, int schemaVersion, QString *errorMessage);
+
+// Replaces the contents of the backup tables with a JSON backup written at
+// schemaVersion; backups from any other version are rejected. The file is
+// parsed incrementally and rows are bulk-inserted with reused prepared
+// statements; indexes and triggers are recreated once the load is done and
+// the derived counters and totals recomputed.
+using ProgressCallback = std::function<void(qint64 bytesRead, qint64 totalBytes)>;
+bool readJson(QSqlDatabase &db, const QString &filePath, int schemaVersion,
+              const ProgressCallback &progress, QString *errorMessage);
+
+} // namespace DatabaseBackup
+
+#endif // DATABASEBACKUP_H
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QSqlDatabase>
+#include <functional>
 
 class DatabaseMigration : public QObject
 {
@@ -11,9 +12,33 @@ class DatabaseMigration : public QObject
 public:
     explicit DatabaseMigration(QObject *parent = nullptr);
     
-    static bool migrateToVersion(QSqlDatabase &db, int targetVersion);
+    // Called with the migration step (target version) and, for steps that
+    // rewrite rows, how many rows are done out of rowsTotal (0 if unknown)
+    using ProgressCallback = std::function<void(int step, qint64 rowsDone, qint64 rowsTotal)>;
+    
+    // Steps that copy a table do it this many rows at a time and report
+    // progress after each batch
+    static const int ROWS_PER_BATCH;
+    
+    // Each step runs with its version bump in a single transaction
+    static bool migrateToVersion(QSqlDatabase &db, int targetVersion, const ProgressCallback &progress = ProgressCallback());
     static int getCurrentVersion(QSqlDatabase &db);
     static bool setVersion(QSqlDatabase &db, int version);
+    
+    // daily_project_totals is derived from time_entries: recompute it from
+    // scratch, or count the rows that disagree (-1 on error)
+    static bool rebuildDailyTotals(QSqlDatabase &db);
+    static int dailyTotalsMismatches(QSqlDatabase &db);
+    
+    // tasks.subtask_total / subtask_done mirror the subtasks table: recount
+    // them, or count the tasks whose counters are off (-1 on error)
+    static bool rebuildSubtaskCounters(QSqlDatabase &db);
+    static int subtaskCounterMismatches(QSqlDatabase &db);
+    
+    // Older builds saved a presence session as a new row on every save;
+    // keeps only the longest row per session and returns how many rows
+    // were removed (-1 on error)
+    static int compactPresenceSessions(QSqlDatabase &db);
 
 private:
     static bool migrateToV1(QSqlDatabase &db);
@@ -21,8 +46,14 @@ private:
     static bool migrateToV3(QSqlDatabase &db);
     static bool migrateToV4(QSqlDatabase &db);
     static bool migrateToV5(QSqlDatabase &db);
-    static bool migrateToV6(QSqlDatabase &db);
+    static bool migrateToV6(QSqlDatabase &db, const ProgressCallback &progress);
     static bool migrateToV7(QSqlDatabase &db);
+    static bool migrateToV8(QSqlDatabase &db);
+    static bool migrateToV9(QSqlDatabase &db);
+    static bool migrateToV10(QSqlDatabase &db);
+    static bool migrateToV11(QSqlDatabase &db);
+    static bool migrateToV12(QSqlDatabase &db);
+    static bool migrateToV13(QSqlDatabase &db);
 };
 
 #endif // DATABASEMIGRATION_H
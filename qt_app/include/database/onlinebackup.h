@@ -0,0 +1,88 @@
+#ifndef ONLINEBACKUP_H
+#define ONLINEBACKUP_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QTimer>
+
+struct sqlite3;
+struct sqlite3_backup;
+
+// Copies a live database to a file a few pages at a time from the event
+// loop, so writers on the source connection are never blocked for long.
+//
+// With the native SQLite API the copy goes through sqlite3_backup_step().
+// Otherwise a separate connection holds a read snapshot of the file (WAL
+// lets the application keep writing) and the rows are copied table by
+// table, ROWS_PER_STEP at a time, paged by rowid or, for WITHOUT ROWID
+// tables, by primary key. Indexes, triggers and the AUTOINCREMENT counters
+// in sqlite_sequence are written once the data is in. The demo database
+// lives in a shared-cache in-memory URI, which offers no such snapshot: a
+// long-lived reader would lock writers out instead. It is copied in one
+// VACUUM INTO step and isIncremental() is false.
+class OnlineBackup : public QObject
+{
+    Q_OBJECT
+
+public:
+    OnlineBackup(const QSqlDatabase &source, const QString &destinationPath, QObject *parent = nullptr);
+    ~OnlineBackup();
+
+    bool start();
+    void cancel();
+    bool isRunning() const { return m_running; }
+    // Whether the copy is split into steps that can be cancelled between
+    bool isIncremental() const { return m_incremental; }
+
+signals:
+    // In pages with the native API, in rows otherwise
+    void progress(int pagesDone, int pagesTotal);
+    void finished(bool success, const QString &errorMessage);
+
+private slots:
+    void step();
+
+private:
+    bool startNative(sqlite3 *source);
+    bool startCopy();
+    void stepNative();
+    void stepCopy();
+    void stepVacuum();
+    bool openCopyConnections(QString *errorMessage);
+    bool prepareCopy(QString *errorMessage);
+    bool copyRows(QString *errorMessage);
+    bool completeCopy(QString *errorMessage);
+    void closeCopyConnections();
+    void finish(bool success, const QString &errorMessage);
+    QString partialPath() const { return m_destinationPath + ".part"; }
+
+    QSqlDatabase m_source;
+    QString m_destinationPath;
+    QTimer m_timer;
+    bool m_running;
+    bool m_incremental;
+    sqlite3 *m_destination;
+    sqlite3_backup *m_backup;
+
+    // Row copy through SQL
+    QString m_readerName;
+    QString m_writerName;
+    QStringList m_tables;
+    // Paging columns of each table in m_tables
+    QList<QStringList> m_tableKeys;
+    QStringList m_deferredSql;
+    int m_tableIndex;
+    // Key of the last row copied from the current table; empty at its start
+    QVariantList m_lastKey;
+    qint64 m_rowsDone;
+    qint64 m_rowsTotal;
+
+    static const int PAGES_PER_STEP;
+    static const int ROWS_PER_STEP;
+    static const int STEP_INTERVAL_MS;
+};
+
+#endif // ONLINEBACKUP_H
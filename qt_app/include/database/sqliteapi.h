@@ -0,0 +1,21 @@
+#ifndef SQLITEAPI_H
+#define SQLITEAPI_H
+
+#include <QSqlDatabase>
+
+struct sqlite3;
+
+namespace SqliteApi {
+
+// The sqlite3 handle behind a QSQLITE connection, for the SQLite C API
+// calls made when the build enables USE_NATIVE_SQLITE_API. Returns nullptr
+// when the option is off, the connection is not SQLite, or the driver runs
+// a different SQLite than the one linked into this build (Qt usually bundles
+// its own copy): a different version, source id or set of compile options.
+// Calling one library's functions on the other's handle is undefined
+// behaviour.
+sqlite3 *nativeHandle(const QSqlDatabase &db);
+
+} // namespace SqliteApi
+
+#endif // SQLITEAPI_H
@@ -0,0 +1,76 @@
+#ifndef STATEMENTS_H
+#define STATEMENTS_H
+
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+
+// The SQL the managers run, in one place so the query plan test checks the
+// statements the application actually issues. Builders that take a filter
+// add the values to bind to *bindings.
+namespace Statements {
+
+// Comma-separated ids for an IN (...) list
+QString idList(const QList<int> &ids);
+
+// TimeEntryManager
+extern const QString SELECT_TIME_ENTRIES;
+extern const QString ALL_TIME_ENTRIES;
+extern const QString TIME_ENTRIES_BY_PROJECT;
+extern const QString TIME_ENTRY_BY_ID;
+extern const QString INSERT_TIME_ENTRY;
+extern const QString UPDATE_TIME_ENTRY;
+extern const QString DELETE_TIME_ENTRY;
+extern const QString PROJECT_NAMES;
+QString timeEntriesByIds(const QList<int> &ids, const QVariantMap &filter, QVariantMap *bindings);
+// id, project_id and task_id of the given entries
+QString timeEntryParentsByIds(const QList<int> &ids);
+QString timeEntriesPage(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit,
+                        QVariantMap *bindings);
+QString timeEntriesSummary(const QVariantMap &filter, QVariantMap *bindings);
+// Empty for an unknown groupBy. Entries count on the day they start, on the
+// rollup and the time_entries path alike.
+QString timeEntriesAggregate(const QString &groupBy, const QVariantMap &filter, QVariantMap *bindings);
+
+// TimeEntryIntervalIndex
+extern const QString TIME_ENTRY_SPANS;
+QString timeEntrySpansByIds(const QList<int> &ids);
+
+// ProjectManager and ProjectStatsCache
+extern const QString ALL_PROJECTS;
+extern const QString PROJECT_BY_ID;
+extern const QString INSERT_PROJECT;
+extern const QString UPDATE_PROJECT;
+extern const QString DELETE_PROJECT;
+extern const QString ALL_PROJECT_STATS;
+QString projectStatsByIds(const QList<int> &ids);
+
+// TaskManager and TaskStatsCache
+extern const QString ALL_TASKS;
+extern const QString TASKS_BY_PROJECT;
+extern const QString TASK_BY_ID;
+extern const QString INSERT_TASK;
+extern const QString UPDATE_TASK;
+extern const QString DELETE_TASK;
+extern const QString ALL_TASK_STATS;
+QString taskStatsByIds(const QList<int> &ids);
+// The given rows of a child table and the parent each belongs to
+QString childParentsByIds(const QString &table, const QString &column, const QList<int> &ids);
+
+// BleManager
+extern const QString UPSERT_BLE_DEVICE;
+extern const QString BLE_DEVICE_ID_BY_MAC;
+extern const QString UPDATE_BLE_DEVICE_MAC;
+extern const QString DELETE_BLE_DEVICE;
+extern const QString ALL_BLE_DEVICES;
+
+// PresenceMonitor and the v13 migration
+extern const QString INSERT_PRESENCE_SESSION;
+extern const QString UPDATE_PRESENCE_SESSION;
+extern const QString PRESENCE_BY_DATE;
+extern const QString PRESENCE_TOTAL_BY_DATE;
+extern const QString COMPACT_PRESENCE_SESSIONS;
+
+} // namespace Statements
+
+#endif // STATEMENTS_H
@@ -0,0 +1,77 @@
+#ifndef WRITEQUEUE_H
+#define WRITEQUEUE_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+
+class ChangeBus;
+struct sqlite3;
+
+// Collects writes issued on the GUI thread and commits them together, one
+// transaction per event-loop tick (or sooner once MAX_BATCH_SIZE writes are
+// waiting), so a burst of edits costs one sync instead of one per statement.
+// Each write runs under its own savepoint: a failing statement is rolled
+// back alone and reported to its caller while the rest of the batch commits.
+// A write whose savepoint cannot be opened or closed fails as a whole.
+class WriteQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WriteQueue(QObject *parent = nullptr);
+
+    // Called once the batch holding the write has committed
+    using Completion = std::function<void(bool success, const QVariant &lastInsertId, const QString &errorMessage)>;
+    using BatchCompletion = std::function<void(bool success, const QVariantList &lastInsertIds, const QString &errorMessage)>;
+
+    void setDatabase(const QSqlDatabase &db);
+    // Committed writes are reported here when the bus has no update hook
+    void setChangeBus(ChangeBus *changeBus) { m_changeBus = changeBus; }
+    void enqueue(const QString &sql, const QVariantMap &bindings, const Completion &completion = Completion());
+    // Runs sql once per row under a single savepoint: either every row is
+    // applied or, when one fails, none of them is
+    void enqueueBatch(const QString &sql, const QList<QVariantMap> &rows, const BatchCompletion &completion = BatchCompletion());
+
+    // Commits everything queued so far; readers call this for read-your-writes
+    void flush();
+    int pendingCount() const { return m_pendingRows; }
+    // True if a queued write targets one of tables, or a table it cannot tell
+    bool writesPendingTo(const QStringList &tables) const;
+
+    static const int FLUSH_INTERVAL_MS;
+    static const int MAX_BATCH_SIZE;
+
+signals:
+    // Emitted after the completions of a batch have run; counts rows
+    void flushed(int writes);
+
+private:
+    struct PendingWrite
+    {
+        QString sql;
+        QList<QVariantMap> rows;
+        Completion completion;
+        BatchCompletion batchCompletion;
+    };
+
+    void append(PendingWrite write);
+    bool callerTransactionOpen() const;
+    void reportChange(const QString &sql, const QVariantMap &bindings, const QVariant &lastInsertId);
+
+    QSqlDatabase m_db;
+    // Set when the SQLite C API is usable on m_db
+    sqlite3 *m_handle;
+    ChangeBus *m_changeBus;
+    QList<PendingWrite> m_pending;
+    // Tables written by m_pending; an empty name stands for "unknown"
+    QSet<QString> m_pendingTables;
+    int m_pendingRows;
+    QTimer m_timer;
+};
+
+#endif // WRITEQUEUE_H
@@ -4,8 +4,12 @@
 #include <QObject>
 #include <QList>
 #include <QVariantList>
+#include <QFuture>
+#include <QJSValue>
 #include "database/projectmodel.h"
 
+class ProjectStatsCache;
+
 class ProjectManager : public QObject
 {
     Q_OBJECT
@@ -18,7 +22,20 @@ public:
     Q_INVOKABLE bool createProject(const QVariantMap &projectData);
     Q_INVOKABLE bool updateProject(int id, const QVariantMap &projectData);
     Q_INVOKABLE bool deleteProject(int id);
+    
+    // totalMinutes, entryCount, totalEarnings, budget, budgetConsumed,
+    // budgetRemaining, budgetPercent and lastActivity; cached per project
+    // and recomputed only for projects whose entries changed since the last
+    // read
     Q_INVOKABLE QVariantMap getProjectStats(int id);
+    Q_INVOKABLE QVariantList getAllProjectStats();
+    
+    // Asynchronous getters run on a pooled worker connection. C++ callers
+    // get a QFuture; QML passes a callback invoked on the GUI thread.
+    QFuture<QVariantList> getAllProjectsAsync();
+    QFuture<QVariantMap> getProjectAsync(int id);
+    Q_INVOKABLE void getAllProjectsAsync(const QJSValue &callback);
+    Q_INVOKABLE void getProjectAsync(int id, const QJSValue &callback);
 
 signals:
     void projectsChanged();
@@ -28,6 +45,8 @@ signals:
     void error(const QString &message);
 
 private:
+    ProjectStatsCache *m_stats;
+    
     QVariantMap projectToVariantMap(const ProjectModel &project);
     ProjectModel variantMapToProject(const QVariantMap &data);
 };
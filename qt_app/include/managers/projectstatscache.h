@@ -0,0 +1,43 @@
+#ifndef PROJECTSTATSCACHE_H
+#define PROJECTSTATSCACHE_H
+
+#include <QObject>
+#include <QList>
+#include <QVariantMap>
+#include "database/changebus.h"
+#include "managers/statscache.h"
+
+// Per-project totals, earnings, budget burn and last activity, computed by
+// one grouped query over the daily rollup and kept until something they
+// depend on changes. A project change only makes that project stale. A
+// changed time entry makes the project it now belongs to stale, read back
+// from just the changed rows; the project an entry left is reported by
+// TimeEntryManager as an update of that project.
+class ProjectStatsCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProjectStatsCache(QObject *parent = nullptr);
+
+    // Empty when the project does not exist
+    QVariantMap stats(int projectId);
+    // One map per project, ordered by project id
+    QVariantList allStats();
+
+    // For writes the change bus may not see, e.g. without the update hook
+    void markDirty(int projectId);
+    // Drops everything; the next read recomputes from the database
+    void invalidate();
+
+private slots:
+    void onRowsChanged(const QList<RowChange> &changes);
+
+private:
+    void ensureCurrent();
+
+    StatsCache m_stats;
+    ChildChanges m_entries;
+};
+
+#endif // PROJECTSTATSCACHE_H
@@ -0,0 +1,71 @@
+#ifndef STATSCACHE_H
+#define STATSCACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSqlQuery>
+#include <QString>
+#include <QVariantMap>
+#include <functional>
+
+// Stats maps keyed by row id plus the ids whose copy is stale, shared by
+// ProjectStatsCache and TaskStatsCache. Stale rows are recomputed
+// IDS_PER_QUERY at a time, or all at once with one grouped query when the
+// cache is incomplete or every row in it is stale.
+class StatsCache
+{
+public:
+    using ReadRow = std::function<QVariantMap(const QSqlQuery &)>;
+    using StatementForIds = std::function<QString(const QList<int> &)>;
+
+    // readRow turns a result row into a stats map; column 0 must be the id
+    StatsCache(const QString &name, const QString &allStatement, StatementForIds statementForIds, ReadRow readRow);
+
+    // Empty when the row does not exist
+    QVariantMap value(int id);
+    // Every row, brought up to date first
+    const QHash<int, QVariantMap> &all();
+
+    void markDirty(int id) { m_dirty.insert(id); }
+    void remove(int id);
+    void clear();
+
+    static const int IDS_PER_QUERY;
+
+private:
+    bool refresh(const QList<int> &ids);
+    bool refreshAll();
+
+    QString m_name;
+    QString m_allStatement;
+    StatementForIds m_statementForIds;
+    ReadRow m_readRow;
+    QHash<int, QVariantMap> m_stats;
+    QSet<int> m_dirty;
+    // Whether m_stats holds every row
+    bool m_complete;
+};
+
+// Rows of a child table changed since the last read. Their current parent
+// is read back with one query over just those rows; the parent a row was
+// moved away from or deleted from is no longer in it, so the writer that
+// moved or deleted it reports that parent itself (see TimeEntryManager).
+class ChildChanges
+{
+public:
+    ChildChanges(const QString &table, const QString &column);
+
+    QString table() const { return m_table; }
+    void markChanged(int rowId) { m_changed.insert(rowId); }
+    // Marks the current parent of every changed row dirty in stats
+    bool resolveChanged(StatsCache *stats);
+    void clear() { m_changed.clear(); }
+
+private:
+    QString m_table;
+    QString m_column;
+    QSet<int> m_changed;
+};
+
+#endif // STATSCACHE_H
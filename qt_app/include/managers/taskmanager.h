@@ -3,7 +3,10 @@
 
 #include <QObject>
 #include <QVariantList>
-#include "database/taskmodel.h"
+#include <QFuture>
+#include <QJSValue>
+
+class TaskStatsCache;
 
 class TaskManager : public QObject
 {
@@ -15,20 +18,45 @@ public:
     Q_INVOKABLE QVariantList getAllTasks();
     Q_INVOKABLE QVariantList getTasksByProject(int projectId);
     Q_INVOKABLE QVariantMap getTask(int id);
+    
+    // Writes are queued and committed in batches; see TimeEntryManager
     Q_INVOKABLE bool createTask(const QVariantMap &taskData);
     Q_INVOKABLE bool updateTask(int id, const QVariantMap &taskData);
     Q_INVOKABLE bool deleteTask(int id);
+    // Bulk variants, one statement and one savepoint for all rows; see
+    // TimeEntryManager::createTimeEntries
+    Q_INVOKABLE bool createTasks(const QVariantList &tasks);
+    Q_INVOKABLE bool updateTasks(const QVariantList &tasks);
+    Q_INVOKABLE bool deleteTasks(const QList<int> &ids);
+    
+    // spentMinutes, allocatedMinutes, percentUsed, subtaskTotal, subtaskDone
+    // and overdue; cached per task until a change touches it. The list
+    // variant filters on projectId and isActive.
     Q_INVOKABLE QVariantMap getTaskStats(int id);
+    Q_INVOKABLE QVariantList getAllTaskStats(const QVariantMap &filter = QVariantMap());
+    
+    // Asynchronous getters run on a pooled worker connection. C++ callers
+    // get a QFuture; QML passes a callback invoked on the GUI thread.
+    QFuture<QVariantList> getAllTasksAsync();
+    QFuture<QVariantList> getTasksByProjectAsync(int projectId);
+    QFuture<QVariantMap> getTaskAsync(int id);
+    Q_INVOKABLE void getAllTasksAsync(const QJSValue &callback);
+    Q_INVOKABLE void getTasksByProjectAsync(int projectId, const QJSValue &callback);
+    Q_INVOKABLE void getTaskAsync(int id, const QJSValue &callback);
 
 signals:
     void tasksChanged();
     void taskCreated(int id);
     void taskUpdated(int id);
     void taskDeleted(int id);
+    void tasksCreated(const QList<int> &ids);
+    void tasksUpdated(const QList<int> &ids);
+    void tasksDeleted(const QList<int> &ids);
     void error(const QString &message);
 
 private:
-    QVariantMap taskToVariantMap(const TaskModel &task);
+    bool m_changesPending;
+    TaskStatsCache *m_stats;
 
 };
 
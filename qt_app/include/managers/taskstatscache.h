@@ -0,0 +1,48 @@
+#ifndef TASKSTATSCACHE_H
+#define TASKSTATSCACHE_H
+
+#include <QObject>
+#include <QDate>
+#include <QList>
+#include <QVariantMap>
+#include "database/changebus.h"
+#include "managers/statscache.h"
+
+// Spent vs allocated minutes, subtask completion and the overdue flag for
+// every task, computed by one grouped join and kept until a change touches
+// the task. Subtask counts are read from the tasks.subtask_total and
+// subtask_done counters, so a subtask change reaches the cache as the
+// trigger's update of its task. A changed time entry makes the task it
+// now belongs to stale, read back from just the changed rows; the task an
+// entry left is reported by TimeEntryManager as an update of that task.
+class TaskStatsCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskStatsCache(QObject *parent = nullptr);
+
+    // Empty when the task does not exist
+    QVariantMap stats(int taskId);
+    // Ordered like TaskManager::getAllTasks(); filter takes projectId and
+    // isActive
+    QVariantList allStats(const QVariantMap &filter);
+
+    // For writes the change bus may not see, e.g. without the update hook
+    void markDirty(int taskId);
+    // Drops everything; the next read recomputes from the database
+    void invalidate();
+
+private slots:
+    void onRowsChanged(const QList<RowChange> &changes);
+
+private:
+    bool ensureCurrent();
+
+    StatsCache m_stats;
+    ChildChanges m_entries;
+    // Overdue depends on today's date
+    QDate m_computedOn;
+};
+
+#endif // TASKSTATSCACHE_H
@@ -0,0 +1,72 @@
+#ifndef TIMEENTRYINTERVALINDEX_H
+#define TIMEENTRYINTERVALINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QVector>
+#include "database/changebus.h"
+
+// In-memory interval tree over the [start_epoch, end_epoch) spans of all
+// time entries, answering overlap queries in O(log n + k). Spans live in
+// an array sorted by start with the subtree's largest end stored at each
+// implicit node. The array is loaded on first use; later writes arrive
+// through the change bus and are kept in a small overlay that is merged
+// back once it grows past MAX_OVERLAY_SIZE.
+//
+// Epochs use the same clock as the epoch columns: wall-clock times
+// without an offset count as UTC. One index is shared by every
+// TimeEntryManager through instance(); it is owned by the Database.
+class TimeEntryIntervalIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TimeEntryIntervalIndex(QObject *parent = nullptr);
+
+    static TimeEntryIntervalIndex *instance();
+
+    // Ids of entries whose span intersects [start, end). Zero-length
+    // entries count as lasting one second.
+    QList<int> overlapping(qint64 start, qint64 end, int excludeId = 0);
+    bool overlapsAny(qint64 start, qint64 end, int excludeId = 0);
+
+    // Drops everything; the next query reloads from the database
+    void invalidate();
+
+    // The clock above, for ISO strings as bound to the epoch columns
+    static qint64 toEpoch(const QString &isoDateTime);
+
+    static const int MAX_OVERLAY_SIZE;
+
+private slots:
+    void onRowsChanged(const QList<RowChange> &changes);
+
+private:
+    struct Span
+    {
+        qint64 start;
+        qint64 end;
+        int id;
+    };
+
+    bool ensureCurrent();
+    bool load();
+    bool fetchChanged();
+    void rebuild();
+    qint64 buildNode(int lo, int hi);
+    void collect(int lo, int hi, qint64 start, qint64 end, int excludeId, QList<int> *ids, bool firstOnly) const;
+
+    QVector<Span> m_spans;
+    QVector<qint64> m_maxEnd;
+    // Ids whose copy in m_spans is stale or missing; their current span,
+    // if the entry still exists, is in m_overlay
+    QSet<int> m_changed;
+    QHash<int, Span> m_overlay;
+    // Changed on disk but not read back yet
+    QSet<int> m_unfetched;
+    bool m_loaded;
+};
+
+#endif // TIMEENTRYINTERVALINDEX_H
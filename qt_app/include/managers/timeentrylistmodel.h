@@ -0,0 +1,82 @@
+#ifndef TIMEENTRYLISTMODEL_H
+#define TIMEENTRYLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVariantMap>
+#include <QVector>
+#include "database/changebus.h"
+
+class TimeEntryManager;
+
+// Time entries for QML views, newest first. Rows are loaded a page at a
+// time through keyset pagination as the view scrolls, and writes are
+// applied row by row from the change bus instead of reloading the list.
+class TimeEntryListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantMap filter READ filter WRITE setFilter NOTIFY filterChanged)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY summaryChanged)
+    Q_PROPERTY(qint64 totalMinutes READ totalMinutes NOTIFY summaryChanged)
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        ProjectIdRole,
+        TaskIdRole,
+        DescriptionRole,
+        StartTimeRole,
+        EndTimeRole,
+        DurationRole,
+        StartEpochRole,
+        EndEpochRole
+    };
+
+    explicit TimeEntryListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // Same keys as TimeEntryManager::getTimeEntriesPage
+    QVariantMap filter() const { return m_filter; }
+    void setFilter(const QVariantMap &filter);
+
+    int totalCount() const { return m_totalCount; }
+    qint64 totalMinutes() const { return m_totalMinutes; }
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE void reload();
+
+    static const int PAGE_SIZE;
+    static const int MAX_INCREMENTAL_CHANGES;
+
+signals:
+    void filterChanged();
+    void summaryChanged();
+    void error(const QString &message);
+
+private slots:
+    void onRowsChanged(const QList<RowChange> &changes);
+
+private:
+    int indexOfId(int id) const;
+    int insertPosition(const QVariantMap &entry) const;
+    void insertEntry(const QVariantMap &entry);
+    void removeAt(int row);
+    void refreshSummary();
+
+    TimeEntryManager *m_manager;
+    QVector<QVariantMap> m_entries;
+    // id -> startEpoch of every loaded row; with the id that is the sort
+    // key, so a row is found by binary search and survives row shifts
+    QHash<int, qint64> m_startEpochs;
+    QVariantMap m_filter;
+    bool m_hasMore;
+    int m_totalCount;
+    qint64 m_totalMinutes;
+};
+
+#endif // TIMEENTRYLISTMODEL_H
@@ -3,9 +3,13 @@
 
 #include <QObject>
 #include <QList>
+#include <QHash>
 #include <QVariantList>
 #include <QDateTime>
-#include "database/timeentrymodel.h"
+#include <QFuture>
+#include <QJSValue>
+
+class TimeEntryIntervalIndex;
 
 class TimeEntryManager : public QObject
 {
@@ -18,12 +22,75 @@ public:
     
     Q_INVOKABLE QVariantList getAllTimeEntries();
     Q_INVOKABLE QVariantList getTimeEntriesByProject(int projectId);
+    // Entries overlapping [start, end], newest first, found through the
+    // in-memory interval index; entries crossing either bound are included
     Q_INVOKABLE QVariantList getTimeEntriesByDateRange(const QDateTime &start, const QDateTime &end);
     Q_INVOKABLE QVariantMap getTimeEntry(int id);
+    
+    // One page of entries, newest first. Pass an empty afterStartTime for
+    // the first page, then the startTime and id of the last row received.
+    // filter may hold projectId, projectIds, taskId, start, end and description.
+    Q_INVOKABLE QVariantList getTimeEntriesPage(const QVariantMap &filter, const QString &afterStartTime = QString(),
+                                                int afterId = 0, int limit = 100);
+    // Row count and total minutes of everything matching filter
+    Q_INVOKABLE QVariantMap getTimeEntriesSummary(const QVariantMap &filter);
+    // Minutes and entry counts per group, computed in SQL. groupBy is one of
+    // project, task, day, week (ISO) or month; rows carry key, label,
+    // minutes and entryCount.
+    Q_INVOKABLE QVariantList aggregate(const QString &groupBy, const QVariantMap &filter = QVariantMap());
+    // The entries among ids that match filter, in no particular order
+    QVariantList getTimeEntriesByIds(const QList<int> &ids, const QVariantMap &filter = QVariantMap());
+    
+    // Calendar buckets from rangeStart through rangeEnd, one per day or, with
+    // granularity "week", per 7 days from rangeStart; at most 42
+    // (MAX_CALENDAR_BUCKETS). Buckets carry date, minutes, entryCount and
+    // topProjects (projectId, name, minutes). An entry crossing midnight
+    // counts on each day it touches, with its minutes split by time spent.
+    Q_INVOKABLE QVariantList getCalendarSummary(const QDate &rangeStart, const QDate &rangeEnd,
+                                                const QString &granularity = QStringLiteral("day"));
+    // Computes a summary in the background so the next request for the
+    // same range is answered from the cache, e.g. the adjacent month
+    Q_INVOKABLE void prefetchCalendarSummary(const QDate &rangeStart, const QDate &rangeEnd,
+                                             const QString &granularity = QStringLiteral("day"));
+    
+    // Whether [startTime, endTime) intersects another entry than excludeId
+    Q_INVOKABLE bool hasOverlap(const QString &startTime, const QString &endTime, int excludeId = 0);
+    
+    // Writes go through the Database write queue and commit in batches. The
+    // return value means the write was accepted; the outcome is reported by
+    // timeEntryCreated/Updated/Deleted or error once the batch commits.
+    // With rejectOverlap set in entryData, an entry overlapping another one
+    // is refused up front.
     Q_INVOKABLE bool createTimeEntry(const QVariantMap &entryData);
     Q_INVOKABLE bool updateTimeEntry(int id, const QVariantMap &entryData);
     Q_INVOKABLE bool deleteTimeEntry(int id);
     
+    // Bulk writes: all rows go through one prepared statement and are
+    // applied together or not at all, then reported by one batched signal.
+    // updateTimeEntries takes the id inside each entry.
+    Q_INVOKABLE bool createTimeEntries(const QVariantList &entries);
+    Q_INVOKABLE bool updateTimeEntries(const QVariantList &entries);
+    Q_INVOKABLE bool deleteTimeEntries(const QList<int> &ids);
+    
+    // Asynchronous getters run on a pooled worker connection. C++ callers
+    // get a QFuture; QML passes a callback invoked on the GUI thread.
+    QFuture<QVariantList> getAllTimeEntriesAsync();
+    QFuture<QVariantList> getTimeEntriesByProjectAsync(int projectId);
+    QFuture<QVariantList> getTimeEntriesByDateRangeAsync(const QDateTime &start, const QDateTime &end);
+    QFuture<QVariantMap> getTimeEntryAsync(int id);
+    QFuture<QVariantList> getTimeEntriesPageAsync(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit);
+    QFuture<QVariantList> aggregateAsync(const QString &groupBy, const QVariantMap &filter);
+    QFuture<QVariantList> getCalendarSummaryAsync(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity);
+    Q_INVOKABLE void getAllTimeEntriesAsync(const QJSValue &callback);
+    Q_INVOKABLE void getTimeEntriesByProjectAsync(int projectId, const QJSValue &callback);
+    Q_INVOKABLE void getTimeEntriesByDateRangeAsync(const QDateTime &start, const QDateTime &end, const QJSValue &callback);
+    Q_INVOKABLE void getTimeEntryAsync(int id, const QJSValue &callback);
+    Q_INVOKABLE void getTimeEntriesPageAsync(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit,
+                                             const QJSValue &callback);
+    Q_INVOKABLE void aggregateAsync(const QString &groupBy, const QVariantMap &filter, const QJSValue &callback);
+    Q_INVOKABLE void getCalendarSummaryAsync(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity,
+                                             const QJSValue &callback);
+    
     // Timer functions
     Q_INVOKABLE bool startTimer(int projectId, int taskId = -1, const QString &description = QString());
     Q_INVOKABLE bool stopTimer();
@@ -37,6 +104,9 @@ signals:
     void timeEntryCreated(int id);
     void timeEntryUpdated(int id);
     void timeEntryDeleted(int id);
+    void timeEntriesCreated(const QList<int> &ids);
+    void timeEntriesUpdated(const QList<int> &ids);
+    void timeEntriesDeleted(const QList<int> &ids);
     void timerRunningChanged();
     void timerStartTimeChanged();
     void error(const QString &message);
@@ -47,9 +117,21 @@ private:
     int m_currentProjectId;
     int m_currentTaskId;
     QString m_currentDescription;
+    bool m_changesPending;
+    // Shared by all managers; not owned
+    TimeEntryIntervalIndex *m_intervals;
+    // Calendar summaries by range; cleared when entries or projects change
+    QHash<QString, QVariantList> m_calendarCache;
+    int m_calendarGeneration;
+    
+    static const int MAX_CALENDAR_BUCKETS;
     
+    QList<int> overlappingIds(const QDateTime &start, const QDateTime &end);
+    bool calendarRange(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity,
+                       int *bucketDays, int *bucketCount, QList<int> *ids);
+    void cacheCalendarSummary(const QString &key, int generation, const QVariantList &buckets);
+    bool rejectsOverlap(const QVariantMap &entryData, int excludeId);
     int roundToFiveMinutes(int minutes);
-    QVariantMap timeEntryToVariantMap(const TimeEntryModel &entry);
 
 };
 
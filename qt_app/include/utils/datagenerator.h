@@ -0,0 +1,33 @@
+#ifndef DATAGENERATOR_H
+#define DATAGENERATOR_H
+
+#include <QDate>
+#include <QSqlDatabase>
+#include <functional>
+
+// Seeded synthetic workload: projects, tasks, subtasks, time entries and
+// office presence sessions with realistic shapes, for demo mode and
+// benchmarks. The same seed, size and last day always produce the same
+// rows, laid out over the weeks leading up to lastDay. Stateless: callers
+// pass the connection to use.
+namespace DataGenerator {
+
+using ProgressCallback = std::function<void(qint64 rowsDone, qint64 rowsTotal)>;
+
+extern const quint32 DEFAULT_SEED;
+extern const QDate DEFAULT_LAST_DAY;
+// Rows committed together; bounds the transaction for large workloads
+extern const int ROWS_PER_TRANSACTION;
+
+// Expects a migrated database; rows are added next to any existing data,
+// so running it again on the same file extends it. Every
+// ROWS_PER_TRANSACTION rows are committed as they are written: a failure
+// rolls back only the rows since the last commit, and the earlier ones
+// stay behind.
+bool generate(QSqlDatabase &db, qint64 timeEntries, quint32 seed,
+              const ProgressCallback &progress, QString *errorMessage,
+              const QDate &lastDay = DEFAULT_LAST_DAY);
+
+} // namespace DataGenerator
+
+#endif // DATAGENERATOR_H
@@ -8,9 +8,9 @@ Item {
 
     property date currentDate: new Date()
     property string viewMode: "month" // "month", "week", "day"
+    property int loadGeneration: 0
 
     Component.onCompleted: {
-        loadTimeEntries()
         generateCalendarData()
     }
 
@@ -18,15 +18,52 @@ Item {
         target: TimeEntryManager
         function onTimeEntriesChanged() {
             loadTimeEntries()
-            generateCalendarData()
         }
     }
 
+    // Per-day totals are computed by TimeEntryManager; entries that cross
+    // midnight count towards every day they touch
     function loadTimeEntries() {
-        entriesModel.clear()
-        var entries = TimeEntryManager.getAllTimeEntries()
-        for (var i = 0; i < entries.length; i++) {
-            entriesModel.append(entries[i])
+        if (calendarModel.count === 0) {
+            return
+        }
+        var generation = ++loadGeneration
+        var first = calendarModel.get(0).date
+        var last = calendarModel.get(calendarModel.count - 1).date
+
+        TimeEntryManager.getCalendarSummaryAsync(first, last, "day", function(buckets) {
+            if (generation !== loadGeneration) {
+                return
+            }
+            for (var i = 0; i < calendarModel.count && i < buckets.length; i++) {
+                var top = buckets[i].topProjects
+                calendarModel.setProperty(i, "entryCount", buckets[i].entryCount)
+                calendarModel.setProperty(i, "totalDuration", buckets[i].minutes)
+                calendarModel.setProperty(i, "topProject", top.length > 0 ? top[0].name : "")
+            }
+            prefetchAdjacent()
+        })
+    }
+
+    // Warms the summary cache for the range navigatePrevious/Next will show
+    function prefetchAdjacent() {
+        if (viewMode === "month") {
+            for (var offset = -1; offset <= 1; offset += 2) {
+                var monthStart = new Date(currentDate.getFullYear(), currentDate.getMonth() + offset, 1)
+                var monthEnd = new Date(currentDate.getFullYear(), currentDate.getMonth() + offset + 1, 0)
+                var gridStart = new Date(monthStart.getFullYear(), monthStart.getMonth(), 1 - monthStart.getDay())
+                var gridEnd = new Date(monthEnd.getFullYear(), monthEnd.getMonth(), monthEnd.getDate() + 6 - monthEnd.getDay())
+                TimeEntryManager.prefetchCalendarSummary(gridStart, gridEnd, "day")
+            }
+        } else {
+            var step = viewMode === "week" ? 7 : 1
+            var first = calendarModel.get(0).date
+            var last = calendarModel.get(calendarModel.count - 1).date
+            for (var direction = -1; direction <= 1; direction += 2) {
+                TimeEntryManager.prefetchCalendarSummary(
+                    new Date(first.getFullYear(), first.getMonth(), first.getDate() + direction * step),
+                    new Date(last.getFullYear(), last.getMonth(), last.getDate() + direction * step), "day")
+            }
         }
     }
 
@@ -40,6 +77,7 @@ Item {
         } else if (viewMode === "day") {
             generateDayView()
         }
+        loadTimeEntries()
     }
 
     function generateMonthView() {
@@ -91,19 +129,6 @@ Item {
     }
 
     function addDayToCalendar(date, isCurrentMonth) {
-        var dayEntries = []
-        var totalDuration = 0
-        
-        for (var i = 0; i < entriesModel.count; i++) {
-            var entry = entriesModel.get(i)
-            var entryDate = new Date(entry.start_time)
-            
-            if (entryDate.toDateString() === date.toDateString()) {
-                dayEntries.push(entry)
-                totalDuration += entry.duration || 0
-            }
-        }
-        
         var isToday = date.toDateString() === new Date().toDateString()
         
         calendarModel.append({
@@ -111,8 +136,9 @@ Item {
             "dayNumber": date.getDate(),
             "isCurrentMonth": isCurrentMonth,
             "isToday": isToday,
-            "entryCount": dayEntries.length,
-            "totalDuration": totalDuration
+            "entryCount": 0,
+            "totalDuration": 0,
+            "topProject": ""
         })
     }
 
@@ -293,19 +319,23 @@ Item {
                             font.bold: true
                             color: "#1976d2"
                         }
+
+                        Label {
+                            visible: model.topProject !== ""
+                            text: model.topProject
+                            font.pixelSize: 10
+                            color: "gray"
+                            elide: Text.ElideRight
+                            Layout.fillWidth: true
+                        }
                     }
                 }
             }
         }
     }
 
-    ListModel {
-        id: entriesModel
-    }
-
     onVisibleChanged: {
         if (visible) {
-            loadTimeEntries()
             generateCalendarData()
         }
     }
@@ -7,19 +7,19 @@ import ProjectTimeTracker 1.0
 Item {
     id: root
 
-    property var timeEntries: []
-    property var projects: []
+    property var projectTotals: []
+    property int totalEntries: 0
+    property int totalMinutes: 0
+    property int activeDays: 0
 
     Component.onCompleted: {
         loadData()
-        updateCharts()
     }
 
     Connections {
         target: TimeEntryManager
         function onTimeEntriesChanged() {
             loadData()
-            updateCharts()
         }
     }
 
@@ -27,96 +27,87 @@ Item {
         target: ProjectManager
         function onProjectsChanged() {
             loadData()
-            updateCharts()
         }
     }
 
-    function loadData() {
-        timeEntries = TimeEntryManager.getAllTimeEntries()
-        projects = ProjectManager.getAllProjects()
+    function isoDate(date) {
+        return Qt.formatDate(date, "yyyy-MM-dd") + "T00:00:00"
     }
 
-    function updateCharts() {
-        updateProjectChart()
+    // Filter for the range picked in dateRangeCombo
+    function rangeFilter() {
+        var now = new Date()
+        if (dateRangeCombo.currentIndex === 0) {
+            var start = new Date(now.getFullYear(), now.getMonth(), now.getDate() - 27)
+            return { start: isoDate(start) }
+        }
+        if (dateRangeCombo.currentIndex === 1) {
+            return { start: isoDate(new Date(now.getFullYear(), now.getMonth(), 1)) }
+        }
+        return {}
+    }
+
+    // Totals are grouped in SQL on a worker thread; only the buckets come back
+    function loadData() {
+        var filter = rangeFilter()
+        TimeEntryManager.aggregateAsync("project", filter, function(rows) {
+            projectTotals = rows
+            var entries = 0
+            var minutes = 0
+            for (var i = 0; i < rows.length; i++) {
+                entries += rows[i].entryCount
+                minutes += rows[i].minutes
+            }
+            totalEntries = entries
+            totalMinutes = minutes
+            updateProjectChart()
+        })
+        TimeEntryManager.aggregateAsync("day", filter, function(rows) {
+            activeDays = rows.length
+        })
         updateWeeklyChart()
     }
 
     function updateProjectChart() {
         projectSeries.clear()
-        
-        // Calculate time per project
-        var projectTimes = {}
-        for (var i = 0; i < timeEntries.length; i++) {
-            var entry = timeEntries[i]
-            var projectId = entry.project_id
-            if (!projectTimes[projectId]) {
-                projectTimes[projectId] = 0
-            }
-            projectTimes[projectId] += entry.duration || 0
-        }
-        
-        // Add to chart
-        for (var projectId in projectTimes) {
-            var project = findProject(parseInt(projectId))
-            if (project) {
-                var hours = projectTimes[projectId] / 60.0
-                projectSeries.append(project.name, hours)
+        for (var i = 0; i < projectTotals.length; i++) {
+            var row = projectTotals[i]
+            if (row.label) {
+                projectSeries.append(row.label, row.minutes / 60.0)
             }
         }
     }
 
+    // Last 8 ISO weeks, Monday first; weeks without entries show as zero
     function updateWeeklyChart() {
-        // Clear any existing sets
-        while (weeklySeries.count > 0) {
-            weeklySeries.remove(weeklySeries.at(0))
-        }
-        
-        // Clear axis categories
-        weeklyAxisX.clear()
-        
-        // Get last 8 weeks
         var now = new Date()
-        var weekData = []
-        
-        for (var i = 7; i >= 0; i--) {
-            var weekStart = new Date(now)
-            weekStart.setDate(now.getDate() - (i * 7) - now.getDay())
-            weekStart.setHours(0, 0, 0, 0)
-            
-            var weekEnd = new Date(weekStart)
-            weekEnd.setDate(weekStart.getDate() + 6)
-            weekEnd.setHours(23, 59, 59, 999)
-            
-            var weekMinutes = 0
-            for (var j = 0; j < timeEntries.length; j++) {
-                var entry = timeEntries[j]
-                var entryDate = new Date(entry.start_time)
-                if (entryDate >= weekStart && entryDate <= weekEnd) {
-                    weekMinutes += entry.duration || 0
-                }
+        var firstWeek = new Date(now.getFullYear(), now.getMonth(), now.getDate() - (now.getDay() + 6) % 7 - 7 * 7)
+
+        TimeEntryManager.aggregateAsync("week", { start: isoDate(firstWeek) }, function(rows) {
+            var minutesByWeek = {}
+            for (var i = 0; i < rows.length; i++) {
+                minutesByWeek[rows[i].key] = rows[i].minutes
             }
-            
-            var label = Qt.formatDate(weekStart, "MMM dd")
-            weeklyAxisX.append(label)
-            weekData.push(weekMinutes / 60.0)
-        }
-        
-        // Create a BarSet and add values individually
-        var barSet = weeklySeries.append("Hours", [])
-        if (barSet) {
-            for (var i = 0; i < weekData.length; i++) {
-                barSet.append(weekData[i])
+
+            while (weeklySeries.count > 0) {
+                weeklySeries.remove(weeklySeries.at(0))
             }
-        }
-    }
+            weeklyAxisX.clear()
 
-    function findProject(projectId) {
-        for (var i = 0; i < projects.length; i++) {
-            if (projects[i].id === projectId) {
-                return projects[i]
+            var weekData = []
+            for (var w = 0; w < 8; w++) {
+                var weekStart = new Date(firstWeek.getFullYear(), firstWeek.getMonth(), firstWeek.getDate() + w * 7)
+                weeklyAxisX.append(Qt.formatDate(weekStart, "MMM dd"))
+                weekData.push((minutesByWeek[Qt.formatDate(weekStart, "yyyy-MM-dd")] || 0) / 60.0)
             }
-        }
-        return null
+
+            var barSet = weeklySeries.append("Hours", [])
+            if (barSet) {
+                for (var j = 0; j < weekData.length; j++) {
+                    barSet.append(weekData[j])
+                }
+            }
+        })
     }
 
     function formatDuration(minutes) {
@@ -147,10 +138,7 @@ Item {
                 id: dateRangeCombo
                 model: [qsTr("Last 4 Weeks"), qsTr("This Month"), qsTr("All Time")]
                 currentIndex: 0
-                onCurrentIndexChanged: {
-                    // TODO: Filter data by date range
-                    updateCharts()
-                }
+                onCurrentIndexChanged: loadData()
             }
         }
 
@@ -222,7 +210,7 @@ Item {
                             font.bold: true
                         }
                         Label {
-                            text: timeEntries.length
+                            text: totalEntries
                             Layout.columnSpan: 2
                         }
 
@@ -231,13 +219,7 @@ Item {
                             font.bold: true
                         }
                         Label {
-                            text: {
-                                var total = 0
-                                for (var i = 0; i < timeEntries.length; i++) {
-                                    total += timeEntries[i].duration || 0
-                                }
-                                return formatDuration(total)
-                            }
+                            text: formatDuration(totalMinutes)
                             Layout.columnSpan: 2
                         }
 
@@ -246,17 +228,7 @@ Item {
                             font.bold: true
                         }
                         Label {
-                            text: {
-                                var activeProjects = {}
-                                for (var i = 0; i < timeEntries.length; i++) {
-                                    activeProjects[timeEntries[i].project_id] = true
-                                }
-                                var count = 0
-                                for (var pid in activeProjects) {
-                                    count++
-                                }
-                                return count
-                            }
+                            text: projectTotals.length
                             Layout.columnSpan: 2
                         }
 
@@ -265,22 +237,7 @@ Item {
                             font.bold: true
                         }
                         Label {
-                            text: {
-                                var uniqueDays = {}
-                                var total = 0
-                                for (var i = 0; i < timeEntries.length; i++) {
-                                    var entry = timeEntries[i]
-                                    var date = new Date(entry.start_time).toDateString()
-                                    uniqueDays[date] = true
-                                    total += entry.duration || 0
-                                }
-                                var dayCount = 0
-                                for (var day in uniqueDays) {
-                                    dayCount++
-                                }
-                                var avg = dayCount > 0 ? total / dayCount : 0
-                                return formatDuration(Math.round(avg))
-                            }
+                            text: formatDuration(activeDays > 0 ? Math.round(totalMinutes / activeDays) : 0)
                             Layout.columnSpan: 2
                         }
                     }
@@ -292,7 +249,6 @@ Item {
     onVisibleChanged: {
         if (visible) {
             loadData()
-            updateCharts()
         }
     }
 }
@@ -35,6 +35,15 @@ Item {
                 onClicked: {
                     // TODO: Edit project
                 }
+
+                Label {
+                    anchors.right: parent.right
+                    anchors.rightMargin: 12
+                    anchors.verticalCenter: parent.verticalCenter
+                    text: Math.round(model.totalMinutes / 6) / 10 + qsTr(" h")
+                          + (model.budget > 0 ? " · " + Math.round(model.budgetPercent) + qsTr("% of budget") : "")
+                    color: model.budgetPercent > 100 ? "#d32f2f" : "gray"
+                }
             }
         }
     }
@@ -75,11 +84,38 @@ Item {
         refreshProjects()
     }
 
+    Connections {
+        target: TimeEntryManager
+        function onTimeEntriesChanged() {
+            refreshStats()
+        }
+    }
+
     function refreshProjects() {
         projectsListModel.clear()
         var projects = ProjectManager.getAllProjects()
         for (var i = 0; i < projects.length; i++) {
+            projects[i].totalMinutes = 0
+            projects[i].budgetPercent = 0
             projectsListModel.append(projects[i])
         }
+        refreshStats()
+    }
+
+    // One cached read for every row; only projects whose entries changed
+    // since the last read are recomputed
+    function refreshStats() {
+        var stats = ProjectManager.getAllProjectStats()
+        var byProject = {}
+        for (var i = 0; i < stats.length; i++) {
+            byProject[stats[i].projectId] = stats[i]
+        }
+        for (var j = 0; j < projectsListModel.count; j++) {
+            var projectStats = byProject[projectsListModel.get(j).id]
+            if (projectStats) {
+                projectsListModel.setProperty(j, "totalMinutes", projectStats.totalMinutes)
+                projectsListModel.setProperty(j, "budgetPercent", projectStats.budgetPercent)
+            }
+        }
     }
 }
@@ -6,10 +6,9 @@ import ProjectTimeTracker 1.0
 Item {
     id: root
 
-    property var timeEntries: []
     property var projects: []
-    property var filteredEntries: []
     property var reportStats: ({})
+    property int reportGeneration: 0
 
     Component.onCompleted: {
         loadData()
@@ -19,8 +18,7 @@ Item {
     Connections {
         target: TimeEntryManager
         function onTimeEntriesChanged() {
-            loadData()
-            filterEntries()
+            updateReport()
         }
     }
 
@@ -28,14 +26,16 @@ Item {
         target: ProjectManager
         function onProjectsChanged() {
             loadData()
-            filterEntries()
         }
     }
 
+    // Loads on a worker thread; the report is recomputed once the projects have arrived
     function loadData() {
-        timeEntries = TimeEntryManager.getAllTimeEntries()
-        projects = ProjectManager.getAllProjects()
-        updateProjectsList()
+        ProjectManager.getAllProjectsAsync(function(loadedProjects) {
+            projects = loadedProjects
+            updateProjectsList()
+            updateReport()
+        })
     }
 
     function updateProjectsList() {
@@ -56,103 +56,71 @@ Item {
         
         startDateField.text = Qt.formatDate(thirtyDaysAgo, "yyyy-MM-dd")
         endDateField.text = Qt.formatDate(today, "yyyy-MM-dd")
-        
-        filterEntries()
     }
 
-    function filterEntries() {
-        filteredEntries = []
-        
-        for (var i = 0; i < timeEntries.length; i++) {
-            var entry = timeEntries[i]
-            var include = true
-            
-            // Filter by date range
-            if (startDateField.text) {
-                var entryDate = new Date(entry.start_time)
-                var startDate = new Date(startDateField.text)
-                if (entryDate < startDate) {
-                    include = false
-                }
-            }
-            
-            if (endDateField.text) {
-                var entryDate = new Date(entry.start_time)
-                var endDate = new Date(endDateField.text)
-                endDate.setHours(23, 59, 59, 999)
-                if (entryDate > endDate) {
-                    include = false
-                }
-            }
-            
-            // Filter by selected projects
-            var projectSelected = false
-            for (var j = 0; j < projectsListModel.count; j++) {
-                var proj = projectsListModel.get(j)
-                if (proj.id === entry.project_id && proj.selected) {
-                    projectSelected = true
-                    break
-                }
-            }
-            if (!projectSelected) {
-                include = false
-            }
-            
-            if (include) {
-                filteredEntries.push(entry)
-            }
-        }
-        
-        calculateStats()
+    function isDate(text) {
+        return /^\d{4}-\d{2}-\d{2}$/.test(text)
     }
 
-    function calculateStats() {
-        var totalMinutes = 0
-        var uniqueDaysObj = {}
-        var projectStats = {}
-        
-        for (var i = 0; i < filteredEntries.length; i++) {
-            var entry = filteredEntries[i]
-            totalMinutes += entry.duration || 0
-            
-            var dateStr = new Date(entry.start_time).toDateString()
-            uniqueDaysObj[dateStr] = true
-            
-            var projectId = entry.project_id
-            if (!projectStats[projectId]) {
-                projectStats[projectId] = {
-                    name: entry.project_name,
-                    totalMinutes: 0,
-                    entryCount: 0
-                }
-            }
-            projectStats[projectId].totalMinutes += entry.duration || 0
-            projectStats[projectId].entryCount++
+    // Criteria as a TimeEntryManager filter; the project list is only sent
+    // when some projects are deselected
+    function reportFilter() {
+        var filter = {}
+        if (isDate(startDateField.text)) {
+            filter.start = startDateField.text + "T00:00:00"
         }
-        
-        // Count unique days
-        var uniqueDaysCount = 0
-        for (var day in uniqueDaysObj) {
-            uniqueDaysCount++
+        if (isDate(endDateField.text)) {
+            filter.end = endDateField.text + "T23:59:59"
         }
         
-        var avgPerDay = uniqueDaysCount > 0 ? totalMinutes / uniqueDaysCount : 0
-        
-        // Convert projectStats object to array
-        var projectStatsArray = []
-        for (var pid in projectStats) {
-            projectStatsArray.push(projectStats[pid])
+        var selected = []
+        for (var i = 0; i < projectsListModel.count; i++) {
+            var proj = projectsListModel.get(i)
+            if (proj.selected) {
+                selected.push(proj.id)
+            }
         }
-        
-        reportStats = {
-            totalMinutes: totalMinutes,
-            totalEntries: filteredEntries.length,
-            uniqueDays: uniqueDaysCount,
-            averagePerDay: avgPerDay,
-            projectStats: projectStatsArray
+        if (selected.length < projectsListModel.count) {
+            filter.projectIds = selected
         }
+        return filter
+    }
+
+    // Totals are grouped in SQL; replies for superseded criteria are dropped
+    function updateReport() {
+        var generation = ++reportGeneration
+        var filter = reportFilter()
         
-        updateStatistics()
+        TimeEntryManager.aggregateAsync("project", filter, function(rows) {
+            TimeEntryManager.aggregateAsync("day", filter, function(days) {
+                if (generation !== reportGeneration) {
+                    return
+                }
+                
+                var totalMinutes = 0
+                var totalEntries = 0
+                var projectStatsArray = []
+                for (var i = 0; i < rows.length; i++) {
+                    totalMinutes += rows[i].minutes
+                    totalEntries += rows[i].entryCount
+                    projectStatsArray.push({
+                        name: rows[i].label,
+                        totalMinutes: rows[i].minutes,
+                        entryCount: rows[i].entryCount
+                    })
+                }
+                
+                reportStats = {
+                    totalMinutes: totalMinutes,
+                    totalEntries: totalEntries,
+                    uniqueDays: days.length,
+                    averagePerDay: days.length > 0 ? totalMinutes / days.length : 0,
+                    projectStats: projectStatsArray
+                }
+                
+                updateStatistics()
+            })
+        })
     }
 
     function updateStatistics() {
@@ -218,7 +186,7 @@ Item {
                         id: startDateField
                         Layout.preferredWidth: 150
                         placeholderText: "YYYY-MM-DD"
-                        onTextChanged: filterEntries()
+                        onTextChanged: updateReport()
                     }
                     
                     Label { text: qsTr("To:") }
@@ -226,7 +194,7 @@ Item {
                         id: endDateField
                         Layout.preferredWidth: 150
                         placeholderText: "YYYY-MM-DD"
-                        onTextChanged: filterEntries()
+                        onTextChanged: updateReport()
                     }
                 }
 
@@ -251,7 +219,7 @@ Item {
                             checked: model.selected
                             onCheckedChanged: {
                                 projectsListModel.setProperty(index, "selected", checked)
-                                filterEntries()
+                                updateReport()
                             }
                         }
                     }
@@ -349,7 +317,6 @@ Item {
     onVisibleChanged: {
         if (visible) {
             loadData()
-            filterEntries()
         }
     }
 }
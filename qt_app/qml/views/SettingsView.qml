@@ -8,6 +8,9 @@ Item {
 
     property bool showBleDevices: false
     property bool bleAvailable: false
+    // BleManager's cached registry snapshot; the list below lives in a
+    // Component, so it binds to this rather than to a model id
+    property var monitoredDevices: []
 
     Component.onCompleted: {
         checkBleAvailability()
@@ -20,13 +23,14 @@ Item {
 
     function loadBleDevices() {
         if (!bleAvailable) return
-        /*
-        monitoredDevicesModel.clear()
-        var devices = BleManager.getMonitoredDevices()
-        for (var i = 0; i < devices.length; i++) {
-            monitoredDevicesModel.append(devices[i])
+        monitoredDevices = BleManager.getMonitoredDevices()
+    }
+
+    Connections {
+        target: bleAvailable ? BleManager : null
+        function onMonitoredDevicesChanged() {
+            loadBleDevices()
         }
-        */
     }
 
     StackView {
@@ -197,14 +201,12 @@ Item {
                         ListView {
                             Layout.fillWidth: true
                             Layout.fillHeight: true
-                            model: ListModel {
-                                id: monitoredDevicesModel
-                            }
+                            model: root.monitoredDevices
                             clip: true
                             
                             delegate: ItemDelegate {
                                 width: ListView.view.width
-                                text: model.name + " (" + model.address + ")"
+                                text: modelData.name + " (" + modelData.address + ")"
                                 
                                 RowLayout {
                                     anchors.right: parent.right
@@ -214,8 +216,7 @@ Item {
                                     Button {
                                         text: qsTr("Remove")
                                         onClicked: {
-                                            BleManager.removeMonitoredDevice(model.id)
-                                            loadBleDevices()
+                                            BleManager.removeMonitoredDevice(modelData.id)
                                         }
                                     }
                                 }
@@ -274,10 +275,7 @@ Item {
                                     Button {
                                         text: qsTr("Add")
                                         onClicked: {
-                                            if (BleManager.addMonitoredDevice(model.name, model.address, "generic")) {
-                                                loadBleDevices()
-                                                // Show success message
-                                            }
+                                            BleManager.addMonitoredDevice(model.name, model.address, "generic")
                                         }
                                     }
                                 }
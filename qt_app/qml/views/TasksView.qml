@@ -25,11 +25,31 @@ Item {
         }
     }
 
+    Connections {
+        target: TimeEntryManager
+        function onTimeEntriesChanged() {
+            loadTasks()
+            filterTasks()
+        }
+    }
+
+    // Progress for every task comes from one cached stats call
     function loadTasks() {
         tasksModel.clear()
         var tasks = TaskManager.getAllTasks()
-        for (var i = 0; i < tasks.length; i++) {
-            tasksModel.append(tasks[i])
+        var stats = TaskManager.getAllTaskStats()
+        var byTask = {}
+        for (var i = 0; i < stats.length; i++) {
+            byTask[stats[i].taskId] = stats[i]
+        }
+        for (var j = 0; j < tasks.length; j++) {
+            var taskStats = byTask[tasks[j].id] || {}
+            tasks[j].spentMinutes = taskStats.spentMinutes || 0
+            tasks[j].percentUsed = taskStats.percentUsed || 0
+            tasks[j].subtaskTotal = taskStats.subtaskTotal || 0
+            tasks[j].subtaskDone = taskStats.subtaskDone || 0
+            tasks[j].overdue = taskStats.overdue || false
+            tasksModel.append(tasks[j])
         }
     }
 
@@ -165,6 +185,26 @@ Item {
                                 font.pixelSize: 12
                                 color: "gray"
                             }
+                            Label {
+                                text: model.allocatedMinutes > 0
+                                      ? qsTr("Spent: %1 of %2 min (%3%)").arg(model.spentMinutes).arg(model.allocatedMinutes).arg(Math.round(model.percentUsed))
+                                      : qsTr("Spent: %1 min").arg(model.spentMinutes)
+                                font.pixelSize: 12
+                                color: model.percentUsed > 100 ? "#f44336" : "gray"
+                            }
+                            Label {
+                                visible: model.subtaskTotal > 0
+                                text: qsTr("Subtasks: %1/%2").arg(model.subtaskDone).arg(model.subtaskTotal)
+                                font.pixelSize: 12
+                                color: "gray"
+                            }
+                            Label {
+                                visible: model.overdue
+                                text: qsTr("Overdue")
+                                font.pixelSize: 12
+                                font.bold: true
+                                color: "#f44336"
+                            }
                         }
                     }
                 }
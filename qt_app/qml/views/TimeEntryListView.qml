@@ -6,18 +6,14 @@ import ProjectTimeTracker 1.0
 Item {
     id: root
 
+    // Ids ticked for bulk deletion
+    property var selectedIds: ({})
+    property int selectedCount: 0
+
     Component.onCompleted: {
-        loadTimeEntries()
         loadProjects()
     }
 
-    Connections {
-        target: TimeEntryManager
-        function onTimeEntriesChanged() {
-            loadTimeEntries()
-        }
-    }
-
     Connections {
         target: ProjectManager
         function onProjectsChanged() {
@@ -25,15 +21,6 @@ Item {
         }
     }
 
-    function loadTimeEntries() {
-        entriesModel.clear()
-        var entries = TimeEntryManager.getAllTimeEntries()
-        for (var i = 0; i < entries.length; i++) {
-            entriesModel.append(entries[i])
-        }
-        filterEntries()
-    }
-
     function loadProjects() {
         projectsModel.clear()
         var projects = ProjectManager.getAllProjects()
@@ -42,58 +29,45 @@ Item {
         }
     }
 
-    function filterEntries() {
-        filteredEntriesModel.clear()
-        var totalDuration = 0
-        
-        for (var i = 0; i < entriesModel.count; i++) {
-            var entry = entriesModel.get(i)
-            var include = true
-            
-            // Filter by project
-            if (projectFilterCombo.currentIndex > 0) {
-                var selectedProject = projectsModel.get(projectFilterCombo.currentIndex - 1)
-                if (parseInt(entry.project_id) !== parseInt(selectedProject.id)) {
-                    include = false
-                }
-            }
-            
-            // Filter by description
-            if (descriptionFilter.text && entry.description) {
-                if (entry.description.toLowerCase().indexOf(descriptionFilter.text.toLowerCase()) < 0) {
-                    include = false
-                }
-            }
-            
-            // Filter by start date
-            if (startDateFilter.text) {
-                var entryDate = Qt.formatDate(new Date(entry.start_time), "yyyy-MM-dd")
-                if (entryDate < startDateFilter.text) {
-                    include = false
-                }
-            }
-            
-            // Filter by end date
-            if (endDateFilter.text) {
-                var entryDate = Qt.formatDate(new Date(entry.start_time), "yyyy-MM-dd")
-                if (entryDate > endDateFilter.text) {
-                    include = false
-                }
-            }
-            
-            if (include) {
-                filteredEntriesModel.append(entry)
-                totalDuration += entry.duration || 0
+    function projectName(projectId) {
+        for (var i = 0; i < projectsModel.count; i++) {
+            if (parseInt(projectsModel.get(i).id) === parseInt(projectId)) {
+                return projectsModel.get(i).name
             }
         }
-        
-        updateSummary(filteredEntriesModel.count, totalDuration)
+        return ""
+    }
+
+    // Filtering runs in SQL; the model pages in matching rows as the list scrolls
+    function filterEntries() {
+        var filter = {}
+        var datePattern = /^\d{4}-\d{2}-\d{2}$/
+
+        if (projectFilterCombo.currentIndex > 0) {
+            filter.projectId = parseInt(projectsModel.get(projectFilterCombo.currentIndex - 1).id)
+        }
+        if (datePattern.test(startDateFilter.text)) {
+            filter.start = startDateFilter.text + "T00:00:00"
+        }
+        if (datePattern.test(endDateFilter.text)) {
+            filter.end = endDateFilter.text + "T23:59:59"
+        }
+        if (descriptionFilter.text) {
+            filter.description = descriptionFilter.text
+        }
+
+        entriesModel.filter = filter
     }
 
-    function updateSummary(count, totalDuration) {
-        var hours = Math.floor(totalDuration / 60)
-        var minutes = totalDuration % 60
-        summaryLabel.text = count + qsTr(" entries • Total: ") + hours + "h " + minutes + "m"
+    function setSelected(entryId, selected) {
+        var ids = selectedIds
+        if (selected) {
+            ids[entryId] = true
+        } else {
+            delete ids[entryId]
+        }
+        selectedIds = ids
+        selectedCount = Object.keys(ids).length
     }
 
     function clearFilters() {
@@ -200,10 +174,31 @@ Item {
             color: "#e3f2fd"
             radius: 6
 
+            Button {
+                anchors.right: parent.right
+                anchors.rightMargin: 6
+                anchors.verticalCenter: parent.verticalCenter
+                visible: selectedCount > 0
+                text: qsTr("Delete Selected (%1)").arg(selectedCount)
+                onClicked: {
+                    var ids = []
+                    for (var id in selectedIds) {
+                        ids.push(parseInt(id))
+                    }
+                    deleteDialog.entryIds = ids
+                    deleteDialog.open()
+                }
+            }
+
             Label {
                 id: summaryLabel
                 anchors.centerIn: parent
                 font.bold: true
+                text: {
+                    var hours = Math.floor(entriesModel.totalMinutes / 60)
+                    var minutes = entriesModel.totalMinutes % 60
+                    return entriesModel.totalCount + qsTr(" entries • Total: ") + hours + "h " + minutes + "m"
+                }
             }
         }
 
@@ -215,8 +210,8 @@ Item {
 
             ListView {
                 id: entriesListView
-                model: ListModel {
-                    id: filteredEntriesModel
+                model: TimeEntryListModel {
+                    id: entriesModel
                 }
                 spacing: 5
                 
@@ -234,12 +229,17 @@ Item {
                         anchors.margins: 10
                         spacing: 10
 
+                        CheckBox {
+                            checked: selectedIds[model.id] === true
+                            onToggled: setSelected(model.id, checked)
+                        }
+
                         ColumnLayout {
                             Layout.fillWidth: true
                             spacing: 2
 
                             Label {
-                                text: model.project_name || qsTr("Unknown Project")
+                                text: projectName(model.projectId) || qsTr("Unknown Project")
                                 font.bold: true
                                 font.pixelSize: 14
                             }
@@ -251,7 +251,7 @@ Item {
                             }
                             
                             Label {
-                                text: Qt.formatDateTime(new Date(model.start_time), "MMM dd, yyyy hh:mm")
+                                text: Qt.formatDateTime(new Date(model.startTime), "MMM dd, yyyy hh:mm")
                                 font.pixelSize: 11
                                 color: "gray"
                             }
@@ -271,9 +271,10 @@ Item {
                             text: qsTr("Edit")
                             onClicked: {
                                 editDialog.entryId = model.id
-                                editDialog.projectId = model.project_id
+                                editDialog.projectId = model.projectId
+                                editDialog.taskId = model.taskId
                                 editDialog.description = model.description || ""
-                                editDialog.startTime = model.start_time
+                                editDialog.startTime = model.startTime
                                 editDialog.duration = model.duration
                                 editDialog.open()
                             }
@@ -282,7 +283,7 @@ Item {
                         Button {
                             text: qsTr("Delete")
                             onClicked: {
-                                deleteDialog.entryId = model.id
+                                deleteDialog.entryIds = [model.id]
                                 deleteDialog.open()
                             }
                         }
@@ -303,6 +304,7 @@ Item {
 
         property int entryId: -1
         property var projectId: ""
+        property var taskId: 0
         property string description: ""
         property string startTime: ""
         property int duration: 0
@@ -344,14 +346,31 @@ Item {
                 stepSize: 5
                 value: editDialog.duration
             }
+
+            Label {
+                Layout.fillWidth: true
+                visible: editDialog.visible && editDialog.startTime !== ""
+                         && TimeEntryManager.hasOverlap(editDialog.startTime, editDialog.endTimeFor(editDurationSpinBox.value), editDialog.entryId)
+                text: qsTr("This entry overlaps another time entry and cannot be saved.")
+                color: "#d32f2f"
+                wrapMode: Text.WordWrap
+            }
+        }
+
+        function endTimeFor(minutes) {
+            var start = new Date(startTime)
+            return Qt.formatDateTime(new Date(start.getTime() + minutes * 60000), "yyyy-MM-ddThh:mm:ss")
         }
 
         onAccepted: {
             var entryData = {
                 "projectId": projectsModel.get(editProjectCombo.currentIndex).id,
+                "taskId": editDialog.taskId > 0 ? editDialog.taskId : null,
                 "description": editDescriptionField.text,
                 "duration": editDurationSpinBox.value,
-                "startTime": editDialog.startTime
+                "startTime": editDialog.startTime,
+                "endTime": editDialog.endTimeFor(editDurationSpinBox.value),
+                "rejectOverlap": true
             }
             TimeEntryManager.updateTimeEntry(entryId, entryData)
         }
@@ -365,14 +384,20 @@ Item {
         standardButtons: Dialog.Yes | Dialog.No
         anchors.centerIn: parent
 
-        property int entryId: -1
+        property var entryIds: []
 
         Label {
-            text: qsTr("Are you sure you want to delete this time entry?")
+            text: deleteDialog.entryIds.length === 1
+                  ? qsTr("Are you sure you want to delete this time entry?")
+                  : qsTr("Are you sure you want to delete %1 time entries?").arg(deleteDialog.entryIds.length)
         }
 
+        // One transaction and one change batch however many rows are selected
         onAccepted: {
-            TimeEntryManager.deleteTimeEntry(entryId)
+            TimeEntryManager.deleteTimeEntries(entryIds)
+            for (var i = 0; i < entryIds.length; i++) {
+                setSelected(entryIds[i], false)
+            }
         }
     }
 
@@ -381,10 +406,6 @@ Item {
         id: projectsModel
     }
 
-    ListModel {
-        id: entriesModel
-    }
-
     // Update project filter when projects change
     Connections {
         target: projectsModel
@@ -402,7 +423,6 @@ Item {
 
     onVisibleChanged: {
         if (visible) {
-            loadTimeEntries()
             loadProjects()
         }
     }
@@ -1,5 +1,11 @@
 #include "ble/blemanager.h"
+#include "database/database.h"
+#include "database/statements.h"
+#include <QBluetoothAddress>
+#include <QSqlQuery>
+#include <QSqlError>
 #include <QDebug>
+#include <algorithm>
 
 BleManager::BleManager(QObject *parent)
     : QObject(parent)
@@ -17,6 +23,7 @@ BleManager::BleManager(QObject *parent)
     */
 
     checkBluetoothAvailability();
+    loadMonitoredDevices();
 }
 
 BleManager::~BleManager()
@@ -41,6 +48,7 @@ void BleManager::startScan()
     }
     
     m_discoveredDevices.clear();
+    m_discoveredByUuid.clear();
     m_scanning = true;
     emit scanningChanged();
     
@@ -63,7 +71,9 @@ void BleManager::stopScan()
 QVariantList BleManager::getDiscoveredDevices()
 {
     QVariantList result;
-    for (const auto &device : m_discoveredDevices) {
+    QList<QBluetoothDeviceInfo> devices = m_discoveredDevices.values();
+    devices += m_discoveredByUuid.values();
+    for (const auto &device : std::as_const(devices)) {
         QVariantMap deviceMap;
         deviceMap["name"] = device.name();
         deviceMap["address"] = device.address().toString();
@@ -75,37 +85,168 @@ QVariantList BleManager::getDiscoveredDevices()
 
 bool BleManager::addMonitoredDevice(const QString &name, const QString &address, const QString &deviceType)
 {
-    // TODO: Add to database
-    qInfo() << "[BLE] Adding monitored device:" << name << address;
+    const quint64 key = addressKey(address);
+    if (key == 0) {
+        emit error(tr("Invalid Bluetooth address: %1").arg(address));
+        return false;
+    }
+    
+    // Adding a device again updates its name and type. The address is
+    // stored in QBluetoothAddress's canonical form so lookups by key and by
+    // the UNIQUE column agree
+    const QString macAddress = QBluetoothAddress(key).toString();
+    QSqlQuery query(Database::instance()->database());
+    query.prepare(Statements::UPSERT_BLE_DEVICE);
+    query.bindValue(":name", name);
+    query.bindValue(":mac", macAddress);
+    query.bindValue(":type", deviceType.isEmpty() ? QStringLiteral("unknown") : deviceType);
+    
+    if (!query.exec()) {
+        emit error(query.lastError().text());
+        return false;
+    }
+    
+    // lastInsertId is not reliable when the upsert updated an existing row
+    query.prepare(Statements::BLE_DEVICE_ID_BY_MAC);
+    query.bindValue(":mac", macAddress);
+    if (!query.exec() || !query.next()) {
+        emit error(query.lastError().text());
+        return false;
+    }
+    
+    QVariantMap device;
+    device["id"] = query.value(0).toInt();
+    device["name"] = name;
+    device["address"] = macAddress;
+    device["deviceType"] = deviceType.isEmpty() ? QStringLiteral("unknown") : deviceType;
+    device["isEnabled"] = true;
+    m_monitoredDevices.insert(device.value("id").toInt(), device);
+    m_monitoredAddresses.insert(key);
+    rebuildMonitoredSnapshot();
+    
+    qInfo() << "[BLE] Adding monitored device:" << name << macAddress;
+    emit monitoredDevicesChanged();
     return true;
 }
 
 bool BleManager::removeMonitoredDevice(int deviceId)
 {
-    // TODO: Remove from database
+    QSqlQuery query(Database::instance()->database());
+    query.prepare(Statements::DELETE_BLE_DEVICE);
+    query.bindValue(":id", deviceId);
+    
+    if (!query.exec()) {
+        emit error(query.lastError().text());
+        return false;
+    }
+    
+    const QVariantMap device = m_monitoredDevices.take(deviceId);
+    if (!device.isEmpty()) {
+        m_monitoredAddresses.remove(addressKey(device.value("address").toString()));
+        rebuildMonitoredSnapshot();
+        emit monitoredDevicesChanged();
+    }
     return true;
 }
 
 QVariantList BleManager::getMonitoredDevices()
 {
-    QVariantList result;
-    // TODO: Load from database
-    return result;
+    return m_monitoredSnapshot;
 }
 
-bool BleManager::isDeviceDetected(const QString &address)
+bool BleManager::loadMonitoredDevices()
 {
-    for (const auto &device : m_discoveredDevices) {
-        if (device.address().toString() == address) {
-            return true;
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    if (!query.exec(Statements::ALL_BLE_DEVICES)) {
+        qWarning() << "[BLE] Failed to load monitored devices:" << query.lastError().text();
+        return false;
+    }
+    
+    m_monitoredDevices.clear();
+    m_monitoredAddresses.clear();
+    // Rows written before addresses were normalized, by id
+    QHash<int, QString> renamed;
+    while (query.next()) {
+        const QString stored = query.value(2).toString();
+        const quint64 key = addressKey(stored);
+        const QString macAddress = key != 0 ? QBluetoothAddress(key).toString() : stored;
+        
+        QVariantMap device;
+        device["id"] = query.value(0).toInt();
+        device["name"] = query.value(1).toString();
+        device["address"] = macAddress;
+        device["deviceType"] = query.value(3).toString();
+        device["isEnabled"] = query.value(4).toBool();
+        m_monitoredDevices.insert(device.value("id").toInt(), device);
+        
+        if (macAddress != stored) {
+            renamed.insert(device.value("id").toInt(), macAddress);
+        }
+        if (key != 0 && device.value("isEnabled").toBool()) {
+            m_monitoredAddresses.insert(key);
+        }
+    }
+    
+    // Rewrite them so the upsert's conflict on mac_address finds them
+    for (auto it = renamed.cbegin(); it != renamed.cend(); ++it) {
+        query.prepare(Statements::UPDATE_BLE_DEVICE_MAC);
+        query.bindValue(":mac", it.value());
+        query.bindValue(":id", it.key());
+        if (!query.exec()) {
+            qWarning() << "[BLE] Failed to normalize device address" << it.value() << ":" << query.lastError().text();
         }
     }
-    return false;
+    
+    rebuildMonitoredSnapshot();
+    qInfo() << "[BLE] Loaded" << m_monitoredDevices.size() << "monitored devices";
+    return true;
+}
+
+void BleManager::rebuildMonitoredSnapshot()
+{
+    QList<QVariantMap> devices = m_monitoredDevices.values();
+    std::sort(devices.begin(), devices.end(), [](const QVariantMap &a, const QVariantMap &b) {
+        return a.value("name").toString().localeAwareCompare(b.value("name").toString()) < 0;
+    });
+    
+    m_monitoredSnapshot.clear();
+    for (const QVariantMap &device : std::as_const(devices)) {
+        m_monitoredSnapshot.append(device);
+    }
+}
+
+bool BleManager::isDeviceDetected(const QString &address)
+{
+    return m_discoveredDevices.contains(addressKey(address));
+}
+
+quint64 BleManager::addressKey(const QString &address)
+{
+    return QBluetoothAddress(address).toUInt64();
 }
 
 void BleManager::onDeviceDiscovered(const QBluetoothDeviceInfo &device)
 {
-    m_discoveredDevices.append(device);
+    // A device advertises many times per scan; only the first advert is news.
+    // Apple platforms hide the MAC and report a null address, so there the
+    // per-host device UUID tells devices apart
+    const quint64 key = device.address().toUInt64();
+    if (key == 0) {
+        auto it = m_discoveredByUuid.find(device.deviceUuid());
+        if (it != m_discoveredByUuid.end()) {
+            it.value() = device;
+            return;
+        }
+        m_discoveredByUuid.insert(device.deviceUuid(), device);
+    } else {
+        auto it = m_discoveredDevices.find(key);
+        if (it != m_discoveredDevices.end()) {
+            it.value() = device;
+            return;
+        }
+        m_discoveredDevices.insert(key, device);
+    }
     
     QVariantMap deviceMap;
     deviceMap["name"] = device.name();
@@ -113,9 +254,10 @@ void BleManager::onDeviceDiscovered(const QBluetoothDeviceInfo &device)
     deviceMap["rssi"] = device.rssi();
     
     emit deviceDiscovered(deviceMap);
-    emit deviceDetected(device.address().toString());
-    
-    qInfo() << "[BLE] Device discovered:" << device.name() << device.address().toString();
+    if (key != 0 && m_monitoredAddresses.contains(key)) {
+        emit deviceDetected(device.address().toString());
+        qInfo() << "[BLE] Monitored device detected:" << device.name() << device.address().toString();
+    }
 }
 
 void BleManager::onScanFinished()
@@ -123,7 +265,7 @@ void BleManager::onScanFinished()
     m_scanning = false;
     emit scanningChanged();
     emit scanFinished();
-    qInfo() << "[BLE] Scan finished, found" << m_discoveredDevices.size() << "devices";
+    qInfo() << "[BLE] Scan finished, found" << m_discoveredDevices.size() + m_discoveredByUuid.size() << "devices";
 }
 
 void BleManager::onScanError(QBluetoothDeviceDiscoveryAgent::Error error)
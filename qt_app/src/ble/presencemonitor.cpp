@@ -1,8 +1,11 @@
 #include "ble/presencemonitor.h"
 #include "ble/blemanager.h"
 #include "database/database.h"
+#include "database/statements.h"
+#include "database/writequeue.h"
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QPointer>
 #include <QDebug>
 
 const int PresenceMonitor::SCAN_INTERVAL_MS = 60000;  // 60 seconds
@@ -18,6 +21,9 @@ PresenceMonitor::PresenceMonitor(BleManager *bleManager, QObject *parent)
     , m_saveTimer(new QTimer(this))
     , m_active(false)
     , m_inOffice(false)
+    , m_sessionRowId(0)
+    , m_sessionInsertQueued(false)
+    , m_sessionSerial(0)
 {
     connect(m_scanTimer, &QTimer::timeout, this, &PresenceMonitor::onPeriodicScan);
     connect(m_timeoutTimer, &QTimer::timeout, this, &PresenceMonitor::checkSessionTimeout);
@@ -61,7 +67,7 @@ void PresenceMonitor::stop()
     
     if (m_inOffice) {
         saveCurrentSession();
-        m_inOffice = false;
+        endSession();
         emit inOfficeChanged();
     }
     
@@ -103,6 +109,9 @@ void PresenceMonitor::onDeviceDetected(const QString &address)
     if (!m_inOffice) {
         m_inOffice = true;
         m_sessionStartTime = m_lastDeviceDetection;
+        m_sessionRowId = 0;
+        m_sessionInsertQueued = false;
+        ++m_sessionSerial;
         emit inOfficeChanged();
         emit sessionStarted();
         m_saveTimer->start();
@@ -130,7 +139,7 @@ void PresenceMonitor::checkSessionTimeout()
     int secondsSinceLastDetection = m_lastDeviceDetection.secsTo(QDateTime::currentDateTime());
     if (secondsSinceLastDetection * 1000 > TIMEOUT_MS) {
         saveCurrentSession();
-        m_inOffice = false;
+        endSession();
         m_saveTimer->stop();
         emit inOfficeChanged();
         emit sessionEnded(sessionDuration());
@@ -138,6 +147,15 @@ void PresenceMonitor::checkSessionTimeout()
     }
 }
 
+void PresenceMonitor::endSession()
+{
+    m_inOffice = false;
+    m_sessionRowId = 0;
+    m_sessionInsertQueued = false;
+}
+
+// The first save inserts the session's row; later saves update that row, so
+// one session is one row however often it is saved
 void PresenceMonitor::saveCurrentSession()
 {
     if (!m_inOffice || !m_sessionStartTime.isValid()) {
@@ -149,20 +167,50 @@ void PresenceMonitor::saveCurrentSession()
         return;
     }
     
-    // Save session to database
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("INSERT INTO office_presence (date, start_time, end_time, duration) VALUES (:date, :start, :end, :duration)");
-    query.bindValue(":date", m_sessionStartTime.date().toString(Qt::ISODate));
-    query.bindValue(":start", m_sessionStartTime.toString(Qt::ISODate));
-    query.bindValue(":end", QDateTime::currentDateTime().toString(Qt::ISODate));
-    query.bindValue(":duration", duration);
+    WriteQueue *writeQueue = Database::instance()->writeQueue();
+    if (m_sessionInsertQueued && m_sessionRowId == 0) {
+        // The row id arrives with the INSERT's commit
+        Database::instance()->flushPendingWrites();
+    }
     
-    if (!query.exec()) {
-        qWarning() << "[PRESENCE MONITOR] Failed to save session:" << query.lastError().text();
+    QVariantMap bindings;
+    bindings[":end"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    bindings[":duration"] = duration;
+    
+    if (m_sessionRowId > 0) {
+        bindings[":id"] = m_sessionRowId;
+        writeQueue->enqueue(
+            Statements::UPDATE_PRESENCE_SESSION,
+            bindings, [duration](bool success, const QVariant &, const QString &errorMessage) {
+            if (!success) {
+                qWarning() << "[PRESENCE MONITOR] Failed to update session:" << errorMessage;
+                return;
+            }
+            qInfo() << "[PRESENCE MONITOR] Updated session, duration:" << duration << "minutes";
+        });
         return;
     }
     
-    qInfo() << "[PRESENCE MONITOR] Saved session, duration:" << duration << "minutes";
+    bindings[":date"] = m_sessionStartTime.date().toString(Qt::ISODate);
+    bindings[":start"] = m_sessionStartTime.toString(Qt::ISODate);
+    m_sessionInsertQueued = true;
+    QPointer<PresenceMonitor> self(this);
+    const int serial = m_sessionSerial;
+    writeQueue->enqueue(
+        Statements::INSERT_PRESENCE_SESSION,
+        bindings, [self, serial, duration](bool success, const QVariant &lastInsertId, const QString &errorMessage) {
+        if (!self || self->m_sessionSerial != serial) {
+            return;
+        }
+        if (!success) {
+            // Try inserting again on the next save
+            self->m_sessionInsertQueued = false;
+            qWarning() << "[PRESENCE MONITOR] Failed to save session:" << errorMessage;
+            return;
+        }
+        self->m_sessionRowId = lastInsertId.toLongLong();
+        qInfo() << "[PRESENCE MONITOR] Saved session, duration:" << duration << "minutes";
+    });
 }
 
 QVariantList PresenceMonitor::getTodayPresence()
@@ -170,8 +218,9 @@ QVariantList PresenceMonitor::getTodayPresence()
     QDate today = QDate::currentDate();
     QVariantList result;
     
+    Database::instance()->flushPendingWrites({ "office_presence" });
     QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, start_time, end_time, duration FROM office_presence WHERE date = :date ORDER BY start_time");
+    query.prepare(Statements::PRESENCE_BY_DATE);
     query.bindValue(":date", today.toString(Qt::ISODate));
     
     if (!query.exec()) {
@@ -195,8 +244,9 @@ QVariantList PresenceMonitor::getPresenceByDate(const QDateTime &date)
 {
     QVariantList result;
     
+    Database::instance()->flushPendingWrites({ "office_presence" });
     QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, start_time, end_time, duration FROM office_presence WHERE date = :date ORDER BY start_time");
+    query.prepare(Statements::PRESENCE_BY_DATE);
     query.bindValue(":date", date.date().toString(Qt::ISODate));
     
     if (!query.exec()) {
@@ -220,8 +270,9 @@ int PresenceMonitor::getTotalMinutesToday()
 {
     QDate today = QDate::currentDate();
     
+    Database::instance()->flushPendingWrites({ "office_presence" });
     QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT SUM(duration) FROM office_presence WHERE date = :date");
+    query.prepare(Statements::PRESENCE_TOTAL_BY_DATE);
     query.bindValue(":date", today.toString(Qt::ISODate));
     
     if (!query.exec()) {
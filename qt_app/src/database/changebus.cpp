@@ -0,0 +1,204 @@
+#include "database/changebus.h"
+#include "database/sqliteapi.h"
+#include <QMetaObject>
+#include <QDebug>
+#include <utility>
+
+#ifdef HAVE_SQLITE3_API
+#include <sqlite3.h>
+#endif
+
+const int ChangeBus::MAX_ROWS_PER_TABLE = 10000;
+
+namespace {
+
+// Folds a new change into the operation already pending for the same row.
+// Returns false when the two cancel out (a row inserted then deleted).
+bool combine(RowChange::Operation &pending, RowChange::Operation next)
+{
+    if (pending == RowChange::Insert && next == RowChange::Delete) {
+        return false;
+    }
+    if (pending == RowChange::Insert) {
+        return true;
+    }
+    if (pending == RowChange::Delete && next == RowChange::Insert) {
+        // Row id reused within the same turn
+        pending = RowChange::Update;
+        return true;
+    }
+    pending = next;
+    return true;
+}
+
+} // namespace
+
+ChangeBus::ChangeBus(QObject *parent)
+    : QObject(parent)
+    , m_handle(nullptr)
+    , m_deliveryScheduled(false)
+{
+    qRegisterMetaType<RowChange>();
+    qRegisterMetaType<QList<RowChange>>();
+}
+
+ChangeBus::~ChangeBus()
+{
+    detach();
+}
+
+bool ChangeBus::attach(const QSqlDatabase &db)
+{
+#ifdef HAVE_SQLITE3_API
+    detach();
+    m_handle = SqliteApi::nativeHandle(db);
+    if (!m_handle) {
+        return false;
+    }
+    sqlite3_update_hook(m_handle, &ChangeBus::updateHook, this);
+    sqlite3_commit_hook(m_handle, &ChangeBus::commitHook, this);
+    sqlite3_rollback_hook(m_handle, &ChangeBus::rollbackHook, this);
+    return true;
+#else
+    Q_UNUSED(db);
+    return false;
+#endif
+}
+
+void ChangeBus::detach()
+{
+#ifdef HAVE_SQLITE3_API
+    if (m_handle) {
+        sqlite3_update_hook(m_handle, nullptr, nullptr);
+        sqlite3_commit_hook(m_handle, nullptr, nullptr);
+        sqlite3_rollback_hook(m_handle, nullptr, nullptr);
+    }
+#endif
+    m_handle = nullptr;
+    discardUncommitted();
+}
+
+void ChangeBus::record(const QString &table, RowChange::Operation operation, qint64 rowId)
+{
+    recordUncommitted(table, operation, rowId);
+    commitPending();
+}
+
+void ChangeBus::recordUncommitted(const QString &table, RowChange::Operation operation, qint64 rowId)
+{
+    if (m_uncommittedResets.contains(table)) {
+        return;
+    }
+    int &count = m_uncommittedCounts[table];
+    if (++count <= MAX_ROWS_PER_TABLE) {
+        m_uncommitted.append({ table, operation, rowId });
+        return;
+    }
+    // A bulk write inside one transaction; keep a single Reset for the table
+    // instead of every row until the transaction ends
+    m_uncommitted.removeIf([&table](const RowChange &change) { return change.table == table; });
+    m_uncommitted.append({ table, RowChange::Reset, -1 });
+    m_uncommittedResets.insert(table);
+}
+
+void ChangeBus::flush()
+{
+    if (!m_pendingTables.isEmpty() || !m_resetTables.isEmpty()) {
+        deliver();
+    }
+}
+
+void ChangeBus::commitPending()
+{
+    for (const RowChange &change : std::as_const(m_uncommitted)) {
+        if (!m_pending.contains(change.table) && !m_resetTables.contains(change.table)) {
+            m_pendingTables.append(change.table);
+        }
+        if (m_resetTables.contains(change.table)) {
+            continue;
+        }
+        QHash<qint64, RowChange::Operation> &rows = m_pending[change.table];
+        auto it = rows.find(change.rowId);
+        if (change.operation == RowChange::Reset) {
+            rows.clear();
+            m_resetTables.insert(change.table);
+        } else if (it == rows.end()) {
+            rows.insert(change.rowId, change.operation);
+        } else if (!combine(it.value(), change.operation)) {
+            rows.erase(it);
+        }
+        if (rows.size() > MAX_ROWS_PER_TABLE) {
+            rows.clear();
+            m_resetTables.insert(change.table);
+        }
+    }
+    discardUncommitted();
+    scheduleDelivery();
+}
+
+void ChangeBus::discardUncommitted()
+{
+    m_uncommitted.clear();
+    m_uncommittedCounts.clear();
+    m_uncommittedResets.clear();
+}
+
+void ChangeBus::scheduleDelivery()
+{
+    if (m_deliveryScheduled || (m_pendingTables.isEmpty() && m_resetTables.isEmpty())) {
+        return;
+    }
+    m_deliveryScheduled = true;
+    QMetaObject::invokeMethod(this, &ChangeBus::deliver, Qt::QueuedConnection);
+}
+
+void ChangeBus::deliver()
+{
+    m_deliveryScheduled = false;
+
+    QList<RowChange> changes;
+    for (const QString &table : std::as_const(m_pendingTables)) {
+        if (m_resetTables.contains(table)) {
+            changes.append({ table, RowChange::Reset, -1 });
+            continue;
+        }
+        const QHash<qint64, RowChange::Operation> &rows = m_pending.value(table);
+        for (auto it = rows.cbegin(); it != rows.cend(); ++it) {
+            changes.append({ table, it.value(), it.key() });
+        }
+    }
+    m_pending.clear();
+    m_pendingTables.clear();
+    m_resetTables.clear();
+
+    if (!changes.isEmpty()) {
+        emit rowsChanged(changes);
+    }
+}
+
+#ifdef HAVE_SQLITE3_API
+void ChangeBus::updateHook(void *context, int operation, const char *databaseName, const char *table, qint64 rowId)
+{
+    Q_UNUSED(databaseName);
+    ChangeBus *bus = static_cast<ChangeBus *>(context);
+    RowChange::Operation op = RowChange::Update;
+    if (operation == SQLITE_INSERT) {
+        op = RowChange::Insert;
+    } else if (operation == SQLITE_DELETE) {
+        op = RowChange::Delete;
+    }
+    bus->recordUncommitted(QString::fromUtf8(table), op, rowId);
+}
+
+int ChangeBus::commitHook(void *context)
+{
+    // The hook runs inside sqlite3_step; only bookkeeping is allowed here
+    static_cast<ChangeBus *>(context)->commitPending();
+    return 0;
+}
+
+void ChangeBus::rollbackHook(void *context)
+{
+    static_cast<ChangeBus *>(context)->discardUncommitted();
+}
+#endif
@@ -1,5 +1,9 @@
 #include "database/database.h"
 #include "database/databasemigration.h"
+#include "database/databasebackup.h"
+#include "database/onlinebackup.h"
+#include "database/writequeue.h"
+#include "database/changebus.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QStandardPaths>
@@ -8,13 +12,36 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QThread>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
 #include <QDebug>
 
-const int Database::CURRENT_DB_VERSION = 7;
+const int Database::CURRENT_DB_VERSION = 13;
 Database* Database::s_instance = nullptr;
 
+namespace {
+// Shared-cache URI so worker connections see the same in-memory database
+const char *DEMO_DATABASE_URI = "file:ptt_demo?mode=memory&cache=shared";
+QAtomicInt s_connectionCounter;
+}
+
+Database::PooledConnection::~PooledConnection()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(m_name, false);
+        if (db.isOpen()) {
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(m_name);
+}
+
 Database::Database(QObject *parent)
     : QObject(parent)
+    , m_writeQueue(new WriteQueue(this))
+    , m_changeBus(new ChangeBus(this))
     , m_initialized(false)
     , m_demoMode(false)
     , m_currentVersion(0)
@@ -24,6 +51,8 @@ Database::Database(QObject *parent)
 
 Database::~Database()
 {
+    flushPendingWrites();
+    m_changeBus->detach();
     if (m_db.isOpen()) {
         m_db.close();
     }
@@ -53,9 +82,14 @@ bool Database::initialize(const QString &dbPath)
         return true;
     }
     
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+    
     QString path;
+    QString connectOptions;
     if (m_demoMode) {
-        path = ":memory:";
+        path = DEMO_DATABASE_URI;
+        connectOptions = "QSQLITE_OPEN_URI";
         qInfo() << "Initializing in-memory database (DEMO MODE)";
     } else if (!dbPath.isEmpty()) {
         path = dbPath;
@@ -69,8 +103,12 @@ bool Database::initialize(const QString &dbPath)
         path = dataPath + "/timetracker.db";
     }
     
+    m_databasePath = path;
+    m_connectOptions = connectOptions;
+    
     m_db = QSqlDatabase::addDatabase("QSQLITE");
     m_db.setDatabaseName(path);
+    m_db.setConnectOptions(connectOptions);
     
     if (!m_db.open()) {
         qCritical() << "Failed to open database:" << m_db.lastError().text();
@@ -79,17 +117,40 @@ bool Database::initialize(const QString &dbPath)
     }
     
     qInfo() << "Connected to SQLite database at" << path;
+    m_writeQueue->setDatabase(m_db);
     
-    // Create tables if they don't exist
-    if (!createTables()) {
-        qCritical() << "Failed to create tables";
-        return false;
+    // An unchanged schema needs no DDL: one read of the stored fingerprint
+    // replaces the CREATE TABLE statements and the migration check
+    if (schemaFingerprintMatches()) {
+        m_currentVersion = CURRENT_DB_VERSION;
+        qInfo() << "Schema fingerprint matches, database ready in" << startupTimer.elapsed() << "ms";
+    } else {
+        // WAL lets pooled worker connections read while the GUI thread writes;
+        // the journal mode is persistent, so this only runs on the slow path
+        if (!m_demoMode) {
+            executeSql("PRAGMA journal_mode=WAL");
+        }
+        
+        // Create tables if they don't exist
+        if (!createTables()) {
+            qCritical() << "Failed to create tables";
+            return false;
+        }
+        
+        // Run migrations
+        if (!runMigrations()) {
+            qCritical() << "Failed to run migrations";
+            return false;
+        }
+        
+        storeSchemaFingerprint();
+        qInfo() << "Schema checked and fingerprinted, database ready in" << startupTimer.elapsed() << "ms";
     }
     
-    // Run migrations
-    if (!runMigrations()) {
-        qCritical() << "Failed to run migrations";
-        return false;
+    // Hooked after the schema work so startup DDL is not reported as changes
+    m_writeQueue->setChangeBus(m_changeBus);
+    if (!m_changeBus->attach(m_db)) {
+        qInfo() << "SQLite update hook unavailable, change bus reports queued writes only";
     }
     
     m_initialized = true;
@@ -98,6 +159,68 @@ bool Database::initialize(const QString &dbPath)
     return true;
 }
 
+QSqlDatabase Database::database() const
+{
+    if (QThread::currentThread() == thread()) {
+        return m_db;
+    }
+    
+    if (m_threadConnections.hasLocalData()) {
+        return QSqlDatabase::database(m_threadConnections.localData()->name());
+    }
+    
+    return openThreadConnection();
+}
+
+void Database::flushPendingWrites()
+{
+    if (QThread::currentThread() == thread()) {
+        m_writeQueue->flush();
+    }
+}
+
+void Database::flushPendingWrites(const QStringList &tables)
+{
+    if (QThread::currentThread() == thread() && m_writeQueue->writesPendingTo(tables)) {
+        m_writeQueue->flush();
+    }
+}
+
+QSqlDatabase Database::openThreadConnection() const
+{
+    if (m_databasePath.isEmpty()) {
+        qWarning() << "Database connection requested from worker thread before initialization";
+        return QSqlDatabase();
+    }
+    
+    const QString name = QString("ptt_worker_%1").arg(s_connectionCounter.fetchAndAddRelaxed(1));
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(m_databasePath);
+    
+    QString options = "QSQLITE_BUSY_TIMEOUT=5000";
+    if (!m_connectOptions.isEmpty()) {
+        options += ";" + m_connectOptions;
+    }
+    db.setConnectOptions(options);
+    
+    if (!db.open()) {
+        qCritical() << "Failed to open worker connection:" << db.lastError().text();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+        return QSqlDatabase();
+    }
+    
+    if (m_demoMode) {
+        // Shared-cache readers would otherwise block on the writer's table locks
+        QSqlQuery pragma(db);
+        pragma.exec("PRAGMA read_uncommitted=1");
+    }
+    
+    m_threadConnections.setLocalData(new PooledConnection(name));
+    qInfo() << "Opened pooled connection" << name << "for thread" << QThread::currentThread();
+    return db;
+}
+
 bool Database::createTables()
 {
     QStringList createStatements;
@@ -163,6 +286,83 @@ bool Database::createTables()
     return true;
 }
 
+QByteArray Database::computeSchemaHash()
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT type, name, tbl_name, sql FROM sqlite_master "
+                    "WHERE name != 'schema_fingerprint' ORDER BY type, name")) {
+        return QByteArray();
+    }
+    while (query.next()) {
+        for (int i = 0; i < 4; ++i) {
+            hash.addData(query.value(i).toString().toUtf8());
+            hash.addData(QByteArrayView("\x1f"));
+        }
+    }
+    return hash.result().toHex();
+}
+
+bool Database::schemaFingerprintMatches()
+{
+    // schema_version is SQLite's schema cookie: it changes whenever any
+    // connection alters the schema, so an equal cookie means nothing moved
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT f.db_version, f.schema_hash, f.schema_cookie, s.schema_version "
+                    "FROM schema_fingerprint f, pragma_schema_version s") || !query.next()) {
+        return false;
+    }
+    
+    if (query.value(0).toInt() != CURRENT_DB_VERSION) {
+        return false;
+    }
+    
+    if (query.value(2).toLongLong() == query.value(3).toLongLong()) {
+        return true;
+    }
+    
+    // The cookie moved (e.g. another tool touched the file): fall back to
+    // comparing the schema itself and refresh the cookie if it is unchanged
+    const QString storedHash = query.value(1).toString();
+    query.finish();
+    if (computeSchemaHash() != storedHash.toUtf8()) {
+        return false;
+    }
+    m_currentVersion = CURRENT_DB_VERSION;
+    return storeSchemaFingerprint();
+}
+
+bool Database::storeSchemaFingerprint()
+{
+    if (!executeSql("CREATE TABLE IF NOT EXISTS schema_fingerprint ("
+                    "db_version INTEGER NOT NULL, "
+                    "schema_hash TEXT NOT NULL, "
+                    "schema_cookie INTEGER NOT NULL)")) {
+        return false;
+    }
+    
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA schema_version") || !query.next()) {
+        return false;
+    }
+    const qint64 cookie = query.value(0).toLongLong();
+    query.finish();
+    
+    m_db.transaction();
+    query.exec("DELETE FROM schema_fingerprint");
+    query.prepare("INSERT INTO schema_fingerprint (db_version, schema_hash, schema_cookie) VALUES (:version, :hash, :cookie)");
+    query.bindValue(":version", m_currentVersion);
+    query.bindValue(":hash", QString::fromUtf8(computeSchemaHash()));
+    query.bindValue(":cookie", cookie);
+    if (!query.exec()) {
+        qWarning() << "Failed to store schema fingerprint:" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
+}
+
 bool Database::executeSql(const QString &sql)
 {
     QSqlQuery query(m_db);
@@ -182,7 +382,10 @@ bool Database::runMigrations()
     
     if (currentVersion < CURRENT_DB_VERSION) {
         qInfo() << "Migrating database from version" << currentVersion << "to" << CURRENT_DB_VERSION;
-        if (DatabaseMigration::migrateToVersion(m_db, CURRENT_DB_VERSION)) {
+        auto progress = [this](int step, qint64 rowsDone, qint64 rowsTotal) {
+            emit migrationProgress(step, rowsDone, rowsTotal);
+        };
+        if (DatabaseMigration::migrateToVersion(m_db, CURRENT_DB_VERSION, progress)) {
             m_currentVersion = CURRENT_DB_VERSION;
             emit versionChanged();
             return true;
@@ -195,14 +398,160 @@ bool Database::runMigrations()
 
 bool Database::backupToJson(const QString &filePath)
 {
-    // TODO: Implement backup functionality
-    qWarning() << "Backup functionality not yet implemented";
-    return false;
+    if (!m_initialized) {
+        qWarning() << "Cannot back up before the database is initialized";
+        return false;
+    }
+    
+    flushPendingWrites();
+    QString errorMessage;
+    if (!DatabaseBackup::writeJson(m_db, filePath, m_currentVersion, &errorMessage)) {
+        qCritical() << "Backup failed:" << errorMessage;
+        emit databaseError(errorMessage);
+        return false;
+    }
+    
+    return true;
 }
 
 bool Database::restoreFromJson(const QString &filePath)
 {
-    // TODO: Implement restore functionality
-    qWarning() << "Restore functionality not yet implemented";
-    return false;
+    if (!m_initialized) {
+        qWarning() << "Cannot restore before the database is initialized";
+        return false;
+    }
+    
+    flushPendingWrites();
+    QString errorMessage;
+    auto progress = [this](qint64 bytesRead, qint64 totalBytes) {
+        emit restoreProgress(bytesRead, totalBytes);
+    };
+    
+    if (!DatabaseBackup::readJson(m_db, filePath, m_currentVersion, progress, &errorMessage)) {
+        qCritical() << "Restore failed:" << errorMessage;
+        emit databaseError(errorMessage);
+        return false;
+    }
+    
+    // The load bypasses the write queue and its bulk DELETE skips the
+    // update hook, so every restored table is reported as reset
+    for (const QString &table : DatabaseBackup::backupTables()) {
+        m_changeBus->record(table, RowChange::Reset, -1);
+    }
+    m_changeBus->record("daily_project_totals", RowChange::Reset, -1);
+    
+    emit databaseRestored();
+    return true;
+}
+
+bool Database::verifyDailyTotals(bool rebuild)
+{
+    if (!m_initialized) {
+        qWarning() << "Cannot check daily totals before the database is initialized";
+        return false;
+    }
+    
+    flushPendingWrites();
+    const int mismatches = DatabaseMigration::dailyTotalsMismatches(m_db);
+    if (mismatches == 0) {
+        return true;
+    }
+    if (mismatches > 0) {
+        qWarning() << "Daily totals disagree with time entries in" << mismatches << "rows";
+    }
+    if (!rebuild) {
+        return false;
+    }
+    
+    if (!m_db.transaction()) {
+        qCritical() << "Failed to begin daily totals rebuild:" << m_db.lastError().text();
+        return false;
+    }
+    if (!DatabaseMigration::rebuildDailyTotals(m_db) || !m_db.commit()) {
+        m_db.rollback();
+        emit databaseError(tr("Could not rebuild daily totals"));
+        return false;
+    }
+    
+    qInfo() << "Daily totals rebuilt from time entries";
+    return true;
+}
+
+bool Database::verifySubtaskCounters(bool rebuild)
+{
+    if (!m_initialized) {
+        qWarning() << "Cannot check subtask counters before the database is initialized";
+        return false;
+    }
+    
+    flushPendingWrites();
+    const int mismatches = DatabaseMigration::subtaskCounterMismatches(m_db);
+    if (mismatches == 0) {
+        return true;
+    }
+    if (mismatches > 0) {
+        qWarning() << "Subtask counters disagree with subtasks on" << mismatches << "tasks";
+    }
+    if (!rebuild) {
+        return false;
+    }
+    
+    if (!m_db.transaction()) {
+        qCritical() << "Failed to begin subtask counter rebuild:" << m_db.lastError().text();
+        return false;
+    }
+    if (!DatabaseMigration::rebuildSubtaskCounters(m_db) || !m_db.commit()) {
+        m_db.rollback();
+        emit databaseError(tr("Could not rebuild subtask counters"));
+        return false;
+    }
+    
+    qInfo() << "Subtask counters rebuilt from subtasks";
+    return true;
+}
+
+bool Database::backupTo(const QString &filePath)
+{
+    if (!m_initialized) {
+        qWarning() << "Cannot back up before the database is initialized";
+        return false;
+    }
+    
+    if (isBackupRunning()) {
+        qWarning() << "A backup is already running";
+        return false;
+    }
+    
+    flushPendingWrites();
+    OnlineBackup *backup = new OnlineBackup(m_db, filePath, this);
+    connect(backup, &OnlineBackup::progress, this, &Database::backupProgress);
+    connect(backup, &OnlineBackup::finished, this, [this, backup](bool success, const QString &error) {
+        if (!success) {
+            emit databaseError(error);
+        }
+        emit backupFinished(success, error);
+        emit backupRunningChanged();
+        backup->deleteLater();
+    });
+    
+    if (!backup->start()) {
+        delete backup;
+        return false;
+    }
+    
+    m_onlineBackup = backup;
+    emit backupRunningChanged();
+    return true;
+}
+
+void Database::cancelBackup()
+{
+    if (m_onlineBackup) {
+        m_onlineBackup->cancel();
+    }
+}
+
+bool Database::isBackupRunning() const
+{
+    return m_onlineBackup && m_onlineBackup->isRunning();
 }
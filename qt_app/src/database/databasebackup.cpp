@@ -0,0 +1,505 @@
+#include "database/databasebackup.h"
+#include "database/databasemigration.h"
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QSaveFile>
+#include <QFile>
+#include <QHash>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QDebug>
+
+namespace {
+
+const char *FORMAT_NAME = "project-time-tracker-backup";
+const int ROWS_PER_BATCH = 10000;
+
+QByteArray jsonString(const QString &value)
+{
+    // Serialize through a one-element array to get correct escaping
+    QByteArray array = QJsonDocument(QJsonArray{ value }).toJson(QJsonDocument::Compact);
+    return array.mid(1, array.size() - 2);
+}
+
+bool tableExists(QSqlDatabase &db, const QString &table)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = :name");
+    query.bindValue(":name", table);
+    return query.exec() && query.next();
+}
+
+QStringList tableColumns(QSqlDatabase &db, const QString &table)
+{
+    QStringList columns;
+    QSqlQuery query(db);
+    if (query.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+        while (query.next()) {
+            columns << query.value("name").toString();
+        }
+    }
+    return columns;
+}
+
+// Pull parser over a QIODevice that hands out one JSON value at a time as
+// raw text, so a backup can be restored without loading the whole document
+class JsonStreamReader
+{
+public:
+    explicit JsonStreamReader(QIODevice *device) : m_device(device) {}
+
+    qint64 bytesRead() const { return m_consumed + m_pos; }
+    bool truncated() const { return m_truncated; }
+
+    char peek()
+    {
+        if (m_pos >= m_buffer.size() && !fill()) {
+            return '\0';
+        }
+        return m_buffer.at(m_pos);
+    }
+
+    char get()
+    {
+        const char c = peek();
+        if (c != '\0') {
+            ++m_pos;
+        }
+        return c;
+    }
+
+    void skipWhitespace()
+    {
+        char c = peek();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            ++m_pos;
+            c = peek();
+        }
+    }
+
+    bool expect(char expected)
+    {
+        skipWhitespace();
+        return get() == expected;
+    }
+
+    // Consumes a ',' separator if present; returns false on the closing bracket
+    bool nextElement(char closing)
+    {
+        skipWhitespace();
+        if (peek() == ',') {
+            get();
+            skipWhitespace();
+        }
+        if (peek() == closing) {
+            get();
+            return false;
+        }
+        if (peek() == '\0') {
+            m_truncated = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool readRawValue(QByteArray *raw)
+    {
+        raw->clear();
+        skipWhitespace();
+        const char first = peek();
+        if (first == '\0') {
+            return false;
+        }
+
+        if (first != '{' && first != '[' && first != '"') {
+            // Number, true, false or null
+            char c = peek();
+            while (c != '\0' && c != ',' && c != '}' && c != ']'
+                   && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+                raw->append(get());
+                c = peek();
+            }
+            return !raw->isEmpty();
+        }
+
+        int depth = 0;
+        bool inString = false;
+        do {
+            const char c = get();
+            if (c == '\0') {
+                return false;
+            }
+            raw->append(c);
+            if (inString) {
+                if (c == '\\') {
+                    raw->append(get());
+                } else if (c == '"') {
+                    inString = false;
+                }
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                --depth;
+            }
+        } while (depth > 0 || inString);
+
+        return true;
+    }
+
+    bool readString(QString *value)
+    {
+        QByteArray raw;
+        if (!readRawValue(&raw) || !raw.startsWith('"')) {
+            return false;
+        }
+        *value = QJsonDocument::fromJson("[" + raw + "]").array().at(0).toString();
+        return true;
+    }
+
+private:
+    bool fill()
+    {
+        if (!m_device || m_device->atEnd()) {
+            return false;
+        }
+        m_consumed += m_buffer.size();
+        m_buffer = m_device->read(BUFFER_SIZE);
+        m_pos = 0;
+        return !m_buffer.isEmpty();
+    }
+
+    static constexpr qint64 BUFFER_SIZE = 256 * 1024;
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    int m_pos = 0;
+    qint64 m_consumed = 0;
+    bool m_truncated = false;
+};
+
+// Reuses one prepared INSERT per table while the set of columns is unchanged
+class TableLoader
+{
+public:
+    TableLoader(QSqlDatabase &db, const QString &table)
+        : m_table(table), m_tableColumns(tableColumns(db, table)), m_query(db)
+    {
+    }
+
+    bool insert(const QJsonObject &row, QString *errorMessage)
+    {
+        QStringList columns;
+        for (const QString &column : m_tableColumns) {
+            if (row.contains(column)) {
+                columns << column;
+            }
+        }
+
+        if (columns != m_columns) {
+            m_columns = columns;
+            QStringList placeholders;
+            for (int i = 0; i < m_columns.size(); ++i) {
+                placeholders << "?";
+            }
+            if (!m_query.prepare(QString("INSERT INTO %1 (%2) VALUES (%3)")
+                                 .arg(m_table, m_columns.join(", "), placeholders.join(", ")))) {
+                *errorMessage = m_query.lastError().text();
+                return false;
+            }
+        }
+
+        for (int i = 0; i < m_columns.size(); ++i) {
+            m_query.bindValue(i, row.value(m_columns.at(i)).toVariant());
+        }
+
+        if (!m_query.exec()) {
+            *errorMessage = QString("%1: %2").arg(m_table, m_query.lastError().text());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    QString m_table;
+    QStringList m_tableColumns;
+    QStringList m_columns;
+    QSqlQuery m_query;
+};
+
+} // namespace
+
+QStringList DatabaseBackup::backupTables()
+{
+    return { "projects", "tasks", "subtasks", "time_entries", "ble_devices", "office_presence" };
+}
+
+bool DatabaseBackup::writeJson(QSqlDatabase &db, const QString &filePath, int schemaVersion, QString *errorMessage)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+
+    // Header; each table then follows as an array with one row object per line
+    file.write("{\n\"format\": " + jsonString(FORMAT_NAME) + ",\n");
+    file.write("\"version\": " + QByteArray::number(schemaVersion) + ",\n");
+    file.write("\"exportedAt\": " + jsonString(QDateTime::currentDateTimeUtc().toString(Qt::ISODate)) + ",\n");
+    file.write("\"tables\": {");
+
+    qint64 totalRows = 0;
+    bool firstTable = true;
+    for (const QString &table : backupTables()) {
+        if (!tableExists(db, table)) {
+            continue;
+        }
+
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        // Stored columns only; generated ones are recomputed on restore
+        if (!query.exec(QString("SELECT %1 FROM %2 ORDER BY id").arg(tableColumns(db, table).join(", "), table))) {
+            *errorMessage = query.lastError().text();
+            file.cancelWriting();
+            return false;
+        }
+
+        file.write(firstTable ? "\n" : ",\n");
+        file.write(jsonString(table) + ": [");
+        firstTable = false;
+
+        const QSqlRecord record = query.record();
+        bool firstRow = true;
+        while (query.next()) {
+            QJsonObject row;
+            for (int i = 0; i < record.count(); ++i) {
+                row.insert(record.fieldName(i), QJsonValue::fromVariant(query.value(i)));
+            }
+            file.write(firstRow ? "\n" : ",\n");
+            file.write(QJsonDocument(row).toJson(QJsonDocument::Compact));
+            firstRow = false;
+            ++totalRows;
+        }
+
+        file.write(firstRow ? "]" : "\n]");
+    }
+
+    file.write("\n}\n}\n");
+
+    if (!file.commit()) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+
+    qInfo() << "Backup written to" << filePath << "-" << totalRows << "rows";
+    return true;
+}
+
+bool DatabaseBackup::readJson(QSqlDatabase &db, const QString &filePath, int schemaVersion,
+                              const ProgressCallback &progress, QString *errorMessage)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+    const qint64 totalBytes = file.size();
+    JsonStreamReader reader(&file);
+
+    const QStringList tables = backupTables();
+    QStringList quotedTables;
+    for (const QString &table : tables) {
+        quotedTables << "'" + table + "'";
+    }
+
+    // Capture index definitions so they can be rebuilt once after the load
+    QStringList indexStatements;
+    QStringList indexNames;
+    QSqlQuery query(db);
+    if (!query.exec(QString("SELECT name, sql FROM sqlite_master WHERE type = 'index' AND sql IS NOT NULL AND tbl_name IN (%1)")
+                    .arg(quotedTables.join(", ")))) {
+        *errorMessage = query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        indexNames << query.value(0).toString();
+        indexStatements << query.value(1).toString();
+    }
+
+    // The rollup and subtask counter triggers would fire for every deleted
+    // and loaded row; they are dropped for the load and the derived data
+    // rebuilt once at the end
+    QStringList triggerStatements;
+    QStringList triggerNames;
+    if (!query.exec(QString("SELECT name, sql FROM sqlite_master WHERE type = 'trigger' AND tbl_name IN (%1)")
+                    .arg(quotedTables.join(", ")))) {
+        *errorMessage = query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        triggerNames << query.value(0).toString();
+        triggerStatements << query.value(1).toString();
+    }
+
+    // The whole restore is one transaction: a malformed file leaves the
+    // database untouched
+    if (!db.transaction()) {
+        *errorMessage = db.lastError().text();
+        return false;
+    }
+
+    auto fail = [&](const QString &message) {
+        *errorMessage = message;
+        db.rollback();
+        return false;
+    };
+
+    for (const QString &name : indexNames) {
+        if (!query.exec(QString("DROP INDEX IF EXISTS %1").arg(name))) {
+            return fail(query.lastError().text());
+        }
+    }
+    for (const QString &name : triggerNames) {
+        if (!query.exec(QString("DROP TRIGGER IF EXISTS %1").arg(name))) {
+            return fail(query.lastError().text());
+        }
+    }
+
+    for (auto it = tables.crbegin(); it != tables.crend(); ++it) {
+        if (tableExists(db, *it) && !query.exec(QString("DELETE FROM %1").arg(*it))) {
+            return fail(query.lastError().text());
+        }
+    }
+
+    if (!reader.expect('{')) {
+        return fail("Backup file is not a JSON object");
+    }
+
+    QString key;
+    QByteArray raw;
+    qint64 rowsLoaded = 0;
+    bool formatChecked = false;
+    bool versionChecked = false;
+    while (reader.nextElement('}')) {
+        if (!reader.readString(&key) || !reader.expect(':')) {
+            return fail("Malformed backup header");
+        }
+
+        if (key == "format") {
+            QString format;
+            if (!reader.readString(&format) || format != FORMAT_NAME) {
+                return fail("Unsupported backup format");
+            }
+            formatChecked = true;
+            continue;
+        }
+
+        // Rows are loaded as they are, so they must match this schema
+        if (key == "version") {
+            if (!reader.readRawValue(&raw)) {
+                return fail("Malformed backup header");
+            }
+            bool ok = false;
+            const int version = raw.trimmed().toInt(&ok);
+            if (!ok || version != schemaVersion) {
+                return fail(QString("Backup is from schema version %1, the database is at version %2")
+                            .arg(QString::fromUtf8(raw.trimmed())).arg(schemaVersion));
+            }
+            versionChecked = true;
+            continue;
+        }
+
+        if (key != "tables") {
+            if (!reader.readRawValue(&raw)) {
+                return fail("Malformed backup header");
+            }
+            continue;
+        }
+
+        if (!formatChecked) {
+            return fail("Unsupported backup format");
+        }
+        if (!versionChecked) {
+            return fail("Backup has no schema version");
+        }
+
+        if (!reader.expect('{')) {
+            return fail("Malformed tables section");
+        }
+
+        QString table;
+        while (reader.nextElement('}')) {
+            if (!reader.readString(&table) || !reader.expect(':') || !reader.expect('[')) {
+                return fail("Malformed tables section");
+            }
+
+            const bool known = tables.contains(table) && tableExists(db, table);
+            if (!known) {
+                qWarning() << "Skipping unknown table in backup:" << table;
+            }
+
+            TableLoader loader(db, table);
+            while (reader.nextElement(']')) {
+                if (!reader.readRawValue(&raw)) {
+                    return fail(QString("Truncated data in table %1").arg(table));
+                }
+                if (!known) {
+                    continue;
+                }
+
+                QJsonParseError parseError;
+                const QJsonDocument row = QJsonDocument::fromJson(raw, &parseError);
+                if (parseError.error != QJsonParseError::NoError || !row.isObject()) {
+                    return fail(QString("Invalid row in table %1: %2").arg(table, parseError.errorString()));
+                }
+
+                QString insertError;
+                if (!loader.insert(row.object(), &insertError)) {
+                    return fail(insertError);
+                }
+
+                if (++rowsLoaded % ROWS_PER_BATCH == 0 && progress) {
+                    progress(reader.bytesRead(), totalBytes);
+                }
+            }
+        }
+    }
+
+    if (reader.truncated()) {
+        return fail("Backup file is truncated");
+    }
+
+    for (const QString &statement : indexStatements) {
+        if (!query.exec(statement)) {
+            return fail(query.lastError().text());
+        }
+    }
+
+    for (const QString &statement : triggerStatements) {
+        if (!query.exec(statement)) {
+            return fail(query.lastError().text());
+        }
+    }
+
+    // The restored counters and the rollup reflect whatever the file held;
+    // recompute both once from the restored rows
+    if (!DatabaseMigration::rebuildSubtaskCounters(db) || !DatabaseMigration::rebuildDailyTotals(db)) {
+        return fail("Failed to rebuild derived data after restore");
+    }
+
+    if (!db.commit()) {
+        return fail(db.lastError().text());
+    }
+
+    if (progress) {
+        progress(totalBytes, totalBytes);
+    }
+
+    qInfo() << "Restored" << rowsLoaded << "rows from" << filePath;
+    return true;
+}
@@ -1,8 +1,12 @@
 #include "database/databasemigration.h"
+#include "database/statements.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
 
+
+const int DatabaseMigration::ROWS_PER_BATCH = 5000;
+
 DatabaseMigration::DatabaseMigration(QObject *parent) : QObject(parent) {}
 
 int DatabaseMigration::getCurrentVersion(QSqlDatabase &db)
@@ -38,33 +42,140 @@ bool DatabaseMigration::setVersion(QSqlDatabase &db, int version)
     return true;
 }
 
-bool DatabaseMigration::migrateToVersion(QSqlDatabase &db, int targetVersion)
+namespace {
+
+// Entries count towards the day they start on, like the "day" grouping of
+// TimeEntryManager::aggregate; task_id 0 stands for "no task" so the key
+// stays unique
+const char *EXPECTED_DAILY_TOTALS = R"(
+    SELECT date(start_time) AS day, project_id, COALESCE(task_id, 0) AS task_id,
+           SUM(duration) AS minutes, COUNT(*) AS entry_count
+    FROM time_entries
+    WHERE date(start_time) IS NOT NULL
+    GROUP BY 1, 2, 3
+)";
+
+// Seconds since 1970 of the stored wall-clock times, read as UTC
+const char *START_EPOCH_COLUMN = "start_epoch INTEGER GENERATED ALWAYS AS (CAST(strftime('%s', start_time) AS INTEGER)) VIRTUAL";
+const char *END_EPOCH_COLUMN = "end_epoch INTEGER GENERATED ALWAYS AS (CAST(strftime('%s', end_time) AS INTEGER)) VIRTUAL";
+
+const char *SUBTASK_TOTAL = "(SELECT COUNT(*) FROM subtasks s WHERE s.parent_task_id = tasks.id)";
+const char *SUBTASK_DONE = "(SELECT COUNT(*) FROM subtasks s WHERE s.parent_task_id = tasks.id AND s.is_completed)";
+
+} // namespace
+
+bool DatabaseMigration::rebuildDailyTotals(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec("DELETE FROM daily_project_totals")) {
+        qCritical() << "Failed to clear daily totals:" << query.lastError().text();
+        return false;
+    }
+    
+    if (!query.exec(QString("INSERT INTO daily_project_totals (day, project_id, task_id, minutes, entry_count) %1")
+                    .arg(EXPECTED_DAILY_TOTALS))) {
+        qCritical() << "Failed to rebuild daily totals:" << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+int DatabaseMigration::dailyTotalsMismatches(QSqlDatabase &db)
+{
+    // Rows missing or wrong on either side of the comparison
+    QSqlQuery query(db);
+    if (!query.exec(QString(R"(
+        WITH expected AS (%1)
+        SELECT (SELECT COUNT(*) FROM (SELECT * FROM expected
+                EXCEPT SELECT day, project_id, task_id, minutes, entry_count FROM daily_project_totals))
+             + (SELECT COUNT(*) FROM (SELECT day, project_id, task_id, minutes, entry_count FROM daily_project_totals
+                EXCEPT SELECT * FROM expected))
+    )").arg(EXPECTED_DAILY_TOTALS)) || !query.next()) {
+        qCritical() << "Failed to check daily totals:" << query.lastError().text();
+        return -1;
+    }
+    
+    return query.value(0).toInt();
+}
+
+bool DatabaseMigration::rebuildSubtaskCounters(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec(QString("UPDATE tasks SET subtask_total = %1, subtask_done = %2").arg(SUBTASK_TOTAL, SUBTASK_DONE))) {
+        qCritical() << "Failed to rebuild subtask counters:" << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+int DatabaseMigration::subtaskCounterMismatches(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec(QString("SELECT COUNT(*) FROM tasks WHERE subtask_total != %1 OR subtask_done != %2")
+                    .arg(SUBTASK_TOTAL, SUBTASK_DONE)) || !query.next()) {
+        qCritical() << "Failed to check subtask counters:" << query.lastError().text();
+        return -1;
+    }
+    
+    return query.value(0).toInt();
+}
+
+int DatabaseMigration::compactPresenceSessions(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec(Statements::COMPACT_PRESENCE_SESSIONS)) {
+        qCritical() << "Failed to compact presence sessions:" << query.lastError().text();
+        return -1;
+    }
+    
+    return query.numRowsAffected();
+}
+
+bool DatabaseMigration::migrateToVersion(QSqlDatabase &db, int targetVersion, const ProgressCallback &progress)
 {
     int currentVersion = getCurrentVersion(db);
     
     for (int v = currentVersion + 1; v <= targetVersion; ++v) {
         qInfo() << "Migrating to version" << v;
+        if (progress) {
+            progress(v, 0, 0);
+        }
         bool success = false;
         
+        // A failed step rolls back completely, leaving the previous version intact
+        if (!db.transaction()) {
+            qCritical() << "Failed to begin migration transaction:" << db.lastError().text();
+            return false;
+        }
+        
         switch (v) {
             case 1: success = migrateToV1(db); break;
             case 2: success = migrateToV2(db); break;
             case 3: success = migrateToV3(db); break;
             case 4: success = migrateToV4(db); break;
             case 5: success = migrateToV5(db); break;
-            case 6: success = migrateToV6(db); break;
+            case 6: success = migrateToV6(db, progress); break;
             case 7: success = migrateToV7(db); break;
+            case 8: success = migrateToV8(db); break;
+            case 9: success = migrateToV9(db); break;
+            case 10: success = migrateToV10(db); break;
+            case 11: success = migrateToV11(db); break;
+            case 12: success = migrateToV12(db); break;
+            case 13: success = migrateToV13(db); break;
             default:
                 qWarning() << "Unknown migration version:" << v;
-                return false;
+                break;
         }
         
-        if (!success) {
-            qCritical() << "Failed to migrate to version" << v;
-            return false;
+        if (success) {
+            success = setVersion(db, v);
         }
         
-        if (!setVersion(db, v)) {
+        if (!success || !db.commit()) {
+            qCritical() << "Failed to migrate to version" << v;
+            db.rollback();
             return false;
         }
     }
@@ -252,7 +363,7 @@ bool DatabaseMigration::migrateToV5(QSqlDatabase &db)
     qInfo() << "Migration v5 completed successfully";
     return true;
 }
-bool DatabaseMigration::migrateToV6(QSqlDatabase &db)
+bool DatabaseMigration::migrateToV6(QSqlDatabase &db, const ProgressCallback &progress)
 {
     qInfo() << "Migration v6: Adding subtasks table and making project_id mandatory";
     
@@ -292,16 +403,47 @@ bool DatabaseMigration::migrateToV6(QSqlDatabase &db)
         return false;
     }
     
-    // Step 4: Copy data from old table to new table
-    QString copyData = R"(
+    // Step 4: Copy data from old table to new table in id order, one batch
+    // at a time so progress can be reported while a large table is copied
+    if (!query.exec("SELECT COUNT(*) FROM tasks") || !query.next()) {
+        qCritical() << "Migration v6 failed - could not count tasks:" << query.lastError().text();
+        return false;
+    }
+    const qint64 rowsTotal = query.value(0).toLongLong();
+    
+    QSqlQuery copyBatch(db);
+    copyBatch.prepare(R"(
         INSERT INTO tasks_new (id, name, due_date, project_id, allocated_time, is_active, created_at, updated_at)
         SELECT id, name, due_date, project_id, allocated_time, is_active, created_at, updated_at
         FROM tasks
-    )";
-    
-    if (!query.exec(copyData)) {
-        qCritical() << "Migration v6 failed - could not copy tasks data:" << query.lastError().text();
-        return false;
+        WHERE id > :after
+        ORDER BY id
+        LIMIT :limit
+    )");
+    qint64 rowsDone = 0;
+    qint64 lastId = -1;
+    while (rowsDone < rowsTotal) {
+        copyBatch.bindValue(":after", lastId);
+        copyBatch.bindValue(":limit", ROWS_PER_BATCH);
+        if (!copyBatch.exec()) {
+            qCritical() << "Migration v6 failed - could not copy tasks data:" << copyBatch.lastError().text();
+            return false;
+        }
+        const int copied = copyBatch.numRowsAffected();
+        if (copied <= 0) {
+            break;
+        }
+        rowsDone += copied;
+        
+        if (!query.exec("SELECT MAX(id) FROM tasks_new") || !query.next()) {
+            qCritical() << "Migration v6 failed - could not read copied tasks:" << query.lastError().text();
+            return false;
+        }
+        lastId = query.value(0).toLongLong();
+        
+        if (progress) {
+            progress(6, rowsDone, rowsTotal);
+        }
     }
     
     // Step 5: Drop old table
@@ -415,3 +557,292 @@ bool DatabaseMigration::migrateToV7(QSqlDatabase &db)
     qInfo() << "Migration v7 completed successfully";
     return true;
 }
+
+bool DatabaseMigration::migrateToV8(QSqlDatabase &db)
+{
+    qInfo() << "Migration v8: Adding epoch timestamp columns and range indexes to time entries";
+    
+    // Check which columns exist; generated columns only show in table_xinfo
+    QSqlQuery checkQuery(db);
+    if (!checkQuery.exec("PRAGMA table_xinfo(time_entries)")) {
+        qCritical() << "Migration v8 failed - could not check table structure:" << checkQuery.lastError().text();
+        return false;
+    }
+    
+    bool startEpochExists = false;
+    bool endEpochExists = false;
+    while (checkQuery.next()) {
+        QString colName = checkQuery.value("name").toString();
+        if (colName == "start_epoch") startEpochExists = true;
+        if (colName == "end_epoch") endEpochExists = true;
+    }
+    
+    // Virtual generated columns: computed on read, so adding them rewrites
+    // no rows and every writer, including restores, gets them for free
+    QSqlQuery query(db);
+    if (!startEpochExists) {
+        if (!query.exec(QString("ALTER TABLE time_entries ADD COLUMN %1").arg(START_EPOCH_COLUMN))) {
+            qCritical() << "Migration v8 failed (start_epoch):" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    if (!endEpochExists) {
+        if (!query.exec(QString("ALTER TABLE time_entries ADD COLUMN %1").arg(END_EPOCH_COLUMN))) {
+            qCritical() << "Migration v8 failed (end_epoch):" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // Create indexes for range queries
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_time_entries_start_epoch ON time_entries(start_epoch)")) {
+        qCritical() << "Migration v8 failed - could not create indexes:" << query.lastError().text();
+        return false;
+    }
+    
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_time_entries_project_start ON time_entries(project_id, start_epoch)")) {
+        qCritical() << "Migration v8 failed - could not create indexes:" << query.lastError().text();
+        return false;
+    }
+    
+    qInfo() << "Migration v8 completed successfully";
+    return true;
+}
+
+bool DatabaseMigration::migrateToV9(QSqlDatabase &db)
+{
+    qInfo() << "Migration v9: Adding date index to office presence";
+    
+    QSqlQuery query(db);
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_office_presence_date ON office_presence(date)")) {
+        qCritical() << "Migration v9 failed - could not create indexes:" << query.lastError().text();
+        return false;
+    }
+    
+    qInfo() << "Migration v9 completed successfully";
+    return true;
+}
+
+bool DatabaseMigration::migrateToV10(QSqlDatabase &db)
+{
+    qInfo() << "Migration v10: Adding task/start index for paged time entry queries";
+    
+    QSqlQuery query(db);
+    // The composite index also serves plain task_id lookups
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_time_entries_task_start ON time_entries(task_id, start_epoch)")) {
+        qCritical() << "Migration v10 failed - could not create indexes:" << query.lastError().text();
+        return false;
+    }
+    
+    if (!query.exec("DROP INDEX IF EXISTS idx_time_entries_task_id")) {
+        qCritical() << "Migration v10 failed - could not drop old task index:" << query.lastError().text();
+        return false;
+    }
+    
+    qInfo() << "Migration v10 completed successfully";
+    return true;
+}
+
+bool DatabaseMigration::migrateToV11(QSqlDatabase &db)
+{
+    qInfo() << "Migration v11: Adding daily per-project time totals";
+    
+    QSqlQuery query(db);
+    QString createTable = R"(
+        CREATE TABLE IF NOT EXISTS daily_project_totals (
+            day TEXT NOT NULL,
+            project_id INTEGER NOT NULL,
+            task_id INTEGER NOT NULL DEFAULT 0,
+            minutes INTEGER NOT NULL DEFAULT 0,
+            entry_count INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (day, project_id, task_id)
+        ) WITHOUT ROWID
+    )";
+    
+    if (!query.exec(createTable)) {
+        qCritical() << "Migration v11 failed - could not create daily totals table:" << query.lastError().text();
+        return false;
+    }
+    
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_daily_project_totals_project_day ON daily_project_totals(project_id, day)")) {
+        qCritical() << "Migration v11 failed - could not create indexes:" << query.lastError().text();
+        return false;
+    }
+    
+    if (!rebuildDailyTotals(db)) {
+        qCritical() << "Migration v11 failed - could not backfill daily totals";
+        return false;
+    }
+    
+    // Triggers keep the totals in the writer's transaction, whichever path
+    // the write comes from (managers, write queue, restores, generators)
+    QString createInsertTrigger = R"(
+        CREATE TRIGGER IF NOT EXISTS trg_time_entries_totals_insert
+        AFTER INSERT ON time_entries
+        WHEN date(NEW.start_time) IS NOT NULL
+        BEGIN
+            INSERT INTO daily_project_totals (day, project_id, task_id, minutes, entry_count)
+            VALUES (date(NEW.start_time), NEW.project_id, COALESCE(NEW.task_id, 0), NEW.duration, 1)
+            ON CONFLICT (day, project_id, task_id) DO UPDATE
+            SET minutes = minutes + excluded.minutes, entry_count = entry_count + 1;
+        END
+    )";
+    
+    if (!query.exec(createInsertTrigger)) {
+        qCritical() << "Migration v11 failed - could not create insert trigger:" << query.lastError().text();
+        return false;
+    }
+    
+    QString createDeleteTrigger = R"(
+        CREATE TRIGGER IF NOT EXISTS trg_time_entries_totals_delete
+        AFTER DELETE ON time_entries
+        BEGIN
+            UPDATE daily_project_totals
+            SET minutes = minutes - OLD.duration, entry_count = entry_count - 1
+            WHERE day = date(OLD.start_time) AND project_id = OLD.project_id AND task_id = COALESCE(OLD.task_id, 0);
+            DELETE FROM daily_project_totals
+            WHERE day = date(OLD.start_time) AND project_id = OLD.project_id AND task_id = COALESCE(OLD.task_id, 0)
+              AND entry_count <= 0;
+        END
+    )";
+    
+    if (!query.exec(createDeleteTrigger)) {
+        qCritical() << "Migration v11 failed - could not create delete trigger:" << query.lastError().text();
+        return false;
+    }
+    
+    QString createUpdateTrigger = R"(
+        CREATE TRIGGER IF NOT EXISTS trg_time_entries_totals_update
+        AFTER UPDATE OF project_id, task_id, start_time, duration ON time_entries
+        BEGIN
+            UPDATE daily_project_totals
+            SET minutes = minutes - OLD.duration, entry_count = entry_count - 1
+            WHERE day = date(OLD.start_time) AND project_id = OLD.project_id AND task_id = COALESCE(OLD.task_id, 0);
+            DELETE FROM daily_project_totals
+            WHERE day = date(OLD.start_time) AND project_id = OLD.project_id AND task_id = COALESCE(OLD.task_id, 0)
+              AND entry_count <= 0;
+            INSERT INTO daily_project_totals (day, project_id, task_id, minutes, entry_count)
+            SELECT date(NEW.start_time), NEW.project_id, COALESCE(NEW.task_id, 0), NEW.duration, 1
+            WHERE date(NEW.start_time) IS NOT NULL
+            ON CONFLICT (day, project_id, task_id) DO UPDATE
+            SET minutes = minutes + excluded.minutes, entry_count = entry_count + 1;
+        END
+    )";
+    
+    if (!query.exec(createUpdateTrigger)) {
+        qCritical() << "Migration v11 failed - could not create update trigger:" << query.lastError().text();
+        return false;
+    }
+    
+    qInfo() << "Migration v11 completed successfully";
+    return true;
+}
+
+bool DatabaseMigration::migrateToV12(QSqlDatabase &db)
+{
+    qInfo() << "Migration v12: Adding subtask counters to tasks";
+    
+    QSqlQuery checkQuery(db);
+    if (!checkQuery.exec("PRAGMA table_info(tasks)")) {
+        qCritical() << "Migration v12 failed - could not check table structure:" << checkQuery.lastError().text();
+        return false;
+    }
+    
+    bool totalExists = false;
+    bool doneExists = false;
+    while (checkQuery.next()) {
+        QString colName = checkQuery.value("name").toString();
+        if (colName == "subtask_total") totalExists = true;
+        if (colName == "subtask_done") doneExists = true;
+    }
+    
+    QSqlQuery query(db);
+    if (!totalExists) {
+        if (!query.exec("ALTER TABLE tasks ADD COLUMN subtask_total INTEGER NOT NULL DEFAULT 0")) {
+            qCritical() << "Migration v12 failed (subtask_total):" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    if (!doneExists) {
+        if (!query.exec("ALTER TABLE tasks ADD COLUMN subtask_done INTEGER NOT NULL DEFAULT 0")) {
+            qCritical() << "Migration v12 failed (subtask_done):" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    if (!rebuildSubtaskCounters(db)) {
+        qCritical() << "Migration v12 failed - could not backfill subtask counters";
+        return false;
+    }
+    
+    // Counters move in the same transaction as the subtask write
+    QString createInsertTrigger = R"(
+        CREATE TRIGGER IF NOT EXISTS trg_subtasks_counters_insert
+        AFTER INSERT ON subtasks
+        BEGIN
+            UPDATE tasks
+            SET subtask_total = subtask_total + 1,
+                subtask_done = subtask_done + (COALESCE(NEW.is_completed, 0) != 0)
+            WHERE id = NEW.parent_task_id;
+        END
+    )";
+    
+    if (!query.exec(createInsertTrigger)) {
+        qCritical() << "Migration v12 failed - could not create insert trigger:" << query.lastError().text();
+        return false;
+    }
+    
+    QString createDeleteTrigger = R"(
+        CREATE TRIGGER IF NOT EXISTS trg_subtasks_counters_delete
+        AFTER DELETE ON subtasks
+        BEGIN
+            UPDATE tasks
+            SET subtask_total = subtask_total - 1,
+                subtask_done = subtask_done - (COALESCE(OLD.is_completed, 0) != 0)
+            WHERE id = OLD.parent_task_id;
+        END
+    )";
+    
+    if (!query.exec(createDeleteTrigger)) {
+        qCritical() << "Migration v12 failed - could not create delete trigger:" << query.lastError().text();
+        return false;
+    }
+    
+    QString createUpdateTrigger = R"(
+        CREATE TRIGGER IF NOT EXISTS trg_subtasks_counters_update
+        AFTER UPDATE OF parent_task_id, is_completed ON subtasks
+        BEGIN
+            UPDATE tasks
+            SET subtask_total = subtask_total - 1,
+                subtask_done = subtask_done - (COALESCE(OLD.is_completed, 0) != 0)
+            WHERE id = OLD.parent_task_id;
+            UPDATE tasks
+            SET subtask_total = subtask_total + 1,
+                subtask_done = subtask_done + (COALESCE(NEW.is_completed, 0) != 0)
+            WHERE id = NEW.parent_task_id;
+        END
+    )";
+    
+    if (!query.exec(createUpdateTrigger)) {
+        qCritical() << "Migration v12 failed - could not create update trigger:" << query.lastError().text();
+        return false;
+    }
+    
+    qInfo() << "Migration v12 completed successfully";
+    return true;
+}
+
+bool DatabaseMigration::migrateToV13(QSqlDatabase &db)
+{
+    qInfo() << "Migration v13: Compacting duplicate office presence rows";
+    
+    const int removed = compactPresenceSessions(db);
+    if (removed < 0) {
+        qCritical() << "Migration v13 failed - could not compact presence sessions";
+        return false;
+    }
+    
+    qInfo() << "Migration v13 completed successfully, removed" << removed << "duplicate rows";
+    return true;
+}
@@ -0,0 +1,468 @@
+#include "database/onlinebackup.h"
+#include "database/sqliteapi.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QMap>
+#include <QRegularExpression>
+#include <QDebug>
+
+#ifdef HAVE_SQLITE3_API
+#include <sqlite3.h>
+#endif
+
+const int OnlineBackup::PAGES_PER_STEP = 64;
+const int OnlineBackup::ROWS_PER_STEP = 2000;
+const int OnlineBackup::STEP_INTERVAL_MS = 5;
+
+namespace {
+
+bool isMemoryDatabase(const QSqlDatabase &db)
+{
+    const QString name = db.databaseName();
+    return name.isEmpty() || name == ":memory:" || name.contains("mode=memory");
+}
+
+QString quoted(const QString &identifier)
+{
+    return '"' + QString(identifier).replace('"', "\"\"") + '"';
+}
+
+// Stored columns only: generated columns are recomputed by the destination
+QStringList storedColumns(QSqlDatabase &db, const QString &table)
+{
+    QStringList columns;
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA table_xinfo(" + quoted(table) + ")")) {
+        while (query.next()) {
+            if (query.value(6).toInt() == 0) {
+                columns << quoted(query.value(1).toString());
+            }
+        }
+    }
+    return columns;
+}
+
+// Columns a table is paged by: the rowid, or the primary key of a
+// WITHOUT ROWID table such as daily_project_totals
+QStringList pagingColumns(QSqlDatabase &db, const QString &table, const QString &createSql)
+{
+    static const QRegularExpression withoutRowId("\\)\\s*WITHOUT\\s+ROWID\\s*;?\\s*$",
+                                                 QRegularExpression::CaseInsensitiveOption);
+    if (!withoutRowId.match(createSql).hasMatch()) {
+        return { "rowid" };
+    }
+
+    QMap<int, QString> keyColumns;
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA table_info(" + quoted(table) + ")")) {
+        while (query.next()) {
+            if (query.value(5).toInt() > 0) {
+                keyColumns.insert(query.value(5).toInt(), quoted(query.value(1).toString()));
+            }
+        }
+    }
+    return keyColumns.values();
+}
+
+QString sqlLiteral(const QVariant &value)
+{
+    return "'" + value.toString().replace('\'', "''") + "'";
+}
+
+} // namespace
+
+OnlineBackup::OnlineBackup(const QSqlDatabase &source, const QString &destinationPath, QObject *parent)
+    : QObject(parent)
+    , m_source(source)
+    , m_destinationPath(destinationPath)
+    , m_running(false)
+    , m_incremental(true)
+    , m_destination(nullptr)
+    , m_backup(nullptr)
+    , m_tableIndex(0)
+    , m_rowsDone(0)
+    , m_rowsTotal(0)
+{
+    m_timer.setInterval(STEP_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &OnlineBackup::step);
+}
+
+OnlineBackup::~OnlineBackup()
+{
+    if (m_running) {
+        cancel();
+    }
+}
+
+bool OnlineBackup::start()
+{
+    if (m_running) {
+        return false;
+    }
+
+    QFile::remove(partialPath());
+
+    bool started = false;
+    if (sqlite3 *source = SqliteApi::nativeHandle(m_source)) {
+        started = startNative(source);
+    } else if (isMemoryDatabase(m_source)) {
+        m_incremental = false;
+        started = true;
+    } else {
+        started = startCopy();
+    }
+    if (!started) {
+        return false;
+    }
+
+    m_running = true;
+    m_timer.start();
+    qInfo() << "[BACKUP] Started" << (m_incremental ? "online" : "one-step") << "backup to" << m_destinationPath;
+    return true;
+}
+
+bool OnlineBackup::startNative(sqlite3 *source)
+{
+#ifdef HAVE_SQLITE3_API
+    if (sqlite3_open_v2(QFile::encodeName(partialPath()).constData(), &m_destination,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+        qWarning() << "[BACKUP] Cannot open destination:" << sqlite3_errmsg(m_destination);
+        sqlite3_close(m_destination);
+        m_destination = nullptr;
+        return false;
+    }
+
+    m_backup = sqlite3_backup_init(m_destination, "main", source, "main");
+    if (!m_backup) {
+        qWarning() << "[BACKUP] Cannot start backup:" << sqlite3_errmsg(m_destination);
+        sqlite3_close(m_destination);
+        m_destination = nullptr;
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(source);
+    return false;
+#endif
+}
+
+bool OnlineBackup::openCopyConnections(QString *errorMessage)
+{
+    const QString prefix = QString("ptt_backup_%1").arg(quintptr(this));
+    m_readerName = prefix + "_read";
+    m_writerName = prefix + "_write";
+
+    QSqlDatabase reader = QSqlDatabase::addDatabase("QSQLITE", m_readerName);
+    reader.setDatabaseName(m_source.databaseName());
+    reader.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000;QSQLITE_OPEN_READONLY");
+    if (!reader.open()) {
+        *errorMessage = reader.lastError().text();
+        return false;
+    }
+
+    QSqlDatabase writer = QSqlDatabase::addDatabase("QSQLITE", m_writerName);
+    writer.setDatabaseName(partialPath());
+    if (!writer.open()) {
+        *errorMessage = writer.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void OnlineBackup::closeCopyConnections()
+{
+    for (QString *name : { &m_readerName, &m_writerName }) {
+        if (name->isEmpty()) {
+            continue;
+        }
+        {
+            QSqlDatabase db = QSqlDatabase::database(*name, false);
+            if (db.isOpen()) {
+                // Ends the read snapshot, or drops an unfinished copy
+                QSqlQuery(db).exec("ROLLBACK");
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(*name);
+        name->clear();
+    }
+}
+
+bool OnlineBackup::startCopy()
+{
+    QString errorMessage;
+    if (!openCopyConnections(&errorMessage) || !prepareCopy(&errorMessage)) {
+        qWarning() << "[BACKUP] Cannot start backup:" << errorMessage;
+        closeCopyConnections();
+        QFile::remove(partialPath());
+        return false;
+    }
+    return true;
+}
+
+bool OnlineBackup::prepareCopy(QString *errorMessage)
+{
+    QSqlQuery read(QSqlDatabase::database(m_readerName, false));
+    QSqlQuery write(QSqlDatabase::database(m_writerName, false));
+
+    // The snapshot starts with the first read of the transaction and lasts
+    // until the copy is done; WAL keeps the application's writes flowing
+    if (!read.exec("BEGIN")
+        || !read.exec("SELECT type, name, sql FROM sqlite_master WHERE sql IS NOT NULL AND name NOT LIKE 'sqlite_%' "
+                      "ORDER BY type = 'table' DESC, rowid")) {
+        *errorMessage = read.lastError().text();
+        return false;
+    }
+    m_tables.clear();
+    m_tableKeys.clear();
+    m_deferredSql.clear();
+    QStringList createSql;
+    while (read.next()) {
+        if (read.value(0).toString() != "table") {
+            m_deferredSql << read.value(2).toString();
+        } else if (write.exec(read.value(2).toString())) {
+            m_tables << read.value(1).toString();
+            createSql << read.value(2).toString();
+        } else {
+            *errorMessage = write.lastError().text();
+            return false;
+        }
+    }
+    QSqlDatabase reader = QSqlDatabase::database(m_readerName, false);
+    for (int i = 0; i < m_tables.size(); ++i) {
+        const QStringList keys = pagingColumns(reader, m_tables.at(i), createSql.at(i));
+        if (keys.isEmpty()) {
+            *errorMessage = tr("No primary key to page %1 by").arg(m_tables.at(i));
+            return false;
+        }
+        m_tableKeys << keys;
+    }
+
+    // AUTOINCREMENT counters can be ahead of the largest copied id, and
+    // sqlite_sequence is skipped with the other internal tables above
+    if (!read.exec("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'sqlite_sequence'") || !read.next()) {
+        *errorMessage = read.lastError().text();
+        return false;
+    }
+    if (read.value(0).toInt() > 0) {
+        if (!read.exec("SELECT name, seq FROM sqlite_sequence")) {
+            *errorMessage = read.lastError().text();
+            return false;
+        }
+        m_deferredSql << "DELETE FROM sqlite_sequence";
+        while (read.next()) {
+            m_deferredSql << QString("INSERT INTO sqlite_sequence (name, seq) VALUES (%1, %2)")
+                                 .arg(sqlLiteral(read.value(0)))
+                                 .arg(read.value(1).toLongLong());
+        }
+    }
+    if (!read.exec("PRAGMA user_version") || !read.next()) {
+        *errorMessage = read.lastError().text();
+        return false;
+    }
+    m_deferredSql << QString("PRAGMA user_version = %1").arg(read.value(0).toInt());
+
+    m_rowsTotal = 0;
+    for (const QString &table : std::as_const(m_tables)) {
+        if (!read.exec("SELECT COUNT(*) FROM " + quoted(table)) || !read.next()) {
+            *errorMessage = read.lastError().text();
+            return false;
+        }
+        m_rowsTotal += read.value(0).toLongLong();
+    }
+
+    // The partial file is only renamed into place once complete
+    if (!write.exec("PRAGMA journal_mode=OFF") || !write.exec("BEGIN")) {
+        *errorMessage = write.lastError().text();
+        return false;
+    }
+
+    m_tableIndex = 0;
+    m_lastKey.clear();
+    m_rowsDone = 0;
+    return true;
+}
+
+void OnlineBackup::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    finish(false, tr("Backup cancelled"));
+}
+
+void OnlineBackup::step()
+{
+    if (m_backup) {
+        stepNative();
+    } else if (!m_incremental) {
+        stepVacuum();
+    } else {
+        stepCopy();
+    }
+}
+
+void OnlineBackup::stepNative()
+{
+#ifdef HAVE_SQLITE3_API
+    const int rc = sqlite3_backup_step(m_backup, PAGES_PER_STEP);
+    const int total = sqlite3_backup_pagecount(m_backup);
+    emit progress(total - sqlite3_backup_remaining(m_backup), total);
+
+    if (rc == SQLITE_DONE) {
+        finish(true, QString());
+    } else if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+        finish(false, QString::fromUtf8(sqlite3_errstr(rc)));
+    }
+#endif
+}
+
+void OnlineBackup::stepVacuum()
+{
+    // The demo database is a shared-cache in-memory URI: a second connection
+    // can open it, but shared cache has no WAL snapshots, and a read
+    // transaction kept open across steps holds table locks that fail the
+    // owner's writes with SQLITE_LOCKED. It is written in one statement
+    m_timer.stop();
+    QSqlQuery query(m_source);
+    query.prepare("VACUUM INTO :path");
+    query.bindValue(":path", partialPath());
+    if (!query.exec()) {
+        finish(false, query.lastError().text());
+        return;
+    }
+    emit progress(1, 1);
+    finish(true, QString());
+}
+
+bool OnlineBackup::copyRows(QString *errorMessage)
+{
+    QSqlDatabase reader = QSqlDatabase::database(m_readerName, false);
+    QSqlDatabase writer = QSqlDatabase::database(m_writerName, false);
+
+    int budget = ROWS_PER_STEP;
+    while (budget > 0 && m_tableIndex < m_tables.size()) {
+        const QString table = quoted(m_tables.at(m_tableIndex));
+        const QStringList columns = storedColumns(reader, m_tables.at(m_tableIndex));
+        const QStringList keys = m_tableKeys.at(m_tableIndex);
+        const QString keyList = keys.join(", ");
+
+        // Keyset paging: (key...) > (last key...) walks the rowid or the
+        // primary key index
+        QString sql = QString("SELECT %1, %2 FROM %3").arg(keyList, columns.join(", "), table);
+        if (!m_lastKey.isEmpty()) {
+            sql += QString(" WHERE (%1) > (%2)").arg(keyList, QStringList(keys.size(), "?").join(", "));
+        }
+        sql += QString(" ORDER BY %1 LIMIT ?").arg(keyList);
+
+        QSqlQuery select(reader);
+        select.setForwardOnly(true);
+        select.prepare(sql);
+        for (const QVariant &value : std::as_const(m_lastKey)) {
+            select.addBindValue(value);
+        }
+        select.addBindValue(budget);
+        if (!select.exec()) {
+            *errorMessage = select.lastError().text();
+            return false;
+        }
+
+        QSqlQuery insert(writer);
+        insert.prepare(QString("INSERT INTO %1 (%2) VALUES (%3)")
+                           .arg(table, columns.join(", "), QStringList(columns.size(), "?").join(", ")));
+        int copied = 0;
+        while (select.next()) {
+            for (int i = 0; i < columns.size(); ++i) {
+                insert.bindValue(i, select.value(keys.size() + i));
+            }
+            if (!insert.exec()) {
+                *errorMessage = insert.lastError().text();
+                return false;
+            }
+            m_lastKey.clear();
+            for (int i = 0; i < keys.size(); ++i) {
+                m_lastKey << select.value(i);
+            }
+            ++copied;
+        }
+
+        m_rowsDone += copied;
+        if (copied < budget) {
+            ++m_tableIndex;
+            m_lastKey.clear();
+        }
+        budget -= copied;
+    }
+    return true;
+}
+
+// Indexes and triggers come last, so triggers do not fire on copied rows
+bool OnlineBackup::completeCopy(QString *errorMessage)
+{
+    QSqlQuery write(QSqlDatabase::database(m_writerName, false));
+    for (const QString &sql : std::as_const(m_deferredSql)) {
+        if (!write.exec(sql)) {
+            *errorMessage = write.lastError().text();
+            return false;
+        }
+    }
+    if (!write.exec("COMMIT")) {
+        *errorMessage = write.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void OnlineBackup::stepCopy()
+{
+    QString errorMessage;
+    if (!copyRows(&errorMessage)) {
+        finish(false, errorMessage);
+        return;
+    }
+    emit progress(int(m_rowsDone), int(m_rowsTotal));
+    if (m_tableIndex < m_tables.size()) {
+        return;
+    }
+    if (!completeCopy(&errorMessage)) {
+        finish(false, errorMessage);
+        return;
+    }
+    finish(true, QString());
+}
+
+void OnlineBackup::finish(bool success, const QString &errorMessage)
+{
+    m_timer.stop();
+    m_running = false;
+
+#ifdef HAVE_SQLITE3_API
+    if (m_backup) {
+        sqlite3_backup_finish(m_backup);
+        m_backup = nullptr;
+    }
+    if (m_destination) {
+        sqlite3_close(m_destination);
+        m_destination = nullptr;
+    }
+#endif
+    closeCopyConnections();
+
+    QString error = errorMessage;
+    if (success) {
+        QFile::remove(m_destinationPath);
+        if (!QFile::rename(partialPath(), m_destinationPath)) {
+            success = false;
+            error = tr("Cannot move backup into place");
+        }
+    }
+    if (!success) {
+        QFile::remove(partialPath());
+        qWarning() << "[BACKUP] Online backup failed:" << error;
+    } else {
+        qInfo() << "[BACKUP] Online backup completed:" << m_destinationPath;
+    }
+
+    emit finished(success, error);
+}
@@ -0,0 +1,63 @@
+#include "database/sqliteapi.h"
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QStringList>
+#include <QDebug>
+
+#ifdef HAVE_SQLITE3_API
+#include <sqlite3.h>
+#endif
+
+namespace SqliteApi {
+
+sqlite3 *nativeHandle(const QSqlDatabase &db)
+{
+#ifdef HAVE_SQLITE3_API
+    if (!db.isOpen()) {
+        return nullptr;
+    }
+    const QVariant handle = db.driver()->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        return nullptr;
+    }
+
+    // The driver answers with its own library; both must be the same build
+    QSqlQuery query(db);
+    if (!query.exec("SELECT sqlite_version(), sqlite_source_id()") || !query.next()) {
+        return nullptr;
+    }
+    const QString driverVersion = query.value(0).toString();
+    const QString driverSource = query.value(1).toString();
+    if (driverVersion != QLatin1String(sqlite3_libversion()) || driverSource != QLatin1String(sqlite3_sourceid())) {
+        qWarning() << "SQLite C API disabled: Qt driver runs SQLite" << driverVersion
+                   << "but the application links" << sqlite3_libversion();
+        return nullptr;
+    }
+
+    // Two builds of the same release can still differ in the options that
+    // shape the handle, e.g. SQLITE_THREADSAFE or SQLITE_OMIT_*
+    QStringList driverOptions;
+    if (!query.exec("PRAGMA compile_options")) {
+        return nullptr;
+    }
+    while (query.next()) {
+        driverOptions << query.value(0).toString();
+    }
+    QStringList linkedOptions;
+    for (int i = 0; const char *option = sqlite3_compileoption_get(i); ++i) {
+        linkedOptions << QString::fromUtf8(option);
+    }
+    if (driverOptions != linkedOptions) {
+        qWarning() << "SQLite C API disabled: Qt driver and application link SQLite"
+                   << driverVersion << "built with different options";
+        return nullptr;
+    }
+    return *static_cast<sqlite3 *const *>(handle.data());
+#else
+    Q_UNUSED(db);
+    return nullptr;
+#endif
+}
+
+} // namespace SqliteApi
@@ -0,0 +1,327 @@
+#include "database/statements.h"
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QStringList>
+
+namespace {
+
+// Bound ISO strings are converted the same way the generated epoch columns convert stored times
+const QString START_EPOCH_PARAM = "CAST(strftime('%s', :start) AS INTEGER)";
+const QString END_EPOCH_PARAM = "CAST(strftime('%s', :end) AS INTEGER)";
+
+const int MAX_PAGE_SIZE = 1000;
+
+QString isoString(const QVariant &value)
+{
+    return value.userType() == QMetaType::QDateTime ? value.toDateTime().toString(Qt::ISODate) : value.toString();
+}
+
+// Which column the "end" filter bounds: lists and summaries hold entries
+// that finish in the range, aggregates count an entry on the day it starts
+// like daily_project_totals does
+enum EndBound {
+    EntryEnd,
+    EntryStart
+};
+
+// WHERE conditions shared by the page, summary, aggregate and id lookups
+QStringList filterConditions(const QVariantMap &filter, QVariantMap *bindings, EndBound endBound = EntryEnd)
+{
+    QStringList conditions;
+    if (filter.contains("projectId")) {
+        conditions << "project_id = :projectId";
+        (*bindings)[":projectId"] = filter.value("projectId");
+    }
+    if (filter.contains("projectIds")) {
+        QStringList ids;
+        for (const QVariant &id : filter.value("projectIds").toList()) {
+            ids << QString::number(id.toInt());
+        }
+        conditions << (ids.isEmpty() ? QString("0") : "project_id IN (" + ids.join(',') + ")");
+    }
+    if (filter.contains("taskId")) {
+        conditions << "task_id = :taskId";
+        (*bindings)[":taskId"] = filter.value("taskId");
+    }
+    if (filter.contains("start")) {
+        conditions << "start_epoch >= " + START_EPOCH_PARAM;
+        (*bindings)[":start"] = isoString(filter.value("start"));
+    }
+    if (filter.contains("end")) {
+        conditions << (endBound == EntryStart ? "start_epoch <= " : "end_epoch <= ") + END_EPOCH_PARAM;
+        (*bindings)[":end"] = isoString(filter.value("end"));
+    }
+    if (!filter.value("description").toString().isEmpty()) {
+        conditions << "instr(lower(description), lower(:description)) > 0";
+        (*bindings)[":description"] = filter.value("description");
+    }
+    return conditions;
+}
+
+QString whereClause(const QStringList &conditions)
+{
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+}
+
+// Group keys for aggregates, computed from the indexed epoch column.
+// Weeks are ISO weeks, keyed by the date of their Monday. The unary + keeps
+// the planner from walking a whole id index just to get grouped order,
+// so date filters still drive a start_epoch range scan.
+QString groupExpression(const QString &groupBy)
+{
+    if (groupBy == "project") {
+        return "+project_id";
+    }
+    if (groupBy == "task") {
+        return "+task_id";
+    }
+    if (groupBy == "day") {
+        return "date(start_epoch, 'unixepoch')";
+    }
+    if (groupBy == "week") {
+        return "date(start_epoch, 'unixepoch', 'weekday 0', '-6 days')";
+    }
+    if (groupBy == "month") {
+        return "strftime('%Y-%m', start_epoch, 'unixepoch')";
+    }
+    return QString();
+}
+
+// Group keys over daily_project_totals, which has one row per day, project
+// and task (task 0 meaning none)
+QString rollupGroupExpression(const QString &groupBy)
+{
+    if (groupBy == "project") {
+        return "+project_id";
+    }
+    if (groupBy == "task") {
+        return "NULLIF(task_id, 0)";
+    }
+    if (groupBy == "day") {
+        return "day";
+    }
+    if (groupBy == "week") {
+        return "date(day, 'weekday 0', '-6 days')";
+    }
+    return "substr(day, 1, 7)";
+}
+
+// The rollup answers filters made of whole days: start at midnight, end at
+// the last second of a day, no description search. It counts an entry on
+// the day it starts, so one running past the end of the range is included.
+bool rollupConditions(const QVariantMap &filter, QStringList *conditions, QVariantMap *bindings)
+{
+    static const QRegularExpression dayStart("^\\d{4}-\\d{2}-\\d{2}T00:00:00(\\.0+)?$");
+    static const QRegularExpression dayEnd("^\\d{4}-\\d{2}-\\d{2}T23:59:59(\\.\\d+)?$");
+
+    if (!filter.value("description").toString().isEmpty()) {
+        return false;
+    }
+    const QString start = isoString(filter.value("start"));
+    const QString end = isoString(filter.value("end"));
+    if ((filter.contains("start") && !dayStart.match(start).hasMatch())
+        || (filter.contains("end") && !dayEnd.match(end).hasMatch())) {
+        return false;
+    }
+
+    if (filter.contains("projectId")) {
+        *conditions << "project_id = :projectId";
+        (*bindings)[":projectId"] = filter.value("projectId");
+    }
+    if (filter.contains("projectIds")) {
+        QStringList ids;
+        for (const QVariant &id : filter.value("projectIds").toList()) {
+            ids << QString::number(id.toInt());
+        }
+        *conditions << (ids.isEmpty() ? QString("0") : "project_id IN (" + ids.join(',') + ")");
+    }
+    if (filter.contains("taskId")) {
+        *conditions << "task_id = :taskId";
+        (*bindings)[":taskId"] = filter.value("taskId");
+    }
+    if (filter.contains("start")) {
+        *conditions << "day >= :startDay";
+        (*bindings)[":startDay"] = start.left(10);
+    }
+    if (filter.contains("end")) {
+        *conditions << "day <= :endDay";
+        (*bindings)[":endDay"] = end.left(10);
+    }
+    return true;
+}
+
+// Totals come from the rollup; the latest entry is one index probe per project
+const QString PROJECT_STATS = R"(
+    SELECT p.id, p.budget, p.hourly_rate, COALESCE(SUM(d.minutes), 0), COALESCE(SUM(d.entry_count), 0),
+           (SELECT e.end_time FROM time_entries e WHERE e.project_id = p.id ORDER BY e.start_epoch DESC LIMIT 1)
+    FROM projects p LEFT JOIN daily_project_totals d ON d.project_id = p.id
+    %1
+    GROUP BY p.id
+)";
+
+// Spent minutes through idx_time_entries_task_start; subtask counts are the
+// counters the v12 triggers keep on each task
+const QString TASK_STATS = R"(
+    SELECT t.id, t.project_id, t.allocated_time, t.due_date, t.is_active, COALESCE(SUM(e.duration), 0),
+           t.subtask_total, t.subtask_done
+    FROM tasks t LEFT JOIN time_entries e ON e.task_id = t.id
+    %1
+    GROUP BY t.id
+)";
+
+const QString SELECT_PROJECTS = "SELECT id, name, description, color, budget, hourly_rate, currency, start_date, end_date FROM projects";
+const QString SELECT_TASKS = "SELECT id, project_id, name, allocated_time, due_date, is_active FROM tasks";
+const QString SELECT_PRESENCE = "SELECT id, start_time, end_time, duration FROM office_presence";
+
+} // namespace
+
+namespace Statements {
+
+QString idList(const QList<int> &ids)
+{
+    QStringList values;
+    for (int id : ids) {
+        values << QString::number(id);
+    }
+    return values.join(',');
+}
+
+const QString SELECT_TIME_ENTRIES = "SELECT id, project_id, task_id, description, start_time, end_time, duration, start_epoch, end_epoch FROM time_entries";
+const QString ALL_TIME_ENTRIES = SELECT_TIME_ENTRIES + " ORDER BY start_epoch DESC";
+const QString TIME_ENTRIES_BY_PROJECT = SELECT_TIME_ENTRIES + " WHERE project_id = :projectId ORDER BY start_epoch DESC";
+const QString TIME_ENTRY_BY_ID = SELECT_TIME_ENTRIES + " WHERE id = :id";
+const QString INSERT_TIME_ENTRY = "INSERT INTO time_entries (project_id, task_id, description, start_time, end_time, duration) VALUES (:projectId, :taskId, :desc, :start, :end, :duration)";
+const QString UPDATE_TIME_ENTRY = "UPDATE time_entries SET project_id=:projectId, task_id=:taskId, description=:desc, start_time=:start, end_time=:end, duration=:duration WHERE id=:id";
+const QString DELETE_TIME_ENTRY = "DELETE FROM time_entries WHERE id = :id";
+const QString PROJECT_NAMES = "SELECT id, name FROM projects";
+
+QString timeEntriesByIds(const QList<int> &ids, const QVariantMap &filter, QVariantMap *bindings)
+{
+    QStringList conditions = filterConditions(filter, bindings);
+    conditions.prepend("id IN (" + idList(ids) + ")");
+    return SELECT_TIME_ENTRIES + whereClause(conditions);
+}
+
+QString timeEntryParentsByIds(const QList<int> &ids)
+{
+    return "SELECT id, project_id, task_id FROM time_entries WHERE id IN (" + idList(ids) + ")";
+}
+
+// Keyset pagination in (start_epoch DESC, id DESC) order. Every start_epoch
+// index ends with the rowid, so each page is one index range scan however
+// deep the cursor is.
+QString timeEntriesPage(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit,
+                        QVariantMap *bindings)
+{
+    QStringList conditions = filterConditions(filter, bindings);
+    if (!afterStartTime.isEmpty()) {
+        const QString afterEpoch = "CAST(strftime('%s', :afterStart) AS INTEGER)";
+        if (afterId > 0) {
+            conditions << "(start_epoch, id) < (" + afterEpoch + ", :afterId)";
+            (*bindings)[":afterId"] = afterId;
+        } else {
+            conditions << "start_epoch < " + afterEpoch;
+        }
+        (*bindings)[":afterStart"] = afterStartTime;
+    }
+    (*bindings)[":limit"] = qBound(1, limit, MAX_PAGE_SIZE);
+
+    return SELECT_TIME_ENTRIES + whereClause(conditions) + " ORDER BY start_epoch DESC, id DESC LIMIT :limit";
+}
+
+QString timeEntriesSummary(const QVariantMap &filter, QVariantMap *bindings)
+{
+    return "SELECT COUNT(*), COALESCE(SUM(duration), 0) FROM time_entries" + whereClause(filterConditions(filter, bindings));
+}
+
+QString timeEntriesAggregate(const QString &groupBy, const QVariantMap &filter, QVariantMap *bindings)
+{
+    if (groupExpression(groupBy).isEmpty()) {
+        return QString();
+    }
+
+    // Whole-day reports read O(days) rollup rows instead of every entry
+    QStringList conditions;
+    QString inner;
+    if (rollupConditions(filter, &conditions, bindings)) {
+        inner = "SELECT " + rollupGroupExpression(groupBy) + " AS group_key, SUM(minutes) AS minutes, "
+            "SUM(entry_count) AS entry_count FROM daily_project_totals" + whereClause(conditions)
+            + " GROUP BY group_key";
+    } else {
+        inner = "SELECT " + groupExpression(groupBy) + " AS group_key, SUM(duration) AS minutes, "
+            "COUNT(*) AS entry_count FROM time_entries" + whereClause(filterConditions(filter, bindings, EntryStart))
+            + " GROUP BY group_key";
+    }
+
+    if (groupBy == "project") {
+        return "SELECT g.group_key, p.name, g.minutes, g.entry_count FROM (" + inner
+            + ") g LEFT JOIN projects p ON p.id = g.group_key ORDER BY g.minutes DESC";
+    }
+    if (groupBy == "task") {
+        return "SELECT g.group_key, t.name, g.minutes, g.entry_count FROM (" + inner
+            + ") g LEFT JOIN tasks t ON t.id = g.group_key ORDER BY g.minutes DESC";
+    }
+    return "SELECT g.group_key, g.group_key, g.minutes, g.entry_count FROM (" + inner + ") g ORDER BY g.group_key";
+}
+
+const QString TIME_ENTRY_SPANS = "SELECT id, start_epoch, end_epoch FROM time_entries WHERE start_epoch IS NOT NULL";
+
+QString timeEntrySpansByIds(const QList<int> &ids)
+{
+    return TIME_ENTRY_SPANS + " AND id IN (" + idList(ids) + ")";
+}
+
+const QString ALL_PROJECTS = SELECT_PROJECTS + " ORDER BY name";
+const QString PROJECT_BY_ID = SELECT_PROJECTS + " WHERE id = :id";
+const QString INSERT_PROJECT = "INSERT INTO projects (name, description, color, budget, hourly_rate, currency, start_date, end_date) VALUES (:name, :desc, :color, :budget, :rate, :currency, :start, :end)";
+const QString UPDATE_PROJECT = "UPDATE projects SET name=:name, description=:desc, color=:color, budget=:budget, hourly_rate=:rate, currency=:currency, start_date=:start, end_date=:end WHERE id=:id";
+const QString DELETE_PROJECT = "DELETE FROM projects WHERE id = :id";
+const QString ALL_PROJECT_STATS = PROJECT_STATS.arg(QString());
+
+QString projectStatsByIds(const QList<int> &ids)
+{
+    return PROJECT_STATS.arg("WHERE p.id IN (" + idList(ids) + ")");
+}
+
+const QString ALL_TASKS = SELECT_TASKS + " ORDER BY due_date";
+const QString TASKS_BY_PROJECT = SELECT_TASKS + " WHERE project_id = :projectId ORDER BY due_date";
+const QString TASK_BY_ID = SELECT_TASKS + " WHERE id = :id";
+const QString INSERT_TASK = "INSERT INTO tasks (project_id, name, allocated_time, due_date, is_active) VALUES (:projectId, :name, :allocated, :dueDate, :isActive)";
+const QString UPDATE_TASK = "UPDATE tasks SET project_id=:projectId, name=:name, allocated_time=:allocated, due_date=:dueDate, is_active=:isActive WHERE id=:id";
+const QString DELETE_TASK = "DELETE FROM tasks WHERE id = :id";
+const QString ALL_TASK_STATS = TASK_STATS.arg(QString());
+
+QString taskStatsByIds(const QList<int> &ids)
+{
+    return TASK_STATS.arg("WHERE t.id IN (" + idList(ids) + ")");
+}
+
+QString childParentsByIds(const QString &table, const QString &column, const QList<int> &ids)
+{
+    return QString("SELECT id, %1 FROM %2 WHERE %1 IS NOT NULL AND id IN (%3)").arg(column, table, idList(ids));
+}
+
+const QString UPSERT_BLE_DEVICE = "INSERT INTO ble_devices (name, mac_address, device_type, is_enabled) VALUES (:name, :mac, :type, 1) "
+    "ON CONFLICT (mac_address) DO UPDATE SET name = excluded.name, device_type = excluded.device_type, "
+    "is_enabled = 1, updated_at = CURRENT_TIMESTAMP";
+const QString BLE_DEVICE_ID_BY_MAC = "SELECT id FROM ble_devices WHERE mac_address = :mac";
+const QString UPDATE_BLE_DEVICE_MAC = "UPDATE ble_devices SET mac_address = :mac, updated_at = CURRENT_TIMESTAMP WHERE id = :id";
+const QString DELETE_BLE_DEVICE = "DELETE FROM ble_devices WHERE id = :id";
+const QString ALL_BLE_DEVICES = "SELECT id, name, mac_address, device_type, is_enabled FROM ble_devices";
+
+const QString INSERT_PRESENCE_SESSION = "INSERT INTO office_presence (date, start_time, end_time, duration) VALUES (:date, :start, :end, :duration)";
+const QString UPDATE_PRESENCE_SESSION = "UPDATE office_presence SET end_time = :end, duration = :duration WHERE id = :id";
+const QString PRESENCE_BY_DATE = SELECT_PRESENCE + " WHERE date = :date ORDER BY start_time";
+const QString PRESENCE_TOTAL_BY_DATE = "SELECT SUM(duration) FROM office_presence WHERE date = :date";
+
+// Rows of one session share its date, start time and device
+const QString COMPACT_PRESENCE_SESSIONS = R"(
+    DELETE FROM office_presence
+    WHERE EXISTS (SELECT 1 FROM office_presence o
+                  WHERE o.date = office_presence.date AND o.start_time = office_presence.start_time
+                    AND o.device_id IS office_presence.device_id
+                    AND (o.duration > office_presence.duration
+                         OR (o.duration = office_presence.duration AND o.id > office_presence.id)))
+)";
+
+} // namespace Statements
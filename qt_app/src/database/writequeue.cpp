@@ -0,0 +1,239 @@
+#include "database/writequeue.h"
+#include "database/changebus.h"
+#include "database/sqliteapi.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QHash>
+#include <QRegularExpression>
+#include <QDebug>
+#include <utility>
+
+#ifdef HAVE_SQLITE3_API
+#include <sqlite3.h>
+#endif
+
+const int WriteQueue::FLUSH_INTERVAL_MS = 10;
+const int WriteQueue::MAX_BATCH_SIZE = 500;
+
+namespace {
+
+struct WriteResult
+{
+    bool success;
+    QVariantList lastInsertIds;
+    QString errorMessage;
+};
+
+// Runs one write's rows under a savepoint and undoes all of them if any row
+// or the savepoint itself fails, so the write is applied whole or not at all.
+// Clears *undone when a failed write could not be rolled back.
+WriteResult runWrite(QSqlQuery &query, QSqlQuery &savepoint, const QList<QVariantMap> &rows, bool *undone)
+{
+    if (!savepoint.exec("SAVEPOINT queued_write")) {
+        return { false, QVariantList(), savepoint.lastError().text() };
+    }
+
+    WriteResult result = { true, QVariantList(), QString() };
+    for (const QVariantMap &row : rows) {
+        for (auto binding = row.cbegin(); binding != row.cend(); ++binding) {
+            query.bindValue(binding.key(), binding.value());
+        }
+        if (!query.exec()) {
+            result = { false, QVariantList(), query.lastError().text() };
+            break;
+        }
+        result.lastInsertIds.append(query.lastInsertId());
+    }
+    query.finish();
+
+    if (result.success) {
+        if (savepoint.exec("RELEASE queued_write")) {
+            return result;
+        }
+        result = { false, QVariantList(), savepoint.lastError().text() };
+    }
+    // Both must succeed or the rows stay applied in the enclosing transaction
+    if (!savepoint.exec("ROLLBACK TO queued_write") || !savepoint.exec("RELEASE queued_write")) {
+        qCritical() << "Could not undo failed queued write:" << savepoint.lastError().text();
+        *undone = false;
+    }
+    return result;
+}
+
+// Captures the verb and the table of a queued INSERT, UPDATE or DELETE
+const QRegularExpression &statementPattern()
+{
+    static const QRegularExpression pattern(
+        "^\\s*(INSERT|UPDATE|DELETE)\\b(?:\\s+OR\\s+\\w+)?(?:\\s+INTO|\\s+FROM)?\\s+(\\w+)",
+        QRegularExpression::CaseInsensitiveOption);
+    return pattern;
+}
+
+} // namespace
+
+WriteQueue::WriteQueue(QObject *parent)
+    : QObject(parent)
+    , m_handle(nullptr)
+    , m_changeBus(nullptr)
+    , m_pendingRows(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(FLUSH_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &WriteQueue::flush);
+}
+
+void WriteQueue::setDatabase(const QSqlDatabase &db)
+{
+    m_db = db;
+    m_handle = SqliteApi::nativeHandle(db);
+}
+
+// Only the SQLite API can tell; without it every batch starts its own
+// transaction, and a batch that cannot is failed rather than run unguarded
+bool WriteQueue::callerTransactionOpen() const
+{
+#ifdef HAVE_SQLITE3_API
+    return m_handle && sqlite3_get_autocommit(m_handle) == 0;
+#else
+    return false;
+#endif
+}
+
+void WriteQueue::enqueue(const QString &sql, const QVariantMap &bindings, const Completion &completion)
+{
+    append({ sql, { bindings }, completion, BatchCompletion() });
+}
+
+void WriteQueue::enqueueBatch(const QString &sql, const QList<QVariantMap> &rows, const BatchCompletion &completion)
+{
+    append({ sql, rows, Completion(), completion });
+}
+
+bool WriteQueue::writesPendingTo(const QStringList &tables) const
+{
+    if (m_pendingTables.contains(QString())) {
+        return true;
+    }
+    for (const QString &table : tables) {
+        if (m_pendingTables.contains(table)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WriteQueue::append(PendingWrite write)
+{
+    m_pendingTables.insert(statementPattern().match(write.sql).captured(2));
+    m_pendingRows += write.rows.size();
+    m_pending.append(std::move(write));
+    if (m_pendingRows >= MAX_BATCH_SIZE) {
+        flush();
+    } else if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void WriteQueue::flush()
+{
+    m_timer.stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    // Completions may queue more writes; those go into the next batch
+    const QList<PendingWrite> batch = std::move(m_pending);
+    m_pending.clear();
+    m_pendingTables.clear();
+    const int rowCount = m_pendingRows;
+    m_pendingRows = 0;
+
+    // Inside a caller's transaction the savepoints nest into it instead
+    const bool ownTransaction = !callerTransactionOpen();
+    QList<WriteResult> results;
+    results.reserve(batch.size());
+
+    if (ownTransaction && !m_db.transaction()) {
+        const QString error = m_db.lastError().text();
+        qCritical() << "Write batch failed to begin:" << error;
+        for (int i = 0; i < batch.size(); ++i) {
+            results.append({ false, QVariantList(), error });
+        }
+    } else {
+        QHash<QString, QSqlQuery> statements;
+        QSqlQuery savepoint(m_db);
+        bool undone = true;
+        for (const PendingWrite &write : batch) {
+            if (!undone) {
+                results.append({ false, QVariantList(), tr("Write batch aborted") });
+                continue;
+            }
+            auto it = statements.find(write.sql);
+            if (it == statements.end()) {
+                QSqlQuery query(m_db);
+                if (!query.prepare(write.sql)) {
+                    results.append({ false, QVariantList(), query.lastError().text() });
+                    continue;
+                }
+                it = statements.insert(write.sql, query);
+            }
+            results.append(runWrite(it.value(), savepoint, write.rows, &undone));
+        }
+        statements.clear();
+
+        // Half-applied rows must not be committed: drop the whole batch
+        if (ownTransaction && !undone) {
+            m_db.rollback();
+            for (WriteResult &result : results) {
+                result = { false, QVariantList(), tr("Write batch aborted") };
+            }
+        } else if (ownTransaction && !m_db.commit()) {
+            const QString error = m_db.lastError().text();
+            qCritical() << "Write batch failed to commit:" << error;
+            m_db.rollback();
+            for (WriteResult &result : results) {
+                result = { false, QVariantList(), error };
+            }
+        }
+    }
+
+    for (int i = 0; i < batch.size(); ++i) {
+        const PendingWrite &write = batch.at(i);
+        const WriteResult &result = results.at(i);
+        if (!result.success) {
+            qWarning() << "Queued write failed:" << result.errorMessage;
+        } else if (m_changeBus && !m_changeBus->isHooked()) {
+            for (int row = 0; row < write.rows.size(); ++row) {
+                reportChange(write.sql, write.rows.at(row), result.lastInsertIds.at(row));
+            }
+        }
+        if (write.completion) {
+            write.completion(result.success, result.lastInsertIds.value(0), result.errorMessage);
+        }
+        if (write.batchCompletion) {
+            write.batchCompletion(result.success, result.lastInsertIds, result.errorMessage);
+        }
+    }
+
+    emit flushed(rowCount);
+}
+
+void WriteQueue::reportChange(const QString &sql, const QVariantMap &bindings, const QVariant &lastInsertId)
+{
+    const QRegularExpressionMatch match = statementPattern().match(sql);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    const QString verb = match.captured(1).toUpper();
+    const QString table = match.captured(2);
+    if (verb == "INSERT") {
+        m_changeBus->record(table, RowChange::Insert, lastInsertId.toLongLong());
+    } else if (bindings.contains(":id")) {
+        m_changeBus->record(table, verb == "UPDATE" ? RowChange::Update : RowChange::Delete,
+                            bindings.value(":id").toLongLong());
+    } else {
+        // Statement not keyed by id: the affected rows are unknown
+        m_changeBus->record(table, RowChange::Reset, -1);
+    }
+}
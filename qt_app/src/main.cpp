@@ -4,10 +4,16 @@
 #include <QIcon>
 #include <QTranslator>
 #include <QLocale>
+#include <QElapsedTimer>
+#include <QQuickWindow>
+#include <memory>
 
 #include "database/database.h"
+#include "database/changebus.h"
+#include "database/databasebackup.h"
 #include "managers/projectmanager.h"
 #include "managers/timeentrymanager.h"
+#include "managers/timeentrylistmodel.h"
 #include "managers/taskmanager.h"
 #include "managers/settingsmanager.h"
 #ifdef HAVE_QT_BLUETOOTH
@@ -15,9 +21,13 @@
 #include "ble/presencemonitor.h"
 #endif
 #include "utils/datetimeutils.h"
+#include "utils/datagenerator.h"
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+    
     QGuiApplication app(argc, argv);
     
     // Set application metadata
@@ -34,6 +44,14 @@ int main(int argc, char *argv[])
         qInfo() << "[DEMO MODE] Running in demo mode with in-memory database";
     }
     
+    // --demo_size=N fills the demo database with N generated time entries
+    qint64 demoSize = 0;
+    for (const QString &arg : args) {
+        if (arg.startsWith("--demo_size=")) {
+            demoSize = arg.mid(int(qstrlen("--demo_size="))).toLongLong();
+        }
+    }
+    
     // Initialize database
     Database *database = Database::instance();
     if (demoMode) {
@@ -45,6 +63,20 @@ int main(int argc, char *argv[])
         qCritical() << "Failed to initialize database";
         return -1;
     }
+    qInfo() << "[STARTUP] Database initialized after" << startupTimer.elapsed() << "ms";
+    
+    if (demoMode && demoSize > 0) {
+        QSqlDatabase db = database->database();
+        // The demo ends today so the current week has data
+        if (!DataGenerator::generate(db, demoSize, DataGenerator::DEFAULT_SEED, {}, nullptr, QDate::currentDate())) {
+            qWarning() << "[DEMO MODE] Could not generate demo data";
+        }
+        // The generator writes past the write queue
+        for (const QString &table : DatabaseBackup::backupTables()) {
+            database->changeBus()->record(table, RowChange::Reset, -1);
+        }
+        qInfo() << "[STARTUP] Demo data generated after" << startupTimer.elapsed() << "ms";
+    }
 
     
     // Create managers
@@ -83,6 +115,7 @@ int main(int argc, char *argv[])
     qmlRegisterSingletonInstance("ProjectTimeTracker", 1, 0, "PresenceMonitor", &presenceMonitor);
 #endif
     qmlRegisterSingletonInstance("ProjectTimeTracker", 1, 0, "DateTimeUtils", &dateTimeUtils);
+    qmlRegisterType<TimeEntryListModel>("ProjectTimeTracker", 1, 0, "TimeEntryListModel");
     
     // Set demo mode context property
     engine.rootContext()->setContextProperty("isDemoMode", demoMode);
@@ -102,6 +135,12 @@ int main(int argc, char *argv[])
     if (engine.rootObjects().isEmpty()) {
         qCritical() << "Failed to load QML";
         //return -1;
+    } else if (QQuickWindow *window = qobject_cast<QQuickWindow *>(engine.rootObjects().first())) {
+        auto firstFrame = std::make_shared<QMetaObject::Connection>();
+        *firstFrame = QObject::connect(window, &QQuickWindow::frameSwapped, &app, [firstFrame, &startupTimer]() {
+            qInfo() << "[STARTUP] First frame after" << startupTimer.elapsed() << "ms";
+            QObject::disconnect(*firstFrame);
+        }, Qt::QueuedConnection);
     }
     
     return app.exec();
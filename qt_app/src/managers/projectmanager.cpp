@@ -1,69 +1,123 @@
 #include "managers/projectmanager.h"
 #include "database/database.h"
+#include "database/asyncquery.h"
+#include "database/changebus.h"
+#include "database/statements.h"
+#include "managers/projectstatscache.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
 
-ProjectManager::ProjectManager(QObject *parent) : QObject(parent) {}
+ProjectManager::ProjectManager(QObject *parent)
+    : QObject(parent)
+    , m_stats(new ProjectStatsCache(this))
+{
+}
 
-QVariantList ProjectManager::getAllProjects()
+namespace {
+
+// What the project reads depend on, for Database::flushPendingWrites
+const QStringList PROJECT_TABLES = { "projects" };
+
+QVariantMap readProject(const QSqlQuery &query)
+{
+    QVariantMap project;
+    project["id"] = query.value(0).toInt();
+    project["name"] = query.value(1).toString();
+    project["description"] = query.value(2).toString();
+    project["color"] = query.value(3).toString();
+    project["budget"] = query.value(4).toDouble();
+    project["hourlyRate"] = query.value(5).toDouble();
+    project["currency"] = query.value(6).toString();
+    project["startDate"] = query.value(7).toString();
+    project["endDate"] = query.value(8).toString();
+    return project;
+}
+
+// Safe to call from any thread: uses that thread's pooled connection
+QVariantList queryProjects(const QString &sql, const QVariantMap &bindings, QString *errorMessage)
 {
     QVariantList result;
     QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (auto it = bindings.cbegin(); it != bindings.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
     
-    if (!query.exec("SELECT id, name, description, color, budget, hourly_rate, currency, start_date, end_date FROM projects ORDER BY name")) {
-        emit error(query.lastError().text());
+    if (!query.exec()) {
+        *errorMessage = query.lastError().text();
         return result;
     }
     
     while (query.next()) {
-        QVariantMap project;
-        project["id"] = query.value(0).toInt();
-        project["name"] = query.value(1).toString();
-        project["description"] = query.value(2).toString();
-        project["color"] = query.value(3).toString();
-        project["budget"] = query.value(4).toDouble();
-        project["hourlyRate"] = query.value(5).toDouble();
-        project["currency"] = query.value(6).toString();
-        project["startDate"] = query.value(7).toString();
-        project["endDate"] = query.value(8).toString();
-        result.append(project);
+        result.append(readProject(query));
     }
     
     return result;
 }
 
-QVariantMap ProjectManager::getProject(int id)
+// Project writes run directly on the primary connection; without the
+// update hook nothing else reports them
+void reportChange(const QString &table, RowChange::Operation operation, qint64 rowId)
 {
-    QVariantMap result;
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, name, description, color, budget, hourly_rate, currency, start_date, end_date FROM projects WHERE id = :id");
-    query.bindValue(":id", id);
-    
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return result;
+    ChangeBus *bus = Database::instance()->changeBus();
+    if (!bus->isHooked()) {
+        bus->record(table, operation, rowId);
     }
-    
-    if (query.next()) {
-        result["id"] = query.value(0).toInt();
-        result["name"] = query.value(1).toString();
-        result["description"] = query.value(2).toString();
-        result["color"] = query.value(3).toString();
-        result["budget"] = query.value(4).toDouble();
-        result["hourlyRate"] = query.value(5).toDouble();
-        result["currency"] = query.value(6).toString();
-        result["startDate"] = query.value(7).toString();
-        result["endDate"] = query.value(8).toString();
+}
+
+} // namespace
+
+QVariantList ProjectManager::getAllProjects()
+{
+    QString errorMessage;
+    QVariantList result = queryProjects(Statements::ALL_PROJECTS, QVariantMap(), &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
     }
-    
     return result;
 }
 
+QVariantMap ProjectManager::getProject(int id)
+{
+    QString errorMessage;
+    QVariantList result = queryProjects(Statements::PROJECT_BY_ID, {{":id", id}}, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
+    return result.isEmpty() ? QVariantMap() : result.first().toMap();
+}
+
+QFuture<QVariantList> ProjectManager::getAllProjectsAsync()
+{
+    return AsyncQuery::run(this, PROJECT_TABLES, [](QString *errorMessage) {
+        return queryProjects(Statements::ALL_PROJECTS, QVariantMap(), errorMessage);
+    });
+}
+
+QFuture<QVariantMap> ProjectManager::getProjectAsync(int id)
+{
+    return AsyncQuery::run(this, PROJECT_TABLES, [id](QString *errorMessage) {
+        const QVariantList result = queryProjects(Statements::PROJECT_BY_ID, {{":id", id}}, errorMessage);
+        return result.isEmpty() ? QVariantMap() : result.first().toMap();
+    });
+}
+
+void ProjectManager::getAllProjectsAsync(const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getAllProjectsAsync(), callback);
+}
+
+void ProjectManager::getProjectAsync(int id, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getProjectAsync(id), callback);
+}
+
 bool ProjectManager::createProject(const QVariantMap &projectData)
 {
     QSqlQuery query(Database::instance()->database());
-    query.prepare("INSERT INTO projects (name, description, color, budget, hourly_rate, currency, start_date, end_date) VALUES (:name, :desc, :color, :budget, :rate, :currency, :start, :end)");
+    query.prepare(Statements::INSERT_PROJECT);
     query.bindValue(":name", projectData.value("name"));
     query.bindValue(":desc", projectData.value("description"));
     query.bindValue(":color", projectData.value("color", "#3498db"));
@@ -79,6 +133,8 @@ bool ProjectManager::createProject(const QVariantMap &projectData)
     }
     
     int id = query.lastInsertId().toInt();
+    reportChange("projects", RowChange::Insert, id);
+    m_stats->markDirty(id);
     emit projectCreated(id);
     emit projectsChanged();
     return true;
@@ -87,7 +143,7 @@ bool ProjectManager::createProject(const QVariantMap &projectData)
 bool ProjectManager::updateProject(int id, const QVariantMap &projectData)
 {
     QSqlQuery query(Database::instance()->database());
-    query.prepare("UPDATE projects SET name=:name, description=:desc, color=:color, budget=:budget, hourly_rate=:rate, currency=:currency, start_date=:start, end_date=:end WHERE id=:id");
+    query.prepare(Statements::UPDATE_PROJECT);
     query.bindValue(":id", id);
     query.bindValue(":name", projectData.value("name"));
     query.bindValue(":desc", projectData.value("description"));
@@ -103,6 +159,8 @@ bool ProjectManager::updateProject(int id, const QVariantMap &projectData)
         return false;
     }
     
+    reportChange("projects", RowChange::Update, id);
+    m_stats->markDirty(id);
     emit projectUpdated(id);
     emit projectsChanged();
     return true;
@@ -110,8 +168,10 @@ bool ProjectManager::updateProject(int id, const QVariantMap &projectData)
 
 bool ProjectManager::deleteProject(int id)
 {
+    // Queued task and time entry writes may still reference the project
+    Database::instance()->flushPendingWrites();
     QSqlQuery query(Database::instance()->database());
-    query.prepare("DELETE FROM projects WHERE id = :id");
+    query.prepare(Statements::DELETE_PROJECT);
     query.bindValue(":id", id);
     
     if (!query.exec()) {
@@ -119,6 +179,8 @@ bool ProjectManager::deleteProject(int id)
         return false;
     }
     
+    reportChange("projects", RowChange::Delete, id);
+    m_stats->markDirty(id);
     emit projectDeleted(id);
     emit projectsChanged();
     return true;
@@ -126,9 +188,10 @@ bool ProjectManager::deleteProject(int id)
 
 QVariantMap ProjectManager::getProjectStats(int id)
 {
-    QVariantMap stats;
-    stats["totalMinutes"] = 0;
-    stats["totalEarnings"] = 0.0;
-    // TODO: Calculate actual stats from time_entries
-    return stats;
+    return m_stats->stats(id);
+}
+
+QVariantList ProjectManager::getAllProjectStats()
+{
+    return m_stats->allStats();
 }
@@ -0,0 +1,101 @@
+#include "managers/projectstatscache.h"
+#include "database/database.h"
+#include "database/statements.h"
+#include <algorithm>
+
+namespace {
+
+QVariantMap readStats(const QSqlQuery &query)
+{
+    const double budget = query.value(1).toDouble();
+    const qint64 minutes = query.value(3).toLongLong();
+    const double earnings = minutes / 60.0 * query.value(2).toDouble();
+
+    QVariantMap stats;
+    stats["projectId"] = query.value(0).toInt();
+    stats["totalMinutes"] = minutes;
+    stats["entryCount"] = query.value(4).toInt();
+    stats["totalEarnings"] = earnings;
+    stats["budget"] = budget;
+    stats["budgetConsumed"] = earnings;
+    stats["budgetRemaining"] = budget - earnings;
+    stats["budgetPercent"] = budget > 0 ? earnings / budget * 100.0 : 0.0;
+    stats["lastActivity"] = query.value(5).toString();
+    return stats;
+}
+
+} // namespace
+
+ProjectStatsCache::ProjectStatsCache(QObject *parent)
+    : QObject(parent)
+    , m_stats("project", Statements::ALL_PROJECT_STATS, Statements::projectStatsByIds, readStats)
+    , m_entries("time_entries", "project_id")
+{
+    connect(Database::instance()->changeBus(), &ChangeBus::rowsChanged, this, &ProjectStatsCache::onRowsChanged);
+}
+
+QVariantMap ProjectStatsCache::stats(int projectId)
+{
+    ensureCurrent();
+    return m_stats.value(projectId);
+}
+
+QVariantList ProjectStatsCache::allStats()
+{
+    ensureCurrent();
+    // Only stale projects are recomputed, unless most of them are, when
+    // all() reads every project with one grouped query
+    const QHash<int, QVariantMap> &stats = m_stats.all();
+    QList<int> ids = stats.keys();
+    std::sort(ids.begin(), ids.end());
+
+    QVariantList result;
+    for (int id : ids) {
+        result.append(stats.value(id));
+    }
+    return result;
+}
+
+void ProjectStatsCache::markDirty(int projectId)
+{
+    m_stats.markDirty(projectId);
+}
+
+void ProjectStatsCache::invalidate()
+{
+    m_stats.clear();
+    m_entries.clear();
+}
+
+void ProjectStatsCache::onRowsChanged(const QList<RowChange> &changes)
+{
+    for (const RowChange &change : changes) {
+        const int id = int(change.rowId);
+        if (change.table == "projects") {
+            if (change.operation == RowChange::Reset) {
+                m_stats.clear();
+            } else if (change.operation == RowChange::Delete) {
+                m_stats.remove(id);
+            } else {
+                m_stats.markDirty(id);
+            }
+        } else if (change.table == m_entries.table()) {
+            if (change.operation == RowChange::Reset) {
+                invalidate();
+                return;
+            }
+            m_entries.markChanged(id);
+        }
+    }
+}
+
+void ProjectStatsCache::ensureCurrent()
+{
+    // Queued writes and their change notifications land before the read
+    Database::instance()->flushPendingWrites({ "projects", "time_entries" });
+    Database::instance()->changeBus()->flush();
+
+    if (!m_entries.resolveChanged(&m_stats)) {
+        invalidate();
+    }
+}
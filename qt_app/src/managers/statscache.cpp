@@ -0,0 +1,114 @@
+#include "managers/statscache.h"
+#include "database/database.h"
+#include "database/statements.h"
+#include <QSqlError>
+#include <QDebug>
+#include <utility>
+
+const int StatsCache::IDS_PER_QUERY = 500;
+
+StatsCache::StatsCache(const QString &name, const QString &allStatement, StatementForIds statementForIds, ReadRow readRow)
+    : m_name(name)
+    , m_allStatement(allStatement)
+    , m_statementForIds(std::move(statementForIds))
+    , m_readRow(std::move(readRow))
+    , m_complete(false)
+{
+}
+
+QVariantMap StatsCache::value(int id)
+{
+    if (!m_stats.contains(id) || m_dirty.contains(id)) {
+        refresh({ id });
+    }
+    return m_stats.value(id);
+}
+
+const QHash<int, QVariantMap> &StatsCache::all()
+{
+    if (!m_complete || (!m_dirty.isEmpty() && m_dirty.size() >= m_stats.size())) {
+        refreshAll();
+    } else if (!m_dirty.isEmpty()) {
+        refresh(m_dirty.values());
+    }
+    return m_stats;
+}
+
+void StatsCache::remove(int id)
+{
+    m_stats.remove(id);
+    m_dirty.remove(id);
+}
+
+void StatsCache::clear()
+{
+    m_stats.clear();
+    m_dirty.clear();
+    m_complete = false;
+}
+
+bool StatsCache::refresh(const QList<int> &ids)
+{
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    for (int from = 0; from < ids.size(); from += IDS_PER_QUERY) {
+        const QList<int> chunk = ids.mid(from, IDS_PER_QUERY);
+        if (!query.exec(m_statementForIds(chunk))) {
+            qWarning() << "Failed to compute" << m_name << "stats:" << query.lastError().text();
+            return false;
+        }
+        // Rows that no longer exist simply drop out
+        for (int id : chunk) {
+            remove(id);
+        }
+        while (query.next()) {
+            m_stats.insert(query.value(0).toInt(), m_readRow(query));
+        }
+    }
+    return true;
+}
+
+bool StatsCache::refreshAll()
+{
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    if (!query.exec(m_allStatement)) {
+        qWarning() << "Failed to compute" << m_name << "stats:" << query.lastError().text();
+        return false;
+    }
+    m_stats.clear();
+    while (query.next()) {
+        m_stats.insert(query.value(0).toInt(), m_readRow(query));
+    }
+    m_dirty.clear();
+    m_complete = true;
+    return true;
+}
+
+ChildChanges::ChildChanges(const QString &table, const QString &column)
+    : m_table(table)
+    , m_column(column)
+{
+}
+
+bool ChildChanges::resolveChanged(StatsCache *stats)
+{
+    if (m_changed.isEmpty()) {
+        return true;
+    }
+
+    const QList<int> changed = m_changed.values();
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    for (int from = 0; from < changed.size(); from += StatsCache::IDS_PER_QUERY) {
+        if (!query.exec(Statements::childParentsByIds(m_table, m_column, changed.mid(from, StatsCache::IDS_PER_QUERY)))) {
+            qWarning() << "Failed to read changed" << m_table << "parent ids:" << query.lastError().text();
+            return false;
+        }
+        while (query.next()) {
+            stats->markDirty(query.value(1).toInt());
+        }
+    }
+    m_changed.clear();
+    return true;
+}
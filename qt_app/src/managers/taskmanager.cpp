@@ -1,157 +1,306 @@
 #include "managers/taskmanager.h"
 #include "database/database.h"
+#include "database/asyncquery.h"
+#include "database/statements.h"
+#include "database/writequeue.h"
+#include "managers/taskstatscache.h"
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QPointer>
 
-TaskManager::TaskManager(QObject *parent) : QObject(parent) {}
+TaskManager::TaskManager(QObject *parent)
+    : QObject(parent)
+    , m_changesPending(false)
+    , m_stats(new TaskStatsCache(this))
+{
+    // One tasksChanged() per committed batch rather than per write
+    connect(Database::instance()->writeQueue(), &WriteQueue::flushed, this, [this]() {
+        if (m_changesPending) {
+            m_changesPending = false;
+            emit tasksChanged();
+        }
+    });
+}
 
-QVariantList TaskManager::getAllTasks()
+namespace {
+
+// What the task reads depend on, for Database::flushPendingWrites
+const QStringList TASK_TABLES = { "tasks" };
+
+QVariantMap readTask(const QSqlQuery &query)
+{
+    QVariantMap task;
+    task["id"] = query.value(0).toInt();
+    task["projectId"] = query.value(1).toInt();
+    task["name"] = query.value(2).toString();
+    task["allocatedMinutes"] = query.value(3).toInt();
+    task["dueDate"] = query.value(4).toString();
+    task["isActive"] = query.value(5).toBool();
+    return task;
+}
+
+QVariantMap taskBindings(const QVariantMap &taskData, const QVariant &defaultAllocated)
+{
+    QVariantMap bindings;
+    bindings[":projectId"] = taskData.value("projectId");
+    bindings[":name"] = taskData.value("name");
+    bindings[":allocated"] = taskData.value("allocatedMinutes", defaultAllocated);
+    bindings[":dueDate"] = taskData.value("dueDate");
+    bindings[":isActive"] = taskData.value("isActive", false);
+    return bindings;
+}
+
+// Safe to call from any thread: uses that thread's pooled connection
+QVariantList queryTasks(const QString &sql, const QVariantMap &bindings, QString *errorMessage)
 {
+    Database::instance()->flushPendingWrites(TASK_TABLES);
     QVariantList result;
     QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (auto it = bindings.cbegin(); it != bindings.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
     
-    if (!query.exec("SELECT id, project_id, name, description, allocated_minutes, due_date, status FROM tasks ORDER BY due_date")) {
-        emit error(query.lastError().text());
+    if (!query.exec()) {
+        *errorMessage = query.lastError().text();
         return result;
     }
     
     while (query.next()) {
-        QVariantMap task;
-        task["id"] = query.value(0).toInt();
-        task["projectId"] = query.value(1).toInt();
-        task["name"] = query.value(2).toString();
-        task["description"] = query.value(3).toString();
-        task["allocatedMinutes"] = query.value(4).toInt();
-        task["dueDate"] = query.value(5).toString();
-        task["status"] = query.value(6).toString();
-        result.append(task);
+        result.append(readTask(query));
     }
     
     return result;
 }
 
-QVariantList TaskManager::getTasksByProject(int projectId)
+} // namespace
+
+QVariantList TaskManager::getAllTasks()
 {
-    QVariantList result;
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, project_id, name, description, allocated_minutes, due_date, status FROM tasks WHERE project_id = :projectId ORDER BY due_date");
-    query.bindValue(":projectId", projectId);
-    
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return result;
+    QString errorMessage;
+    QVariantList result = queryTasks(Statements::ALL_TASKS, QVariantMap(), &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
     }
-    
-    while (query.next()) {
-        QVariantMap task;
-        task["id"] = query.value(0).toInt();
-        task["projectId"] = query.value(1).toInt();
-        task["name"] = query.value(2).toString();
-        task["description"] = query.value(3).toString();
-        task["allocatedMinutes"] = query.value(4).toInt();
-        task["dueDate"] = query.value(5).toString();
-        task["status"] = query.value(6).toString();
-        result.append(task);
+    return result;
+}
+
+QVariantList TaskManager::getTasksByProject(int projectId)
+{
+    QString errorMessage;
+    QVariantList result = queryTasks(Statements::TASKS_BY_PROJECT, {{":projectId", projectId}}, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
     }
-    
     return result;
 }
 
 QVariantMap TaskManager::getTask(int id)
 {
-    QVariantMap result;
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, project_id, name, description, allocated_minutes, due_date, status FROM tasks WHERE id = :id");
-    query.bindValue(":id", id);
-    
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return result;
+    QString errorMessage;
+    QVariantList result = queryTasks(Statements::TASK_BY_ID, {{":id", id}}, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
     }
-    
-    if (query.next()) {
-        result["id"] = query.value(0).toInt();
-        result["projectId"] = query.value(1).toInt();
-        result["name"] = query.value(2).toString();
-        result["description"] = query.value(3).toString();
-        result["allocatedMinutes"] = query.value(4).toInt();
-        result["dueDate"] = query.value(5).toString();
-        result["status"] = query.value(6).toString();
-    }
-    
-    return result;
+    return result.isEmpty() ? QVariantMap() : result.first().toMap();
+}
+
+QFuture<QVariantList> TaskManager::getAllTasksAsync()
+{
+    return AsyncQuery::run(this, TASK_TABLES, [](QString *errorMessage) {
+        return queryTasks(Statements::ALL_TASKS, QVariantMap(), errorMessage);
+    });
+}
+
+QFuture<QVariantList> TaskManager::getTasksByProjectAsync(int projectId)
+{
+    return AsyncQuery::run(this, TASK_TABLES, [projectId](QString *errorMessage) {
+        return queryTasks(Statements::TASKS_BY_PROJECT, {{":projectId", projectId}}, errorMessage);
+    });
+}
+
+QFuture<QVariantMap> TaskManager::getTaskAsync(int id)
+{
+    return AsyncQuery::run(this, TASK_TABLES, [id](QString *errorMessage) {
+        const QVariantList result = queryTasks(Statements::TASK_BY_ID, {{":id", id}}, errorMessage);
+        return result.isEmpty() ? QVariantMap() : result.first().toMap();
+    });
+}
+
+void TaskManager::getAllTasksAsync(const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getAllTasksAsync(), callback);
+}
+
+void TaskManager::getTasksByProjectAsync(int projectId, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getTasksByProjectAsync(projectId), callback);
+}
+
+void TaskManager::getTaskAsync(int id, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getTaskAsync(id), callback);
 }
 
 bool TaskManager::createTask(const QVariantMap &taskData)
 {
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("INSERT INTO tasks (project_id, name, description, allocated_minutes, due_date, status) VALUES (:projectId, :name, :desc, :allocated, :dueDate, :status)");
-    query.bindValue(":projectId", taskData.value("projectId"));
-    query.bindValue(":name", taskData.value("name"));
-    query.bindValue(":desc", taskData.value("description"));
-    query.bindValue(":allocated", taskData.value("allocatedMinutes", 0));
-    query.bindValue(":dueDate", taskData.value("dueDate"));
-    query.bindValue(":status", taskData.value("status", "pending"));
+    QPointer<TaskManager> self(this);
+    Database::instance()->writeQueue()->enqueue(Statements::INSERT_TASK, taskBindings(taskData, 0),
+        [self](bool success, const QVariant &lastInsertId, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->taskCreated(lastInsertId.toInt());
+    });
+    return true;
+}
+
+bool TaskManager::updateTask(int id, const QVariantMap &taskData)
+{
+    QVariantMap bindings = taskBindings(taskData, QVariant());
+    bindings[":id"] = id;
     
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return false;
+    QPointer<TaskManager> self(this);
+    Database::instance()->writeQueue()->enqueue(Statements::UPDATE_TASK, bindings,
+        [self, id](bool success, const QVariant &, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->taskUpdated(id);
+    });
+    return true;
+}
+
+bool TaskManager::deleteTask(int id)
+{
+    QPointer<TaskManager> self(this);
+    Database::instance()->writeQueue()->enqueue(Statements::DELETE_TASK, {{":id", id}},
+        [self, id](bool success, const QVariant &, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->taskDeleted(id);
+    });
+    return true;
+}
+
+bool TaskManager::createTasks(const QVariantList &tasks)
+{
+    if (tasks.isEmpty()) {
+        return true;
+    }
+    
+    QList<QVariantMap> rows;
+    rows.reserve(tasks.size());
+    for (const QVariant &task : tasks) {
+        rows.append(taskBindings(task.toMap(), 0));
     }
     
-    emit taskCreated(query.lastInsertId().toInt());
-    emit tasksChanged();
+    QPointer<TaskManager> self(this);
+    Database::instance()->writeQueue()->enqueueBatch(Statements::INSERT_TASK, rows,
+        [self](bool success, const QVariantList &lastInsertIds, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        QList<int> ids;
+        for (const QVariant &id : lastInsertIds) {
+            ids.append(id.toInt());
+        }
+        self->m_changesPending = true;
+        emit self->tasksCreated(ids);
+    });
     return true;
 }
 
-bool TaskManager::updateTask(int id, const QVariantMap &taskData)
+bool TaskManager::updateTasks(const QVariantList &tasks)
 {
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("UPDATE tasks SET project_id=:projectId, name=:name, description=:desc, allocated_minutes=:allocated, due_date=:dueDate, status=:status WHERE id=:id");
-    query.bindValue(":id", id);
-    query.bindValue(":projectId", taskData.value("projectId"));
-    query.bindValue(":name", taskData.value("name"));
-    query.bindValue(":desc", taskData.value("description"));
-    query.bindValue(":allocated", taskData.value("allocatedMinutes"));
-    query.bindValue(":dueDate", taskData.value("dueDate"));
-    query.bindValue(":status", taskData.value("status"));
+    if (tasks.isEmpty()) {
+        return true;
+    }
     
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return false;
+    QList<QVariantMap> rows;
+    QList<int> ids;
+    rows.reserve(tasks.size());
+    for (const QVariant &value : tasks) {
+        const QVariantMap task = value.toMap();
+        QVariantMap bindings = taskBindings(task, QVariant());
+        bindings[":id"] = task.value("id");
+        rows.append(bindings);
+        ids.append(task.value("id").toInt());
     }
     
-    emit taskUpdated(id);
-    emit tasksChanged();
+    QPointer<TaskManager> self(this);
+    Database::instance()->writeQueue()->enqueueBatch(Statements::UPDATE_TASK, rows,
+        [self, ids](bool success, const QVariantList &, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->tasksUpdated(ids);
+    });
     return true;
 }
 
-bool TaskManager::deleteTask(int id)
+bool TaskManager::deleteTasks(const QList<int> &ids)
 {
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("DELETE FROM tasks WHERE id = :id");
-    query.bindValue(":id", id);
+    if (ids.isEmpty()) {
+        return true;
+    }
     
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return false;
+    QList<QVariantMap> rows;
+    rows.reserve(ids.size());
+    for (int id : ids) {
+        QVariantMap bindings;
+        bindings[":id"] = id;
+        rows.append(bindings);
     }
     
-    emit taskDeleted(id);
-    emit tasksChanged();
+    QPointer<TaskManager> self(this);
+    Database::instance()->writeQueue()->enqueueBatch(Statements::DELETE_TASK, rows,
+        [self, ids](bool success, const QVariantList &, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->tasksDeleted(ids);
+    });
     return true;
 }
 
 QVariantMap TaskManager::getTaskStats(int id)
 {
-    QVariantMap stats;
-    // TODO: Implement
-    return stats;
+    return m_stats->stats(id);
 }
 
-QVariantMap TaskManager::taskToVariantMap(const TaskModel &task)
+QVariantList TaskManager::getAllTaskStats(const QVariantMap &filter)
 {
-    QVariantMap map;
-    // TODO: Implement
-    return map;
+    return m_stats->allStats(filter);
 }
-
@@ -0,0 +1,132 @@
+#include "managers/taskstatscache.h"
+#include "database/database.h"
+#include "database/statements.h"
+#include <algorithm>
+
+namespace {
+
+QVariantMap readStats(const QSqlQuery &query, const QDate &today)
+{
+    const int allocated = query.value(2).toInt();
+    const qint64 spent = query.value(5).toLongLong();
+    const int subtaskTotal = query.value(6).toInt();
+    const int subtaskDone = query.value(7).toInt();
+    const QString dueDate = query.value(3).toString();
+    const QDate due = QDate::fromString(dueDate.left(10), Qt::ISODate);
+    const bool finished = subtaskTotal > 0 && subtaskDone == subtaskTotal;
+
+    QVariantMap stats;
+    stats["taskId"] = query.value(0).toInt();
+    stats["projectId"] = query.value(1).toInt();
+    stats["isActive"] = query.value(4).toBool();
+    stats["dueDate"] = dueDate;
+    stats["spentMinutes"] = spent;
+    stats["allocatedMinutes"] = allocated;
+    stats["percentUsed"] = allocated > 0 ? spent * 100.0 / allocated : 0.0;
+    stats["subtaskTotal"] = subtaskTotal;
+    stats["subtaskDone"] = subtaskDone;
+    stats["overdue"] = due.isValid() && due < today && !finished;
+    return stats;
+}
+
+} // namespace
+
+TaskStatsCache::TaskStatsCache(QObject *parent)
+    : QObject(parent)
+    , m_stats("task", Statements::ALL_TASK_STATS, Statements::taskStatsByIds,
+              [this](const QSqlQuery &query) { return readStats(query, m_computedOn); })
+    , m_entries("time_entries", "task_id")
+{
+    connect(Database::instance()->changeBus(), &ChangeBus::rowsChanged, this, &TaskStatsCache::onRowsChanged);
+}
+
+QVariantMap TaskStatsCache::stats(int taskId)
+{
+    if (!ensureCurrent()) {
+        return QVariantMap();
+    }
+    return m_stats.value(taskId);
+}
+
+QVariantList TaskStatsCache::allStats(const QVariantMap &filter)
+{
+    QVariantList result;
+    if (!ensureCurrent()) {
+        return result;
+    }
+
+    QList<QVariantMap> matching;
+    for (const QVariantMap &stats : m_stats.all()) {
+        if (filter.contains("projectId") && stats.value("projectId").toInt() != filter.value("projectId").toInt()) {
+            continue;
+        }
+        if (filter.contains("isActive") && stats.value("isActive").toBool() != filter.value("isActive").toBool()) {
+            continue;
+        }
+        matching.append(stats);
+    }
+    std::sort(matching.begin(), matching.end(), [](const QVariantMap &a, const QVariantMap &b) {
+        const QString dueA = a.value("dueDate").toString();
+        const QString dueB = b.value("dueDate").toString();
+        return dueA != dueB ? dueA < dueB : a.value("taskId").toInt() < b.value("taskId").toInt();
+    });
+    for (const QVariantMap &stats : std::as_const(matching)) {
+        result.append(stats);
+    }
+    return result;
+}
+
+void TaskStatsCache::markDirty(int taskId)
+{
+    m_stats.markDirty(taskId);
+}
+
+void TaskStatsCache::invalidate()
+{
+    m_stats.clear();
+    m_entries.clear();
+}
+
+void TaskStatsCache::onRowsChanged(const QList<RowChange> &changes)
+{
+    for (const RowChange &change : changes) {
+        const int id = int(change.rowId);
+        if (change.table == "tasks") {
+            if (change.operation == RowChange::Reset) {
+                m_stats.clear();
+            } else if (change.operation == RowChange::Delete) {
+                m_stats.remove(id);
+            } else {
+                m_stats.markDirty(id);
+            }
+            continue;
+        }
+
+        if (change.table != m_entries.table()) {
+            continue;
+        }
+        if (change.operation == RowChange::Reset) {
+            invalidate();
+            return;
+        }
+        m_entries.markChanged(id);
+    }
+}
+
+bool TaskStatsCache::ensureCurrent()
+{
+    // Queued writes and their change notifications land before the read
+    Database::instance()->flushPendingWrites({ "tasks", "subtasks", "time_entries" });
+    Database::instance()->changeBus()->flush();
+
+    if (m_computedOn != QDate::currentDate()) {
+        m_stats.clear();
+        m_computedOn = QDate::currentDate();
+    }
+
+    if (!m_entries.resolveChanged(&m_stats)) {
+        invalidate();
+        return false;
+    }
+    return true;
+}
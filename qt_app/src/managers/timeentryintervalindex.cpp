@@ -0,0 +1,238 @@
+#include "managers/timeentryintervalindex.h"
+#include "database/database.h"
+#include "database/statements.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QPointer>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+const int TimeEntryIntervalIndex::MAX_OVERLAY_SIZE = 1024;
+
+namespace {
+
+const int IDS_PER_QUERY = 500;
+
+} // namespace
+
+TimeEntryIntervalIndex::TimeEntryIntervalIndex(QObject *parent)
+    : QObject(parent)
+    , m_loaded(false)
+{
+    connect(Database::instance()->changeBus(), &ChangeBus::rowsChanged, this, &TimeEntryIntervalIndex::onRowsChanged);
+}
+
+TimeEntryIntervalIndex *TimeEntryIntervalIndex::instance()
+{
+    // A child of the Database, so a new Database starts with a fresh index
+    static QPointer<TimeEntryIntervalIndex> s_instance;
+    if (!s_instance) {
+        s_instance = new TimeEntryIntervalIndex(Database::instance());
+    }
+    return s_instance;
+}
+
+qint64 TimeEntryIntervalIndex::toEpoch(const QString &isoDateTime)
+{
+    // Mirrors strftime('%s', ...): an explicit zone is honoured, a bare
+    // wall-clock time is read as UTC
+    static const QRegularExpression zoneSuffix("(Z|[+-]\\d{2}:?\\d{2})$");
+    const bool hasZone = isoDateTime.indexOf('T') > 0 && zoneSuffix.match(isoDateTime).hasMatch();
+    const QDateTime parsed = QDateTime::fromString(hasZone ? isoDateTime : isoDateTime + "Z", Qt::ISODate);
+    return parsed.isValid() ? parsed.toSecsSinceEpoch() : 0;
+}
+
+QList<int> TimeEntryIntervalIndex::overlapping(qint64 start, qint64 end, int excludeId)
+{
+    QList<int> ids;
+    if (start >= end || !ensureCurrent()) {
+        return ids;
+    }
+
+    collect(0, m_spans.size(), start, end, excludeId, &ids, false);
+    for (const Span &span : std::as_const(m_overlay)) {
+        if (span.start < end && span.end > start && span.id != excludeId) {
+            ids.append(span.id);
+        }
+    }
+    return ids;
+}
+
+bool TimeEntryIntervalIndex::overlapsAny(qint64 start, qint64 end, int excludeId)
+{
+    if (start >= end || !ensureCurrent()) {
+        return false;
+    }
+
+    for (const Span &span : std::as_const(m_overlay)) {
+        if (span.start < end && span.end > start && span.id != excludeId) {
+            return true;
+        }
+    }
+    QList<int> ids;
+    collect(0, m_spans.size(), start, end, excludeId, &ids, true);
+    return !ids.isEmpty();
+}
+
+void TimeEntryIntervalIndex::invalidate()
+{
+    m_loaded = false;
+    m_spans.clear();
+    m_maxEnd.clear();
+    m_changed.clear();
+    m_overlay.clear();
+    m_unfetched.clear();
+}
+
+void TimeEntryIntervalIndex::onRowsChanged(const QList<RowChange> &changes)
+{
+    if (!m_loaded) {
+        return;
+    }
+
+    for (const RowChange &change : changes) {
+        if (change.table != "time_entries") {
+            continue;
+        }
+        if (change.operation == RowChange::Reset) {
+            invalidate();
+            return;
+        }
+        const int id = int(change.rowId);
+        m_changed.insert(id);
+        m_overlay.remove(id);
+        if (change.operation == RowChange::Delete) {
+            m_unfetched.remove(id);
+        } else {
+            m_unfetched.insert(id);
+        }
+    }
+}
+
+bool TimeEntryIntervalIndex::ensureCurrent()
+{
+    // Queued writes and their change notifications land before the lookup
+    Database::instance()->flushPendingWrites({ "time_entries" });
+    Database::instance()->changeBus()->flush();
+
+    if (!m_loaded && !load()) {
+        return false;
+    }
+    if (!m_unfetched.isEmpty() && !fetchChanged()) {
+        return false;
+    }
+    if (m_changed.size() > MAX_OVERLAY_SIZE) {
+        rebuild();
+    }
+    return true;
+}
+
+bool TimeEntryIntervalIndex::load()
+{
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    if (!query.exec(Statements::TIME_ENTRY_SPANS)) {
+        qWarning() << "Failed to load time entry spans:" << query.lastError().text();
+        return false;
+    }
+
+    m_spans.clear();
+    m_changed.clear();
+    m_overlay.clear();
+    m_unfetched.clear();
+    while (query.next()) {
+        const qint64 start = query.value(1).toLongLong();
+        const qint64 end = qMax(query.value(2).toLongLong(), start + 1);
+        m_spans.append({ start, end, query.value(0).toInt() });
+    }
+
+    m_loaded = true;
+    rebuild();
+    return true;
+}
+
+bool TimeEntryIntervalIndex::fetchChanged()
+{
+    const QList<int> pending = m_unfetched.values();
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    for (int from = 0; from < pending.size(); from += IDS_PER_QUERY) {
+        if (!query.exec(Statements::timeEntrySpansByIds(pending.mid(from, IDS_PER_QUERY)))) {
+            qWarning() << "Failed to read changed time entry spans:" << query.lastError().text();
+            return false;
+        }
+        // Ids that no longer exist simply stay out of the overlay
+        while (query.next()) {
+            const qint64 start = query.value(1).toLongLong();
+            const qint64 end = qMax(query.value(2).toLongLong(), start + 1);
+            const int id = query.value(0).toInt();
+            m_overlay.insert(id, { start, end, id });
+        }
+    }
+    m_unfetched.clear();
+    return true;
+}
+
+void TimeEntryIntervalIndex::rebuild()
+{
+    if (!m_changed.isEmpty()) {
+        const auto stale = [this](const Span &span) { return m_changed.contains(span.id); };
+        m_spans.erase(std::remove_if(m_spans.begin(), m_spans.end(), stale), m_spans.end());
+        for (const Span &span : std::as_const(m_overlay)) {
+            m_spans.append(span);
+        }
+        m_changed.clear();
+        m_overlay.clear();
+    }
+
+    std::sort(m_spans.begin(), m_spans.end(), [](const Span &a, const Span &b) {
+        return a.start < b.start || (a.start == b.start && a.id < b.id);
+    });
+    m_maxEnd.resize(m_spans.size());
+    buildNode(0, m_spans.size());
+}
+
+// The node for [lo, hi) is its middle element; it records the largest end
+// anywhere in that range
+qint64 TimeEntryIntervalIndex::buildNode(int lo, int hi)
+{
+    if (lo >= hi) {
+        return std::numeric_limits<qint64>::min();
+    }
+    const int mid = lo + (hi - lo) / 2;
+    const qint64 maxEnd = qMax(m_spans.at(mid).end, qMax(buildNode(lo, mid), buildNode(mid + 1, hi)));
+    m_maxEnd[mid] = maxEnd;
+    return maxEnd;
+}
+
+void TimeEntryIntervalIndex::collect(int lo, int hi, qint64 start, qint64 end, int excludeId,
+                                     QList<int> *ids, bool firstOnly) const
+{
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        // Nothing in this subtree ends after the range starts
+        if (m_maxEnd.at(mid) <= start) {
+            return;
+        }
+        collect(lo, mid, start, end, excludeId, ids, firstOnly);
+        if (firstOnly && !ids->isEmpty()) {
+            return;
+        }
+
+        // Everything from here on starts at or after the range ends
+        const Span &span = m_spans.at(mid);
+        if (span.start >= end) {
+            return;
+        }
+        if (span.end > start && span.id != excludeId && !m_changed.contains(span.id)) {
+            ids->append(span.id);
+            if (firstOnly) {
+                return;
+            }
+        }
+        lo = mid + 1;
+    }
+}
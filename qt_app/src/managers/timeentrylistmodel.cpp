@@ -0,0 +1,256 @@
+#include "managers/timeentrylistmodel.h"
+#include "managers/timeentrymanager.h"
+#include "database/database.h"
+#include <QSet>
+#include <algorithm>
+#include <utility>
+
+const int TimeEntryListModel::PAGE_SIZE = 200;
+const int TimeEntryListModel::MAX_INCREMENTAL_CHANGES = 500;
+
+namespace {
+
+// Display order: newest start first, ties broken by the larger id
+bool sortsBefore(const QVariantMap &a, const QVariantMap &b)
+{
+    const qint64 aEpoch = a.value("startEpoch").toLongLong();
+    const qint64 bEpoch = b.value("startEpoch").toLongLong();
+    if (aEpoch != bEpoch) {
+        return aEpoch > bEpoch;
+    }
+    return a.value("id").toInt() > b.value("id").toInt();
+}
+
+} // namespace
+
+TimeEntryListModel::TimeEntryListModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_manager(new TimeEntryManager(this))
+    , m_hasMore(true)
+    , m_totalCount(0)
+    , m_totalMinutes(0)
+{
+    connect(m_manager, &TimeEntryManager::error, this, &TimeEntryListModel::error);
+    connect(Database::instance()->changeBus(), &ChangeBus::rowsChanged, this, &TimeEntryListModel::onRowsChanged);
+    refreshSummary();
+}
+
+int TimeEntryListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_entries.size();
+}
+
+QVariant TimeEntryListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size()) {
+        return QVariant();
+    }
+
+    const QVariantMap &entry = m_entries.at(index.row());
+    switch (role) {
+    case IdRole: return entry.value("id");
+    case ProjectIdRole: return entry.value("projectId");
+    case TaskIdRole: return entry.value("taskId");
+    case Qt::DisplayRole:
+    case DescriptionRole: return entry.value("description");
+    case StartTimeRole: return entry.value("startTime");
+    case EndTimeRole: return entry.value("endTime");
+    case DurationRole: return entry.value("duration");
+    case StartEpochRole: return entry.value("startEpoch");
+    case EndEpochRole: return entry.value("endEpoch");
+    default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> TimeEntryListModel::roleNames() const
+{
+    static const QHash<int, QByteArray> roles = {
+        { IdRole, "id" },
+        { ProjectIdRole, "projectId" },
+        { TaskIdRole, "taskId" },
+        { DescriptionRole, "description" },
+        { StartTimeRole, "startTime" },
+        { EndTimeRole, "endTime" },
+        { DurationRole, "duration" },
+        { StartEpochRole, "startEpoch" },
+        { EndEpochRole, "endEpoch" }
+    };
+    return roles;
+}
+
+bool TimeEntryListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_hasMore;
+}
+
+void TimeEntryListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_hasMore) {
+        return;
+    }
+
+    QString afterStartTime;
+    int afterId = 0;
+    if (!m_entries.isEmpty()) {
+        afterStartTime = m_entries.last().value("startTime").toString();
+        afterId = m_entries.last().value("id").toInt();
+    }
+
+    const QVariantList page = m_manager->getTimeEntriesPage(m_filter, afterStartTime, afterId, PAGE_SIZE);
+    m_hasMore = page.size() == PAGE_SIZE;
+    if (page.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size() + page.size() - 1);
+    for (const QVariant &value : page) {
+        const QVariantMap entry = value.toMap();
+        m_startEpochs.insert(entry.value("id").toInt(), entry.value("startEpoch").toLongLong());
+        m_entries.append(entry);
+    }
+    endInsertRows();
+}
+
+void TimeEntryListModel::setFilter(const QVariantMap &filter)
+{
+    if (filter == m_filter) {
+        return;
+    }
+    m_filter = filter;
+    emit filterChanged();
+    reload();
+}
+
+QVariantMap TimeEntryListModel::get(int row) const
+{
+    return row >= 0 && row < m_entries.size() ? m_entries.at(row) : QVariantMap();
+}
+
+void TimeEntryListModel::reload()
+{
+    beginResetModel();
+    m_entries.clear();
+    m_startEpochs.clear();
+    m_hasMore = true;
+    endResetModel();
+    refreshSummary();
+}
+
+void TimeEntryListModel::onRowsChanged(const QList<RowChange> &changes)
+{
+    QSet<int> changedIds;
+    bool entriesChanged = false;
+    for (const RowChange &change : changes) {
+        if (change.table != "time_entries") {
+            continue;
+        }
+        entriesChanged = true;
+        if (change.operation == RowChange::Reset) {
+            reload();
+            return;
+        }
+        if (change.operation == RowChange::Delete) {
+            const int row = indexOfId(int(change.rowId));
+            if (row >= 0) {
+                removeAt(row);
+            }
+        } else {
+            changedIds.insert(int(change.rowId));
+        }
+    }
+
+    if (changedIds.size() > MAX_INCREMENTAL_CHANGES) {
+        reload();
+        return;
+    }
+
+    if (!changedIds.isEmpty()) {
+        // One query for the batch; ids that no longer match the filter are absent
+        QHash<int, QVariantMap> current;
+        for (const QVariant &value : m_manager->getTimeEntriesByIds(changedIds.values(), m_filter)) {
+            const QVariantMap entry = value.toMap();
+            current.insert(entry.value("id").toInt(), entry);
+        }
+
+        for (int id : std::as_const(changedIds)) {
+            const int row = indexOfId(id);
+            const auto it = current.constFind(id);
+            if (it == current.constEnd()) {
+                if (row >= 0) {
+                    removeAt(row);
+                }
+                continue;
+            }
+
+            if (row >= 0) {
+                // Edits that keep the row in place are a plain dataChanged;
+                // the last loaded row doubles as the paging cursor, so it is
+                // only updated in place once everything is loaded
+                const bool lastRow = row == m_entries.size() - 1;
+                const bool inPlace = (row == 0 || !sortsBefore(it.value(), m_entries.at(row - 1)))
+                        && (lastRow ? !m_hasMore : sortsBefore(it.value(), m_entries.at(row + 1)));
+                if (inPlace) {
+                    m_entries[row] = it.value();
+                    m_startEpochs.insert(id, it.value().value("startEpoch").toLongLong());
+                    emit dataChanged(index(row), index(row));
+                    continue;
+                }
+                removeAt(row);
+            }
+            insertEntry(it.value());
+        }
+    }
+
+    if (entriesChanged) {
+        refreshSummary();
+    }
+}
+
+int TimeEntryListModel::indexOfId(int id) const
+{
+    const auto it = m_startEpochs.constFind(id);
+    if (it == m_startEpochs.constEnd()) {
+        return -1;
+    }
+    const QVariantMap key { { "id", id }, { "startEpoch", it.value() } };
+    const int row = insertPosition(key);
+    return row < m_entries.size() && m_entries.at(row).value("id").toInt() == id ? row : -1;
+}
+
+int TimeEntryListModel::insertPosition(const QVariantMap &entry) const
+{
+    return int(std::lower_bound(m_entries.cbegin(), m_entries.cend(), entry, sortsBefore) - m_entries.cbegin());
+}
+
+void TimeEntryListModel::insertEntry(const QVariantMap &entry)
+{
+    const int row = insertPosition(entry);
+    // Rows past the loaded range arrive with a later page
+    if (row == m_entries.size() && m_hasMore) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), row, row);
+    m_startEpochs.insert(entry.value("id").toInt(), entry.value("startEpoch").toLongLong());
+    m_entries.insert(row, entry);
+    endInsertRows();
+}
+
+void TimeEntryListModel::removeAt(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    m_startEpochs.remove(m_entries.at(row).value("id").toInt());
+    m_entries.remove(row);
+    endRemoveRows();
+}
+
+void TimeEntryListModel::refreshSummary()
+{
+    const QVariantMap summary = m_manager->getTimeEntriesSummary(m_filter);
+    const int count = summary.value("count").toInt();
+    const qint64 minutes = summary.value("totalMinutes").toLongLong();
+    if (count != m_totalCount || minutes != m_totalMinutes) {
+        m_totalCount = count;
+        m_totalMinutes = minutes;
+        emit summaryChanged();
+    }
+}
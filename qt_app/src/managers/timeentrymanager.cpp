@@ -1,175 +1,777 @@
 #include "managers/timeentrymanager.h"
 #include "database/database.h"
+#include "database/asyncquery.h"
+#include "database/writequeue.h"
+#include "database/statements.h"
+#include "managers/timeentryintervalindex.h"
+#include "database/changebus.h"
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QPointer>
 #include <QDebug>
+#include <algorithm>
 
 TimeEntryManager::TimeEntryManager(QObject *parent)
-    : QObject(parent), m_timerRunning(false), m_currentProjectId(-1), m_currentTaskId(-1)
+    : QObject(parent), m_timerRunning(false), m_currentProjectId(-1), m_currentTaskId(-1), m_changesPending(false)
+    , m_intervals(TimeEntryIntervalIndex::instance())
+    , m_calendarGeneration(0)
 {
+    // One timeEntriesChanged() per committed batch rather than per write
+    connect(Database::instance()->writeQueue(), &WriteQueue::flushed, this, [this]() {
+        if (m_changesPending) {
+            m_changesPending = false;
+            emit timeEntriesChanged();
+        }
+    });
+    
+    connect(Database::instance()->changeBus(), &ChangeBus::rowsChanged, this, [this](const QList<RowChange> &changes) {
+        for (const RowChange &change : changes) {
+            if (change.table == "time_entries" || change.table == "projects") {
+                m_calendarCache.clear();
+                ++m_calendarGeneration;
+                return;
+            }
+        }
+    });
 }
 
-QVariantList TimeEntryManager::getAllTimeEntries()
+const int TimeEntryManager::MAX_CALENDAR_BUCKETS = 42;
+
+namespace {
+
+// What each kind of read depends on, for Database::flushPendingWrites
+const QStringList ENTRY_TABLES = { "time_entries" };
+const QStringList CALENDAR_TABLES = { "time_entries", "projects" };
+const QStringList REPORT_TABLES = { "time_entries", "projects", "tasks" };
+
+QVariantMap readTimeEntry(const QSqlQuery &query)
+{
+    QVariantMap entry;
+    entry["id"] = query.value(0).toInt();
+    entry["projectId"] = query.value(1).toInt();
+    entry["taskId"] = query.value(2).toInt();
+    entry["description"] = query.value(3).toString();
+    entry["startTime"] = query.value(4).toString();
+    entry["endTime"] = query.value(5).toString();
+    entry["duration"] = query.value(6).toInt();
+    entry["startEpoch"] = query.value(7).toLongLong();
+    entry["endEpoch"] = query.value(8).toLongLong();
+    return entry;
+}
+
+QVariantMap timeEntryBindings(const QVariantMap &entryData)
+{
+    QVariantMap bindings;
+    bindings[":projectId"] = entryData.value("projectId");
+    bindings[":taskId"] = entryData.value("taskId");
+    bindings[":desc"] = entryData.value("description");
+    bindings[":start"] = entryData.value("startTime");
+    bindings[":end"] = entryData.value("endTime");
+    bindings[":duration"] = entryData.value("duration");
+    return bindings;
+}
+
+// Safe to call from any thread: uses that thread's pooled connection
+QVariantList queryTimeEntries(const QString &sql, const QVariantMap &bindings, QString *errorMessage)
 {
+    Database::instance()->flushPendingWrites(ENTRY_TABLES);
     QVariantList result;
     QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (auto it = bindings.cbegin(); it != bindings.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
     
-    if (!query.exec("SELECT id, project_id, task_id, description, start_time, end_time, duration FROM time_entries ORDER BY start_time DESC")) {
-        emit error(query.lastError().text());
+    if (!query.exec()) {
+        *errorMessage = query.lastError().text();
         return result;
     }
     
     while (query.next()) {
-        QVariantMap entry;
-        entry["id"] = query.value(0).toInt();
-        entry["projectId"] = query.value(1).toInt();
-        entry["taskId"] = query.value(2).toInt();
-        entry["description"] = query.value(3).toString();
-        entry["startTime"] = query.value(4).toString();
-        entry["endTime"] = query.value(5).toString();
-        entry["duration"] = query.value(6).toInt();
-        result.append(entry);
+        result.append(readTimeEntry(query));
     }
     
     return result;
 }
 
-QVariantList TimeEntryManager::getTimeEntriesByProject(int projectId)
+QVariantList queryAggregate(const QString &groupBy, const QString &sql, const QVariantMap &bindings, QString *errorMessage)
 {
+    Database::instance()->flushPendingWrites(REPORT_TABLES);
     QVariantList result;
     QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, project_id, task_id, description, start_time, end_time, duration FROM time_entries WHERE project_id = :projectId ORDER BY start_time DESC");
-    query.bindValue(":projectId", projectId);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (auto it = bindings.cbegin(); it != bindings.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
     
     if (!query.exec()) {
-        emit error(query.lastError().text());
+        *errorMessage = query.lastError().text();
         return result;
     }
     
+    const bool byId = groupBy == "project" || groupBy == "task";
     while (query.next()) {
-        QVariantMap entry;
-        entry["id"] = query.value(0).toInt();
-        entry["projectId"] = query.value(1).toInt();
-        entry["taskId"] = query.value(2).toInt();
-        entry["description"] = query.value(3).toString();
-        entry["startTime"] = query.value(4).toString();
-        entry["endTime"] = query.value(5).toString();
-        entry["duration"] = query.value(6).toInt();
-        result.append(entry);
+        QVariantMap row;
+        row["key"] = byId ? QVariant(query.value(0).toInt()) : QVariant(query.value(0).toString());
+        QString label = query.value(1).toString();
+        if (groupBy == "week") {
+            int year = 0;
+            const int week = QDate::fromString(label, Qt::ISODate).weekNumber(&year);
+            label = QString("%1-W%2").arg(year).arg(week, 2, 10, QChar('0'));
+        }
+        row["label"] = label;
+        row["minutes"] = query.value(2).toLongLong();
+        row["entryCount"] = query.value(3).toInt();
+        result.append(row);
     }
     
     return result;
 }
 
-QVariantList TimeEntryManager::getTimeEntriesByDateRange(const QDateTime &start, const QDateTime &end)
+const int IDS_PER_QUERY = 500;
+
+// Entries by primary key, newest first; ids come from the interval index
+QVariantList queryTimeEntriesByIds(const QList<int> &ids, QString *errorMessage)
 {
     QVariantList result;
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, project_id, task_id, description, start_time, end_time, duration FROM time_entries WHERE start_time >= :start AND end_time <= :end ORDER BY start_time DESC");
-    query.bindValue(":start", start.toString(Qt::ISODate));
-    query.bindValue(":end", end.toString(Qt::ISODate));
+    for (int from = 0; from < ids.size(); from += IDS_PER_QUERY) {
+        QVariantMap bindings;
+        const QString sql = Statements::timeEntriesByIds(ids.mid(from, IDS_PER_QUERY), QVariantMap(), &bindings);
+        result += queryTimeEntries(sql, bindings, errorMessage);
+        if (!errorMessage->isEmpty()) {
+            return QVariantList();
+        }
+    }
     
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return result;
+    std::sort(result.begin(), result.end(), [](const QVariant &a, const QVariant &b) {
+        const qint64 aEpoch = a.toMap().value("startEpoch").toLongLong();
+        const qint64 bEpoch = b.toMap().value("startEpoch").toLongLong();
+        return aEpoch != bEpoch ? aEpoch > bEpoch : a.toMap().value("id").toInt() > b.toMap().value("id").toInt();
+    });
+    return result;
+}
+
+const qint64 SECONDS_PER_DAY = 24 * 3600;
+const int TOP_PROJECTS_PER_BUCKET = 3;
+
+// Same clock as the epoch columns: midnight of date read as UTC
+qint64 dayEpoch(const QDate &date)
+{
+    return QDate(1970, 1, 1).daysTo(date) * SECONDS_PER_DAY;
+}
+
+QString calendarKey(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity)
+{
+    return rangeStart.toString(Qt::ISODate) + '/' + rangeEnd.toString(Qt::ISODate) + '/' + granularity;
+}
+
+// Spreads each entry's recorded minutes over the buckets its span touches,
+// in proportion to the time spent in each
+QVariantList calendarBuckets(const QList<int> &ids, const QDate &first, int bucketDays, int bucketCount,
+                             QString *errorMessage)
+{
+    const QVariantList entries = queryTimeEntriesByIds(ids, errorMessage);
+    if (!errorMessage->isEmpty()) {
+        return QVariantList();
     }
     
+    QHash<int, QString> projectNames;
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    if (!query.exec(Statements::PROJECT_NAMES)) {
+        *errorMessage = query.lastError().text();
+        return QVariantList();
+    }
     while (query.next()) {
-        QVariantMap entry;
-        entry["id"] = query.value(0).toInt();
-        entry["projectId"] = query.value(1).toInt();
-        entry["taskId"] = query.value(2).toInt();
-        entry["description"] = query.value(3).toString();
-        entry["startTime"] = query.value(4).toString();
-        entry["endTime"] = query.value(5).toString();
-        entry["duration"] = query.value(6).toInt();
-        result.append(entry);
+        projectNames.insert(query.value(0).toInt(), query.value(1).toString());
     }
     
+    const qint64 base = dayEpoch(first);
+    const qint64 bucketSeconds = bucketDays * SECONDS_PER_DAY;
+    QVector<double> minutes(bucketCount, 0.0);
+    QVector<int> counts(bucketCount, 0);
+    QVector<QHash<int, double>> projectMinutes(bucketCount);
+    
+    for (const QVariant &value : entries) {
+        const QVariantMap entry = value.toMap();
+        const qint64 start = entry.value("startEpoch").toLongLong();
+        const qint64 end = qMax(entry.value("endEpoch").toLongLong(), start);
+        const double duration = entry.value("duration").toDouble();
+        const int projectId = entry.value("projectId").toInt();
+        
+        const int firstBucket = int(qMax<qint64>(0, (start - base) / bucketSeconds));
+        const int lastBucket = int(qMin<qint64>(bucketCount - 1, (qMax(end - 1, start) - base) / bucketSeconds));
+        for (int b = firstBucket; b <= lastBucket; ++b) {
+            const qint64 bucketStart = base + b * bucketSeconds;
+            const qint64 overlap = qMin(end, bucketStart + bucketSeconds) - qMax(start, bucketStart);
+            const double share = end > start ? double(qMax<qint64>(overlap, 0)) / double(end - start) : 1.0;
+            minutes[b] += duration * share;
+            projectMinutes[b][projectId] += duration * share;
+            ++counts[b];
+        }
+    }
+    
+    QVariantList buckets;
+    for (int b = 0; b < bucketCount; ++b) {
+        QList<QPair<double, int>> ranked;
+        for (auto it = projectMinutes.at(b).cbegin(); it != projectMinutes.at(b).cend(); ++it) {
+            ranked.append({ it.value(), it.key() });
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const QPair<double, int> &a, const QPair<double, int> &b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        
+        QVariantList topProjects;
+        for (int i = 0; i < qMin(int(ranked.size()), TOP_PROJECTS_PER_BUCKET); ++i) {
+            QVariantMap project;
+            project["projectId"] = ranked.at(i).second;
+            project["name"] = projectNames.value(ranked.at(i).second);
+            project["minutes"] = qRound(ranked.at(i).first);
+            topProjects.append(project);
+        }
+        
+        QVariantMap bucket;
+        bucket["date"] = first.addDays(qint64(b) * bucketDays).toString(Qt::ISODate);
+        bucket["minutes"] = qRound(minutes.at(b));
+        bucket["entryCount"] = counts.at(b);
+        bucket["topProjects"] = topProjects;
+        buckets.append(bucket);
+    }
+    return buckets;
+}
+
+// The stats caches read a changed entry back to find the project and task
+// it belongs to; the ones it had before an update or delete are gone from
+// the row by then, so they are captured before the write and reported
+// after the commit
+QList<RowChange> parentsOf(const QList<int> &ids)
+{
+    QList<RowChange> parents;
+    QSqlQuery query(Database::instance()->database());
+    query.setForwardOnly(true);
+    if (!query.exec(Statements::timeEntryParentsByIds(ids))) {
+        qWarning() << "Failed to read time entry parents:" << query.lastError().text();
+        return parents;
+    }
+    while (query.next()) {
+        parents.append({ "projects", RowChange::Update, query.value(1).toLongLong() });
+        if (!query.value(2).isNull()) {
+            parents.append({ "tasks", RowChange::Update, query.value(2).toLongLong() });
+        }
+    }
+    return parents;
+}
+
+void reportParents(const QList<RowChange> &parents)
+{
+    ChangeBus *bus = Database::instance()->changeBus();
+    for (const RowChange &change : parents) {
+        bus->record(change.table, change.operation, change.rowId);
+    }
+}
+
+} // namespace
+
+QVariantList TimeEntryManager::getAllTimeEntries()
+{
+    QString errorMessage;
+    QVariantList result = queryTimeEntries(Statements::ALL_TIME_ENTRIES, QVariantMap(), &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
+    return result;
+}
+
+QVariantList TimeEntryManager::getTimeEntriesByProject(int projectId)
+{
+    QString errorMessage;
+    QVariantList result = queryTimeEntries(Statements::TIME_ENTRIES_BY_PROJECT, {{":projectId", projectId}}, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
+    return result;
+}
+
+QVariantList TimeEntryManager::getTimeEntriesByDateRange(const QDateTime &start, const QDateTime &end)
+{
+    QString errorMessage;
+    QVariantList result = queryTimeEntriesByIds(overlappingIds(start, end), &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
     return result;
 }
 
 QVariantMap TimeEntryManager::getTimeEntry(int id)
 {
-    QVariantMap result;
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("SELECT id, project_id, task_id, description, start_time, end_time, duration FROM time_entries WHERE id = :id");
-    query.bindValue(":id", id);
+    QString errorMessage;
+    QVariantList result = queryTimeEntries(Statements::TIME_ENTRY_BY_ID, {{":id", id}}, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
+    return result.isEmpty() ? QVariantMap() : result.first().toMap();
+}
+
+QVariantList TimeEntryManager::getTimeEntriesPage(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit)
+{
+    QVariantMap bindings;
+    const QString sql = Statements::timeEntriesPage(filter, afterStartTime, afterId, limit, &bindings);
+    QString errorMessage;
+    QVariantList result = queryTimeEntries(sql, bindings, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
+    return result;
+}
+
+QVariantMap TimeEntryManager::getTimeEntriesSummary(const QVariantMap &filter)
+{
+    Database::instance()->flushPendingWrites(ENTRY_TABLES);
+    QVariantMap bindings;
+    const QString sql = Statements::timeEntriesSummary(filter, &bindings);
     
+    QVariantMap summary;
+    summary["count"] = 0;
+    summary["totalMinutes"] = 0;
+    
+    QSqlQuery query(Database::instance()->database());
+    query.prepare(sql);
+    for (auto it = bindings.cbegin(); it != bindings.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
     if (!query.exec()) {
         emit error(query.lastError().text());
-        return result;
+        return summary;
     }
-    
     if (query.next()) {
-        result["id"] = query.value(0).toInt();
-        result["projectId"] = query.value(1).toInt();
-        result["taskId"] = query.value(2).toInt();
-        result["description"] = query.value(3).toString();
-        result["startTime"] = query.value(4).toString();
-        result["endTime"] = query.value(5).toString();
-        result["duration"] = query.value(6).toInt();
+        summary["count"] = query.value(0).toInt();
+        summary["totalMinutes"] = query.value(1).toLongLong();
+    }
+    return summary;
+}
+
+QVariantList TimeEntryManager::aggregate(const QString &groupBy, const QVariantMap &filter)
+{
+    QVariantMap bindings;
+    const QString sql = Statements::timeEntriesAggregate(groupBy, filter, &bindings);
+    if (sql.isEmpty()) {
+        emit error(tr("Unknown grouping: %1").arg(groupBy));
+        return QVariantList();
     }
     
+    QString errorMessage;
+    QVariantList result = queryAggregate(groupBy, sql, bindings, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
     return result;
 }
 
-bool TimeEntryManager::createTimeEntry(const QVariantMap &entryData)
+bool TimeEntryManager::hasOverlap(const QString &startTime, const QString &endTime, int excludeId)
 {
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("INSERT INTO time_entries (project_id, task_id, description, start_time, end_time, duration) VALUES (:projectId, :taskId, :desc, :start, :end, :duration)");
-    query.bindValue(":projectId", entryData.value("projectId"));
-    query.bindValue(":taskId", entryData.value("taskId"));
-    query.bindValue(":desc", entryData.value("description"));
-    query.bindValue(":start", entryData.value("startTime"));
-    query.bindValue(":end", entryData.value("endTime"));
-    query.bindValue(":duration", entryData.value("duration"));
+    return m_intervals->overlapsAny(TimeEntryIntervalIndex::toEpoch(startTime),
+                                    TimeEntryIntervalIndex::toEpoch(endTime), excludeId);
+}
+
+QList<int> TimeEntryManager::overlappingIds(const QDateTime &start, const QDateTime &end)
+{
+    // end is inclusive, as in the 23:59:59 bounds the views pass
+    return m_intervals->overlapping(TimeEntryIntervalIndex::toEpoch(start.toString(Qt::ISODate)),
+                                    TimeEntryIntervalIndex::toEpoch(end.toString(Qt::ISODate)) + 1);
+}
+
+bool TimeEntryManager::calendarRange(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity,
+                                     int *bucketDays, int *bucketCount, QList<int> *ids)
+{
+    if (granularity != "day" && granularity != "week") {
+        emit error(tr("Unknown calendar granularity: %1").arg(granularity));
+        return false;
+    }
+    if (!rangeStart.isValid() || !rangeEnd.isValid() || rangeEnd < rangeStart) {
+        return false;
+    }
     
-    if (!query.exec()) {
-        emit error(query.lastError().text());
+    *bucketDays = granularity == "week" ? 7 : 1;
+    *bucketCount = int(qMin<qint64>(MAX_CALENDAR_BUCKETS, rangeStart.daysTo(rangeEnd) / *bucketDays + 1));
+    const qint64 start = dayEpoch(rangeStart);
+    *ids = m_intervals->overlapping(start, start + qint64(*bucketCount) * *bucketDays * SECONDS_PER_DAY);
+    return true;
+}
+
+void TimeEntryManager::cacheCalendarSummary(const QString &key, int generation, const QVariantList &buckets)
+{
+    // A summary computed before the latest change is already stale
+    if (generation != m_calendarGeneration) {
+        return;
+    }
+    if (m_calendarCache.size() >= 8) {
+        m_calendarCache.clear();
+    }
+    m_calendarCache.insert(key, buckets);
+}
+
+QVariantList TimeEntryManager::getCalendarSummary(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity)
+{
+    Database::instance()->flushPendingWrites(CALENDAR_TABLES);
+    Database::instance()->changeBus()->flush();
+    const QString key = calendarKey(rangeStart, rangeEnd, granularity);
+    const auto cached = m_calendarCache.constFind(key);
+    if (cached != m_calendarCache.constEnd()) {
+        return cached.value();
+    }
+    
+    int bucketDays = 0;
+    int bucketCount = 0;
+    QList<int> ids;
+    if (!calendarRange(rangeStart, rangeEnd, granularity, &bucketDays, &bucketCount, &ids)) {
+        return QVariantList();
+    }
+    
+    QString errorMessage;
+    const QVariantList buckets = calendarBuckets(ids, rangeStart, bucketDays, bucketCount, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+        return buckets;
+    }
+    cacheCalendarSummary(key, m_calendarGeneration, buckets);
+    return buckets;
+}
+
+QFuture<QVariantList> TimeEntryManager::getCalendarSummaryAsync(const QDate &rangeStart, const QDate &rangeEnd,
+                                                                const QString &granularity)
+{
+    Database::instance()->flushPendingWrites(CALENDAR_TABLES);
+    Database::instance()->changeBus()->flush();
+    const QString key = calendarKey(rangeStart, rangeEnd, granularity);
+    const auto cached = m_calendarCache.constFind(key);
+    if (cached != m_calendarCache.constEnd()) {
+        return QtFuture::makeReadyFuture(cached.value());
+    }
+    
+    int bucketDays = 0;
+    int bucketCount = 0;
+    QList<int> ids;
+    if (!calendarRange(rangeStart, rangeEnd, granularity, &bucketDays, &bucketCount, &ids)) {
+        return QtFuture::makeReadyFuture(QVariantList());
+    }
+    
+    // The index lookup stays on this thread; rows are read and split on the worker
+    const int generation = m_calendarGeneration;
+    return AsyncQuery::run(this, CALENDAR_TABLES, [ids, rangeStart, bucketDays, bucketCount](QString *errorMessage) {
+        return calendarBuckets(ids, rangeStart, bucketDays, bucketCount, errorMessage);
+    }).then(this, [this, key, generation](QVariantList buckets) {
+        // A failed read returns no buckets at all and is not cached
+        if (!buckets.isEmpty()) {
+            cacheCalendarSummary(key, generation, buckets);
+        }
+        return buckets;
+    });
+}
+
+void TimeEntryManager::prefetchCalendarSummary(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity)
+{
+    getCalendarSummaryAsync(rangeStart, rangeEnd, granularity);
+}
+
+bool TimeEntryManager::rejectsOverlap(const QVariantMap &entryData, int excludeId)
+{
+    if (!entryData.value("rejectOverlap").toBool()
+        || !hasOverlap(entryData.value("startTime").toString(), entryData.value("endTime").toString(), excludeId)) {
+        return false;
+    }
+    emit error(tr("The entry overlaps another time entry"));
+    return true;
+}
+
+QVariantList TimeEntryManager::getTimeEntriesByIds(const QList<int> &ids, const QVariantMap &filter)
+{
+    if (ids.isEmpty()) {
+        return QVariantList();
+    }
+    
+    QVariantMap bindings;
+    const QString sql = Statements::timeEntriesByIds(ids, filter, &bindings);
+    QString errorMessage;
+    QVariantList result = queryTimeEntries(sql, bindings, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        emit error(errorMessage);
+    }
+    return result;
+}
+
+QFuture<QVariantList> TimeEntryManager::getAllTimeEntriesAsync()
+{
+    return AsyncQuery::run(this, ENTRY_TABLES, [](QString *errorMessage) {
+        return queryTimeEntries(Statements::ALL_TIME_ENTRIES, QVariantMap(), errorMessage);
+    });
+}
+
+QFuture<QVariantList> TimeEntryManager::getTimeEntriesByProjectAsync(int projectId)
+{
+    return AsyncQuery::run(this, ENTRY_TABLES, [projectId](QString *errorMessage) {
+        return queryTimeEntries(Statements::TIME_ENTRIES_BY_PROJECT, {{":projectId", projectId}}, errorMessage);
+    });
+}
+
+QFuture<QVariantList> TimeEntryManager::getTimeEntriesByDateRangeAsync(const QDateTime &start, const QDateTime &end)
+{
+    // The index lookup is cheap; only the row reads go to the worker
+    const QList<int> ids = overlappingIds(start, end);
+    return AsyncQuery::run(this, ENTRY_TABLES, [ids](QString *errorMessage) {
+        return queryTimeEntriesByIds(ids, errorMessage);
+    });
+}
+
+QFuture<QVariantMap> TimeEntryManager::getTimeEntryAsync(int id)
+{
+    return AsyncQuery::run(this, ENTRY_TABLES, [id](QString *errorMessage) {
+        const QVariantList result = queryTimeEntries(Statements::TIME_ENTRY_BY_ID, {{":id", id}}, errorMessage);
+        return result.isEmpty() ? QVariantMap() : result.first().toMap();
+    });
+}
+
+QFuture<QVariantList> TimeEntryManager::getTimeEntriesPageAsync(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit)
+{
+    QVariantMap bindings;
+    const QString sql = Statements::timeEntriesPage(filter, afterStartTime, afterId, limit, &bindings);
+    return AsyncQuery::run(this, ENTRY_TABLES, [sql, bindings](QString *errorMessage) {
+        return queryTimeEntries(sql, bindings, errorMessage);
+    });
+}
+
+QFuture<QVariantList> TimeEntryManager::aggregateAsync(const QString &groupBy, const QVariantMap &filter)
+{
+    QVariantMap bindings;
+    const QString sql = Statements::timeEntriesAggregate(groupBy, filter, &bindings);
+    if (sql.isEmpty()) {
+        emit error(tr("Unknown grouping: %1").arg(groupBy));
+        return QtFuture::makeReadyFuture(QVariantList());
+    }
+    
+    return AsyncQuery::run(this, REPORT_TABLES, [groupBy, sql, bindings](QString *errorMessage) {
+        return queryAggregate(groupBy, sql, bindings, errorMessage);
+    });
+}
+
+void TimeEntryManager::getAllTimeEntriesAsync(const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getAllTimeEntriesAsync(), callback);
+}
+
+void TimeEntryManager::getTimeEntriesByProjectAsync(int projectId, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getTimeEntriesByProjectAsync(projectId), callback);
+}
+
+void TimeEntryManager::getTimeEntriesByDateRangeAsync(const QDateTime &start, const QDateTime &end, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getTimeEntriesByDateRangeAsync(start, end), callback);
+}
+
+void TimeEntryManager::getTimeEntryAsync(int id, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getTimeEntryAsync(id), callback);
+}
+
+void TimeEntryManager::getTimeEntriesPageAsync(const QVariantMap &filter, const QString &afterStartTime, int afterId, int limit, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getTimeEntriesPageAsync(filter, afterStartTime, afterId, limit), callback);
+}
+
+void TimeEntryManager::aggregateAsync(const QString &groupBy, const QVariantMap &filter, const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, aggregateAsync(groupBy, filter), callback);
+}
+
+void TimeEntryManager::getCalendarSummaryAsync(const QDate &rangeStart, const QDate &rangeEnd, const QString &granularity,
+                                               const QJSValue &callback)
+{
+    AsyncQuery::deliver(this, getCalendarSummaryAsync(rangeStart, rangeEnd, granularity), callback);
+}
+
+bool TimeEntryManager::createTimeEntry(const QVariantMap &entryData)
+{
+    if (rejectsOverlap(entryData, 0)) {
         return false;
     }
     
-    emit timeEntryCreated(query.lastInsertId().toInt());
-    emit timeEntriesChanged();
+    QPointer<TimeEntryManager> self(this);
+    Database::instance()->writeQueue()->enqueue(Statements::INSERT_TIME_ENTRY, timeEntryBindings(entryData),
+        [self](bool success, const QVariant &lastInsertId, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->timeEntryCreated(lastInsertId.toInt());
+    });
     return true;
 }
 
 bool TimeEntryManager::updateTimeEntry(int id, const QVariantMap &entryData)
 {
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("UPDATE time_entries SET project_id=:projectId, task_id=:taskId, description=:desc, start_time=:start, end_time=:end, duration=:duration WHERE id=:id");
-    query.bindValue(":id", id);
-    query.bindValue(":projectId", entryData.value("projectId"));
-    query.bindValue(":taskId", entryData.value("taskId"));
-    query.bindValue(":desc", entryData.value("description"));
-    query.bindValue(":start", entryData.value("startTime"));
-    query.bindValue(":end", entryData.value("endTime"));
-    query.bindValue(":duration", entryData.value("duration"));
-    
-    if (!query.exec()) {
-        emit error(query.lastError().text());
+    if (rejectsOverlap(entryData, id)) {
         return false;
     }
     
-    emit timeEntryUpdated(id);
-    emit timeEntriesChanged();
+    QVariantMap bindings = timeEntryBindings(entryData);
+    bindings[":id"] = id;
+    
+    const QList<RowChange> parents = parentsOf({ id });
+    QPointer<TimeEntryManager> self(this);
+    Database::instance()->writeQueue()->enqueue(Statements::UPDATE_TIME_ENTRY, bindings,
+        [self, id, parents](bool success, const QVariant &, const QString &errorMessage) {
+        if (success) {
+            reportParents(parents);
+        }
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->timeEntryUpdated(id);
+    });
     return true;
 }
 
 bool TimeEntryManager::deleteTimeEntry(int id)
 {
-    QSqlQuery query(Database::instance()->database());
-    query.prepare("DELETE FROM time_entries WHERE id = :id");
-    query.bindValue(":id", id);
+    const QList<RowChange> parents = parentsOf({ id });
+    QPointer<TimeEntryManager> self(this);
+    Database::instance()->writeQueue()->enqueue(Statements::DELETE_TIME_ENTRY, {{":id", id}},
+        [self, id, parents](bool success, const QVariant &, const QString &errorMessage) {
+        if (success) {
+            reportParents(parents);
+        }
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->timeEntryDeleted(id);
+    });
+    return true;
+}
+
+bool TimeEntryManager::createTimeEntries(const QVariantList &entries)
+{
+    if (entries.isEmpty()) {
+        return true;
+    }
     
-    if (!query.exec()) {
-        emit error(query.lastError().text());
-        return false;
+    QList<QVariantMap> rows;
+    rows.reserve(entries.size());
+    for (const QVariant &value : entries) {
+        const QVariantMap entry = value.toMap();
+        // The batch commits as a whole, so one overlap rejects all of it
+        if (rejectsOverlap(entry, 0)) {
+            return false;
+        }
+        rows.append(timeEntryBindings(entry));
     }
     
-    emit timeEntryDeleted(id);
-    emit timeEntriesChanged();
+    QPointer<TimeEntryManager> self(this);
+    Database::instance()->writeQueue()->enqueueBatch(Statements::INSERT_TIME_ENTRY, rows,
+        [self](bool success, const QVariantList &lastInsertIds, const QString &errorMessage) {
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        QList<int> ids;
+        for (const QVariant &id : lastInsertIds) {
+            ids.append(id.toInt());
+        }
+        self->m_changesPending = true;
+        emit self->timeEntriesCreated(ids);
+    });
+    return true;
+}
+
+bool TimeEntryManager::updateTimeEntries(const QVariantList &entries)
+{
+    if (entries.isEmpty()) {
+        return true;
+    }
+    
+    QList<QVariantMap> rows;
+    QList<int> ids;
+    rows.reserve(entries.size());
+    for (const QVariant &value : entries) {
+        const QVariantMap entry = value.toMap();
+        if (rejectsOverlap(entry, entry.value("id").toInt())) {
+            return false;
+        }
+        QVariantMap bindings = timeEntryBindings(entry);
+        bindings[":id"] = entry.value("id");
+        rows.append(bindings);
+        ids.append(entry.value("id").toInt());
+    }
+    
+    const QList<RowChange> parents = parentsOf(ids);
+    QPointer<TimeEntryManager> self(this);
+    Database::instance()->writeQueue()->enqueueBatch(Statements::UPDATE_TIME_ENTRY, rows,
+        [self, ids, parents](bool success, const QVariantList &, const QString &errorMessage) {
+        if (success) {
+            reportParents(parents);
+        }
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->timeEntriesUpdated(ids);
+    });
+    return true;
+}
+
+bool TimeEntryManager::deleteTimeEntries(const QList<int> &ids)
+{
+    if (ids.isEmpty()) {
+        return true;
+    }
+    
+    QList<QVariantMap> rows;
+    rows.reserve(ids.size());
+    for (int id : ids) {
+        QVariantMap bindings;
+        bindings[":id"] = id;
+        rows.append(bindings);
+    }
+    
+    const QList<RowChange> parents = parentsOf(ids);
+    QPointer<TimeEntryManager> self(this);
+    Database::instance()->writeQueue()->enqueueBatch(Statements::DELETE_TIME_ENTRY, rows,
+        [self, ids, parents](bool success, const QVariantList &, const QString &errorMessage) {
+        if (success) {
+            reportParents(parents);
+        }
+        if (!self) {
+            return;
+        }
+        if (!success) {
+            emit self->error(errorMessage);
+            return;
+        }
+        self->m_changesPending = true;
+        emit self->timeEntriesDeleted(ids);
+    });
     return true;
 }
 
@@ -231,11 +833,3 @@ int TimeEntryManager::roundToFiveMinutes(int minutes)
 {
     return ((minutes + 2) / 5) * 5;
 }
-
-QVariantMap TimeEntryManager::timeEntryToVariantMap(const TimeEntryModel &entry)
-{
-    QVariantMap map;
-    // TODO: Implement
-    return map;
-}
-
@@ -0,0 +1,338 @@
+#include "utils/datagenerator.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRandomGenerator>
+#include <QDateTime>
+#include <QVector>
+#include <QHash>
+#include <QDebug>
+#include <algorithm>
+#include <utility>
+
+const quint32 DataGenerator::DEFAULT_SEED = 20240101;
+const QDate DataGenerator::DEFAULT_LAST_DAY(2024, 12, 31);
+const int DataGenerator::ROWS_PER_TRANSACTION = 50000;
+
+namespace {
+
+// Longest history generated; larger workloads get denser days instead of
+// reaching further back, as if a team shared the tracker
+const int MAX_HISTORY_DAYS = 10 * 365;
+const int ENTRIES_PER_WORKDAY = 5;
+
+const char *const PROJECT_WORDS[] = {
+    "Apollo", "Borealis", "Cobalt", "Delta", "Ember", "Falcon", "Granite", "Horizon",
+    "Indigo", "Juniper", "Keystone", "Lumen", "Meridian", "Nimbus", "Orion", "Pioneer"
+};
+const char *const PROJECT_KINDS[] = {
+    "Website", "Mobile App", "Migration", "Audit", "Platform", "Redesign", "Integration", "Research"
+};
+const char *const TASK_VERBS[] = {
+    "Design", "Implement", "Review", "Test", "Document", "Deploy", "Refactor", "Plan"
+};
+const char *const TASK_OBJECTS[] = {
+    "login flow", "reporting", "database layer", "API", "onboarding", "settings page",
+    "notifications", "search", "billing", "dashboard"
+};
+const char *const SUBTASK_STEPS[] = {
+    "Draft", "Prototype", "Code review", "Unit tests", "QA pass", "Write notes"
+};
+const char *const COLORS[] = {
+    "#3498db", "#e74c3c", "#2ecc71", "#f39c12", "#9b59b6", "#1abc9c", "#34495e", "#e67e22"
+};
+const char *const DESCRIPTIONS[] = {
+    "Development", "Meeting", "Code review", "Bug fixing", "Planning", "Support", "Testing", "Documentation"
+};
+
+template <typename T, int N>
+const T &pick(QRandomGenerator &rng, const T (&items)[N])
+{
+    return items[rng.bounded(N)];
+}
+
+// Work minutes cluster around an hour with a long tail, in 5 minute steps
+int entryMinutes(QRandomGenerator &rng)
+{
+    const int minutes = 15 + rng.bounded(90) + rng.bounded(90);
+    return minutes - minutes % 5;
+}
+
+class Generator
+{
+public:
+    Generator(QSqlDatabase &db, quint32 seed, const DataGenerator::ProgressCallback &progress)
+        : m_db(db), m_rng(seed), m_progress(progress), m_pendingRows(0), m_projectBase(0)
+    {
+    }
+
+    bool run(qint64 timeEntries, const QDate &lastDay, QString *errorMessage)
+    {
+        const qint64 workdaysNeeded = (timeEntries + ENTRIES_PER_WORKDAY - 1) / ENTRIES_PER_WORKDAY;
+        const int historyDays = int(qBound<qint64>(30, workdaysNeeded * 7 / 5, MAX_HISTORY_DAYS));
+        m_firstDay = lastDay.addDays(-historyDays);
+        m_lastDay = lastDay;
+
+        if (!m_db.transaction()) {
+            return fail(m_db.lastError().text(), errorMessage);
+        }
+        const bool ok = readProjectBase()
+                && insertProjects(int(qBound<qint64>(5, timeEntries / 2000, 200)))
+                && insertTasks()
+                && insertSubtasks()
+                && insertTimeEntries(timeEntries)
+                && insertPresence();
+        if (!ok) {
+            m_db.rollback();
+            return fail(m_error, errorMessage);
+        }
+        if (!m_db.commit()) {
+            return fail(m_db.lastError().text(), errorMessage);
+        }
+        return true;
+    }
+
+private:
+    bool fail(const QString &message, QString *errorMessage)
+    {
+        qCritical() << "[DATAGEN] Generation failed:" << message;
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    }
+
+    bool exec(QSqlQuery &query)
+    {
+        if (!query.exec()) {
+            m_error = query.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    // Bounds the size of a single transaction for the large workloads
+    bool rowWritten()
+    {
+        if (++m_pendingRows < DataGenerator::ROWS_PER_TRANSACTION) {
+            return true;
+        }
+        m_pendingRows = 0;
+        if (!m_db.commit() || !m_db.transaction()) {
+            m_error = m_db.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    QDate randomDay()
+    {
+        return m_firstDay.addDays(m_rng.bounded(int(m_firstDay.daysTo(m_lastDay)) + 1));
+    }
+
+    // A few projects get most of the time, like in real usage
+    int pickProject()
+    {
+        const double target = m_rng.generateDouble() * m_projectWeights.last();
+        return int(std::upper_bound(m_projectWeights.begin(), m_projectWeights.end(), target)
+                   - m_projectWeights.begin());
+    }
+
+    // Generated project names are numbered past the existing ids, so a
+    // second run on the same file does not hit projects.name UNIQUE
+    bool readProjectBase()
+    {
+        QSqlQuery query(m_db);
+        if (!query.exec("SELECT COALESCE(MAX(id), 0) FROM projects") || !query.next()) {
+            m_error = query.lastError().text();
+            return false;
+        }
+        m_projectBase = query.value(0).toLongLong();
+        return true;
+    }
+
+    bool insertProjects(int count)
+    {
+        QSqlQuery query(m_db);
+        query.prepare("INSERT INTO projects (name, description, color, budget, hourly_rate, currency, start_date, end_date) "
+                      "VALUES (:name, :desc, :color, :budget, :rate, 'USD', :start, :end)");
+        double cumulative = 0;
+        for (int i = 0; i < count; ++i) {
+            const double rate = 50 + 5 * m_rng.bounded(21);
+            const QDate start = randomDay();
+            const QString word = pick(m_rng, PROJECT_WORDS);
+            const QString kind = pick(m_rng, PROJECT_KINDS);
+            const qint64 number = m_projectBase + i + 1;
+            query.bindValue(":name", QString("%1 %2 %3").arg(word, kind).arg(number));
+            query.bindValue(":desc", QString("Generated project %1").arg(number));
+            query.bindValue(":color", QString(pick(m_rng, COLORS)));
+            query.bindValue(":budget", rate * (40 + m_rng.bounded(400)));
+            query.bindValue(":rate", rate);
+            query.bindValue(":start", start.toString(Qt::ISODate));
+            query.bindValue(":end", m_rng.bounded(3) == 0 ? QVariant() : QVariant(start.addDays(90 + m_rng.bounded(365)).toString(Qt::ISODate)));
+            if (!exec(query)) {
+                return false;
+            }
+            m_projectIds << query.lastInsertId().toLongLong();
+            cumulative += 1.0 / (i + 1);
+            m_projectWeights << cumulative;
+        }
+        m_tasksByProject.resize(count);
+        return true;
+    }
+
+    bool insertTasks()
+    {
+        QSqlQuery query(m_db);
+        query.prepare("INSERT INTO tasks (name, due_date, project_id, allocated_time, is_active) "
+                      "VALUES (:name, :dueDate, :projectId, :allocated, :isActive)");
+        for (int p = 0; p < m_projectIds.size(); ++p) {
+            const int taskCount = 3 + m_rng.bounded(13);
+            for (int t = 0; t < taskCount; ++t) {
+                const QDate due = randomDay().addDays(m_rng.bounded(60));
+                const QString verb = pick(m_rng, TASK_VERBS);
+                const QString object = pick(m_rng, TASK_OBJECTS);
+                query.bindValue(":name", QString("%1 %2").arg(verb, object));
+                query.bindValue(":dueDate", due.toString(Qt::ISODate));
+                query.bindValue(":projectId", m_projectIds.at(p));
+                query.bindValue(":allocated", 60 * (1 + m_rng.bounded(80)));
+                query.bindValue(":isActive", due >= m_lastDay);
+                if (!exec(query)) {
+                    return false;
+                }
+                m_tasksByProject[p] << query.lastInsertId().toLongLong();
+            }
+        }
+        return true;
+    }
+
+    bool insertSubtasks()
+    {
+        QSqlQuery query(m_db);
+        query.prepare("INSERT INTO subtasks (name, parent_task_id, is_completed) VALUES (:name, :taskId, :completed)");
+        for (const QVector<qint64> &tasks : std::as_const(m_tasksByProject)) {
+            for (qint64 taskId : tasks) {
+                const int subtaskCount = m_rng.bounded(7);
+                for (int s = 0; s < subtaskCount; ++s) {
+                    query.bindValue(":name", QString(pick(m_rng, SUBTASK_STEPS)));
+                    query.bindValue(":taskId", taskId);
+                    query.bindValue(":completed", m_rng.bounded(5) < 2);
+                    if (!exec(query)) {
+                        return false;
+                    }
+                    m_subtasksByTask.insert(taskId, query.lastInsertId().toLongLong());
+                }
+            }
+        }
+        return true;
+    }
+
+    bool insertTimeEntries(qint64 count)
+    {
+        QVector<QDate> workdays;
+        for (QDate day = m_firstDay; day <= m_lastDay; day = day.addDays(1)) {
+            if (day.dayOfWeek() <= 5) {
+                workdays << day;
+            }
+        }
+
+        QSqlQuery query(m_db);
+        query.prepare("INSERT INTO time_entries (project_id, task_id, subtask_id, description, start_time, end_time, duration) "
+                      "VALUES (:projectId, :taskId, :subtaskId, :desc, :start, :end, :duration)");
+
+        qint64 written = 0;
+        for (int d = 0; d < workdays.size() && written < count; ++d) {
+            // Spread the remainder evenly so the last day is not overloaded
+            const qint64 remainingDays = workdays.size() - d;
+            const qint64 dayCount = (count - written + remainingDays - 1) / remainingDays;
+            QDateTime cursor(workdays.at(d), QTime(8, 0).addSecs(60 * m_rng.bounded(60)));
+            const QDateTime dayEnd(workdays.at(d), QTime(19, 0));
+
+            for (qint64 e = 0; e < dayCount; ++e) {
+                const int minutes = entryMinutes(m_rng);
+                if (cursor.addSecs(60 * minutes) > dayEnd) {
+                    cursor = QDateTime(workdays.at(d), QTime(8, 0).addSecs(300 * m_rng.bounded(100)));
+                }
+                const int p = pickProject();
+                const QVector<qint64> &tasks = m_tasksByProject.at(p);
+                QVariant taskId;
+                QVariant subtaskId;
+                if (!tasks.isEmpty() && m_rng.bounded(10) < 7) {
+                    const qint64 task = tasks.at(m_rng.bounded(int(tasks.size())));
+                    taskId = task;
+                    const QList<qint64> subtasks = m_subtasksByTask.values(task);
+                    if (!subtasks.isEmpty() && m_rng.bounded(5) == 0) {
+                        subtaskId = subtasks.at(m_rng.bounded(int(subtasks.size())));
+                    }
+                }
+
+                const QDateTime end = cursor.addSecs(60 * minutes);
+                query.bindValue(":projectId", m_projectIds.at(p));
+                query.bindValue(":taskId", taskId);
+                query.bindValue(":subtaskId", subtaskId);
+                query.bindValue(":desc", QString(pick(m_rng, DESCRIPTIONS)));
+                query.bindValue(":start", cursor.toString(Qt::ISODate));
+                query.bindValue(":end", end.toString(Qt::ISODate));
+                query.bindValue(":duration", minutes);
+                if (!exec(query) || !rowWritten()) {
+                    return false;
+                }
+                cursor = end.addSecs(300 * m_rng.bounded(7));
+
+                if (++written % DataGenerator::ROWS_PER_TRANSACTION == 0 && m_progress) {
+                    m_progress(written, count);
+                }
+            }
+        }
+        if (m_progress) {
+            m_progress(written, count);
+        }
+        return true;
+    }
+
+    bool insertPresence()
+    {
+        QSqlQuery query(m_db);
+        query.prepare("INSERT INTO office_presence (date, start_time, end_time, duration) VALUES (:date, :start, :end, :duration)");
+        for (QDate day = m_firstDay; day <= m_lastDay; day = day.addDays(1)) {
+            // Roughly three office days a week
+            if (day.dayOfWeek() > 5 || m_rng.bounded(5) >= 3) {
+                continue;
+            }
+            const QDateTime start(day, QTime(7, 30).addSecs(300 * m_rng.bounded(24)));
+            const QDateTime end = start.addSecs(60 * (420 + 5 * m_rng.bounded(48)));
+            query.bindValue(":date", day.toString(Qt::ISODate));
+            query.bindValue(":start", start.toString(Qt::ISODate));
+            query.bindValue(":end", end.toString(Qt::ISODate));
+            query.bindValue(":duration", start.secsTo(end) / 60);
+            if (!exec(query) || !rowWritten()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    QSqlDatabase &m_db;
+    QRandomGenerator m_rng;
+    DataGenerator::ProgressCallback m_progress;
+    int m_pendingRows;
+    qint64 m_projectBase;
+    QString m_error;
+    QDate m_firstDay;
+    QDate m_lastDay;
+    QVector<qint64> m_projectIds;
+    QVector<double> m_projectWeights;
+    QVector<QVector<qint64>> m_tasksByProject;
+    QMultiHash<qint64, qint64> m_subtasksByTask;
+};
+
+} // namespace
+
+bool DataGenerator::generate(QSqlDatabase &db, qint64 timeEntries, quint32 seed,
+                             const ProgressCallback &progress, QString *errorMessage,
+                             const QDate &lastDay)
+{
+    qInfo() << "[DATAGEN] Generating" << timeEntries << "time entries with seed" << seed
+            << "up to" << lastDay.toString(Qt::ISODate);
+    Generator generator(db, seed, progress);
+    return generator.run(timeEntries, lastDay, errorMessage);
+}
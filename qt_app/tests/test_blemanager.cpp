@@ -0,0 +1,62 @@
+#include <QtTest/QtTest>
+#include <QSqlQuery>
+#include "../include/ble/blemanager.h"
+#include "../include/database/database.h"
+
+class TestBleManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        Database* db = Database::instance();
+        db->setDemoMode(true);
+        QVERIFY(db->initialize());
+    }
+
+    void testAddRemoveAndReload()
+    {
+        BleManager manager;
+        QSignalSpy changed(&manager, &BleManager::monitoredDevicesChanged);
+        QVERIFY(manager.addMonitoredDevice("Phone", "aa:bb:cc:dd:ee:01", "phone"));
+        QCOMPARE(manager.getMonitoredDevices().size(), 1);
+        const QVariantMap phone = manager.getMonitoredDevices().first().toMap();
+        QCOMPARE(phone.value("address").toString(), QString("AA:BB:CC:DD:EE:01"));
+        QVERIFY(!manager.addMonitoredDevice("Bad", "not an address", QString()));
+        
+        // Adding the same address again renames it in place
+        QVERIFY(manager.addMonitoredDevice("Work Phone", "AA:BB:CC:DD:EE:01", "watch"));
+        QCOMPARE(changed.count(), 2);
+        QCOMPARE(manager.getMonitoredDevices().size(), 1);
+        QCOMPARE(manager.getMonitoredDevices().first().toMap().value("id").toInt(), phone.value("id").toInt());
+        QCOMPARE(manager.getMonitoredDevices().first().toMap().value("name").toString(), QString("Work Phone"));
+        QCOMPARE(manager.getMonitoredDevices().first().toMap().value("deviceType").toString(), QString("watch"));
+        
+        // A row stored in another spelling is normalized on load
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("INSERT INTO ble_devices (name, mac_address, device_type, is_enabled) "
+                           "VALUES ('Badge', 'aa:bb:cc:dd:ee:02', 'badge', 1)"));
+        BleManager reloaded;
+        const QVariantList devices = reloaded.getMonitoredDevices();
+        QCOMPARE(devices.size(), 2);
+        QCOMPARE(devices.at(0).toMap().value("name").toString(), QString("Badge"));
+        QCOMPARE(devices.at(0).toMap().value("address").toString(), QString("AA:BB:CC:DD:EE:02"));
+        QCOMPARE(devices.at(1).toMap().value("name").toString(), QString("Work Phone"));
+        QVERIFY(query.exec("SELECT mac_address FROM ble_devices WHERE name = 'Badge'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QString("AA:BB:CC:DD:EE:02"));
+        
+        QVERIFY(reloaded.addMonitoredDevice("Badge", "aa:bb:cc:dd:ee:02", "badge"));
+        QCOMPARE(reloaded.getMonitoredDevices().size(), 2);
+        
+        QVERIFY(reloaded.removeMonitoredDevice(phone.value("id").toInt()));
+        QCOMPARE(reloaded.getMonitoredDevices().size(), 1);
+        BleManager afterRemove;
+        QCOMPARE(afterRemove.getMonitoredDevices().size(), 1);
+        QCOMPARE(afterRemove.getMonitoredDevices().first().toMap().value("name").toString(), QString("Badge"));
+    }
+};
+
+QTEST_MAIN(TestBleManager)
+#include "test_blemanager.moc"
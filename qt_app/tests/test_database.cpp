@@ -1,10 +1,58 @@
 #include <QtTest/QtTest>
+#include <QtConcurrent>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
 #include "../include/database/database.h"
+#include "../include/database/writequeue.h"
+#include "../include/database/changebus.h"
+#include "../include/database/databasemigration.h"
+#include "../include/database/onlinebackup.h"
+#include "../include/utils/datagenerator.h"
 
 class TestDatabase : public QObject
 {
     Q_OBJECT
 
+private:
+    // The projects and tasks tables as they were at schema version 5, with
+    // taskCount tasks of which the first has no project
+    static bool createVersion5Schema(QSqlDatabase &db, int taskCount)
+    {
+        QSqlQuery query(db);
+        const QStringList statements = {
+            "CREATE TABLE db_version (version INTEGER)",
+            "INSERT INTO db_version (version) VALUES (5)",
+            "CREATE TABLE projects (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, "
+            "description TEXT, color TEXT)",
+            "CREATE TABLE tasks (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, due_date DATE, "
+            "project_id INTEGER, allocated_time INTEGER DEFAULT 0, is_active BOOLEAN DEFAULT 0, "
+            "created_at DATETIME DEFAULT CURRENT_TIMESTAMP, updated_at DATETIME DEFAULT CURRENT_TIMESTAMP)",
+            "INSERT INTO projects (id, name) VALUES (1, 'Version 5 Project')"
+        };
+        for (const QString &statement : statements) {
+            if (!query.exec(statement)) {
+                qWarning() << statement << query.lastError().text();
+                return false;
+            }
+        }
+        
+        if (!db.transaction()) {
+            return false;
+        }
+        query.prepare("INSERT INTO tasks (name, project_id) VALUES (:name, :project)");
+        for (int i = 0; i < taskCount; ++i) {
+            query.bindValue(":name", QString("Task %1").arg(i));
+            query.bindValue(":project", i == 0 ? QVariant() : QVariant(1));
+            if (!query.exec()) {
+                qWarning() << query.lastError().text();
+                db.rollback();
+                return false;
+            }
+        }
+        return db.commit();
+    }
+
 private slots:
     void initTestCase()
     {
@@ -30,6 +78,566 @@ private slots:
         Database* db = Database::instance();
         QVERIFY(db->isDemoMode());
     }
+
+    void testWorkerThreadConnection()
+    {
+        Database* db = Database::instance();
+        QSqlQuery insert(db->database());
+        QVERIFY(insert.exec("INSERT INTO projects (name) VALUES ('Pooled Connection Project')"));
+        
+        QFuture<QString> future = QtConcurrent::run([]() {
+            QSqlDatabase workerDb = Database::instance()->database();
+            QSqlQuery query(workerDb);
+            query.exec("SELECT name FROM projects WHERE name = 'Pooled Connection Project'");
+            return query.next() ? workerDb.connectionName() + "|" + query.value(0).toString() : QString();
+        });
+        
+        const QStringList result = future.result().split('|');
+        QCOMPARE(result.size(), 2);
+        QVERIFY(result.at(0) != db->database().connectionName());
+        QCOMPARE(result.at(1), QString("Pooled Connection Project"));
+    }
+
+    void testBackupRestoreRoundTrip()
+    {
+        Database* db = Database::instance();
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("INSERT INTO projects (name, description) VALUES ('Backup Project', 'Quote \" and \\\\ backslash')"));
+        const int projectId = query.lastInsertId().toInt();
+        QVERIFY(query.exec(QString("INSERT INTO time_entries (project_id, description, start_time, end_time, duration) "
+                                   "VALUES (%1, 'Backed up', '2024-01-01T09:00:00', '2024-01-01T10:00:00', 60)").arg(projectId)));
+        
+        QTemporaryDir dir;
+        const QString path = dir.filePath("backup.json");
+        QVERIFY(db->backupToJson(path));
+        
+        QVERIFY(query.exec("DELETE FROM time_entries"));
+        QVERIFY(query.exec("DELETE FROM projects"));
+        
+        QSignalSpy restored(db, &Database::databaseRestored);
+        QVERIFY(db->restoreFromJson(path));
+        QCOMPARE(restored.count(), 1);
+        
+        QVERIFY(query.exec("SELECT description FROM projects WHERE name = 'Backup Project'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QString("Quote \" and \\\\ backslash"));
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries WHERE description = 'Backed up'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 1);
+    }
+
+    void testBackupRestoreKeepsSubtaskCounters()
+    {
+        Database* db = Database::instance();
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("INSERT INTO projects (name) VALUES ('Restored Counters')"));
+        const qint64 projectId = query.lastInsertId().toLongLong();
+        QVERIFY(query.exec(QString("INSERT INTO tasks (name, project_id) VALUES ('Restored Task', %1)").arg(projectId)));
+        const qint64 taskId = query.lastInsertId().toLongLong();
+        QVERIFY(query.exec(QString("INSERT INTO subtasks (name, parent_task_id, is_completed) VALUES ('a', %1, 1), ('b', %1, 0)").arg(taskId)));
+        QVERIFY(query.exec(QString("INSERT INTO time_entries (project_id, task_id, start_time, end_time, duration) "
+                                   "VALUES (%1, %2, '2024-02-01T09:00:00', '2024-02-01T09:45:00', 45)").arg(projectId).arg(taskId)));
+        
+        QTemporaryDir dir;
+        const QString path = dir.filePath("counters.json");
+        QVERIFY(db->backupToJson(path));
+        QVERIFY(db->restoreFromJson(path));
+        
+        QVERIFY(query.exec(QString("SELECT subtask_total, subtask_done FROM tasks WHERE id = %1").arg(taskId)));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 2);
+        QCOMPARE(query.value(1).toInt(), 1);
+        QVERIFY(query.exec(QString("SELECT SUM(minutes) FROM daily_project_totals WHERE project_id = %1").arg(projectId)));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 45);
+        QVERIFY(db->verifySubtaskCounters(false));
+        QVERIFY(db->verifyDailyTotals(false));
+        
+        // The triggers dropped for the load are back
+        QVERIFY(query.exec(QString("INSERT INTO subtasks (name, parent_task_id, is_completed) VALUES ('c', %1, 1)").arg(taskId)));
+        QVERIFY(query.exec(QString("INSERT INTO time_entries (project_id, task_id, start_time, end_time, duration) "
+                                   "VALUES (%1, %2, '2024-02-02T09:00:00', '2024-02-02T09:15:00', 15)").arg(projectId).arg(taskId)));
+        QVERIFY(db->verifySubtaskCounters(false));
+        QVERIFY(db->verifyDailyTotals(false));
+    }
+
+    void testOnlineBackupOfDemoDatabase()
+    {
+        Database* db = Database::instance();
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("SELECT COUNT(*) FROM projects"));
+        QVERIFY(query.next());
+        const int projectCount = query.value(0).toInt();
+        
+        QTemporaryDir dir;
+        const QString path = dir.filePath("snapshot.db");
+        QSignalSpy finished(db, &Database::backupFinished);
+        QVERIFY(db->backupTo(path));
+        QVERIFY(db->isBackupRunning());
+        QVERIFY(finished.wait(10000));
+        QVERIFY(finished.first().at(0).toBool());
+        QVERIFY(!db->isBackupRunning());
+        
+        {
+            QSqlDatabase snapshot = QSqlDatabase::addDatabase("QSQLITE", "snapshot");
+            snapshot.setDatabaseName(path);
+            QVERIFY(snapshot.open());
+            QSqlQuery snapshotQuery(snapshot);
+            QVERIFY(snapshotQuery.exec("SELECT COUNT(*) FROM projects"));
+            QVERIFY(snapshotQuery.next());
+            QCOMPARE(snapshotQuery.value(0).toInt(), projectCount);
+        }
+        QSqlDatabase::removeDatabase("snapshot");
+    }
+
+    void testOnlineBackupOfFileDatabaseCopiesInSteps()
+    {
+        QTemporaryDir dir;
+        const QString sourcePath = dir.filePath("source.db");
+        const QString path = dir.filePath("copy.db");
+        {
+            QSqlDatabase source = QSqlDatabase::addDatabase("QSQLITE", "online_source");
+            source.setDatabaseName(sourcePath);
+            QVERIFY(source.open());
+            QSqlQuery query(source);
+            QVERIFY(query.exec("PRAGMA journal_mode=WAL"));
+            QVERIFY(query.exec("CREATE TABLE items (id INTEGER PRIMARY KEY, label TEXT)"));
+            QVERIFY(query.exec("CREATE TABLE item_count (n INTEGER)"));
+            QVERIFY(query.exec("INSERT INTO item_count VALUES (0)"));
+            QVERIFY(query.exec("CREATE INDEX idx_items_label ON items(label)"));
+            QVERIFY(query.exec("CREATE TRIGGER trg_items_count AFTER INSERT ON items BEGIN UPDATE item_count SET n = n + 1; END"));
+            QVERIFY(query.exec("PRAGMA user_version = 7"));
+            QVERIFY(source.transaction());
+            for (int i = 0; i < 5000; ++i) {
+                QVERIFY(query.exec(QString("INSERT INTO items (label) VALUES ('item %1')").arg(i)));
+            }
+            QVERIFY(source.commit());
+            
+            OnlineBackup backup(source, path);
+            QSignalSpy progress(&backup, &OnlineBackup::progress);
+            QSignalSpy finished(&backup, &OnlineBackup::finished);
+            QVERIFY(backup.start());
+            QVERIFY(backup.isIncremental());
+            // Written after the snapshot was taken, so not part of the copy
+            QVERIFY(query.exec("INSERT INTO items (label) VALUES ('late')"));
+            QVERIFY(finished.wait(10000));
+            QVERIFY(finished.first().at(0).toBool());
+            QVERIFY(progress.count() > 1);
+            QCOMPARE(progress.last().at(0).toInt(), progress.last().at(1).toInt());
+        }
+        QSqlDatabase::removeDatabase("online_source");
+        
+        {
+            QSqlDatabase copy = QSqlDatabase::addDatabase("QSQLITE", "online_copy");
+            copy.setDatabaseName(path);
+            QVERIFY(copy.open());
+            QSqlQuery query(copy);
+            QVERIFY(query.exec("SELECT COUNT(*), (SELECT n FROM item_count) FROM items"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 5000);
+            // The trigger is created after the rows, so the copy does not count them twice
+            QCOMPARE(query.value(1).toInt(), 5000);
+            QVERIFY(query.exec("SELECT COUNT(*) FROM sqlite_master WHERE name IN ('idx_items_label', 'trg_items_count')"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 2);
+            QVERIFY(query.exec("PRAGMA user_version"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 7);
+        }
+        QSqlDatabase::removeDatabase("online_copy");
+    }
+
+    void testOnlineBackupCopiesMigratedSchema()
+    {
+        Database* db = Database::instance();
+        QSqlQuery demo(db->database());
+        QVERIFY(demo.exec("INSERT INTO projects (name) VALUES ('Migrated Copy')"));
+        const qint64 projectId = demo.lastInsertId().toLongLong();
+        QVERIFY(demo.exec(QString("INSERT INTO time_entries (project_id, start_time, end_time, duration) "
+                                  "VALUES (%1, '2024-03-01T09:00:00', '2024-03-01T10:00:00', 60)").arg(projectId)));
+
+        // A file with every migration applied, daily_project_totals
+        // (WITHOUT ROWID) and sqlite_sequence included
+        QTemporaryDir dir;
+        const QString sourcePath = dir.filePath("migrated.db");
+        const QString path = dir.filePath("migrated_copy.db");
+        demo.prepare("VACUUM INTO :path");
+        demo.bindValue(":path", sourcePath);
+        QVERIFY(demo.exec());
+
+        qint64 sequence = 0;
+        int totalsRows = 0;
+        {
+            QSqlDatabase source = QSqlDatabase::addDatabase("QSQLITE", "migrated_source");
+            source.setDatabaseName(sourcePath);
+            QVERIFY(source.open());
+            QSqlQuery query(source);
+            QVERIFY(query.exec("PRAGMA journal_mode=WAL"));
+            // The AUTOINCREMENT counter runs ahead of the largest remaining id
+            QVERIFY(query.exec("INSERT INTO projects (name) VALUES ('Deleted Later')"));
+            QVERIFY(query.exec(QString("DELETE FROM projects WHERE id = %1").arg(query.lastInsertId().toLongLong())));
+            QVERIFY(query.exec("SELECT seq FROM sqlite_sequence WHERE name = 'projects'"));
+            QVERIFY(query.next());
+            sequence = query.value(0).toLongLong();
+            QVERIFY(query.exec("SELECT COUNT(*) FROM daily_project_totals"));
+            QVERIFY(query.next());
+            totalsRows = query.value(0).toInt();
+            QVERIFY(totalsRows > 0);
+
+            OnlineBackup backup(source, path);
+            QSignalSpy finished(&backup, &OnlineBackup::finished);
+            QVERIFY(backup.start());
+            QVERIFY(backup.isIncremental());
+            QVERIFY(finished.wait(10000));
+            QVERIFY2(finished.first().at(0).toBool(), qPrintable(finished.first().at(1).toString()));
+        }
+        QSqlDatabase::removeDatabase("migrated_source");
+
+        {
+            QSqlDatabase copy = QSqlDatabase::addDatabase("QSQLITE", "migrated_copy");
+            copy.setDatabaseName(path);
+            QVERIFY(copy.open());
+            QSqlQuery query(copy);
+            QVERIFY(query.exec("SELECT COUNT(*) FROM daily_project_totals"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), totalsRows);
+            QVERIFY(query.exec("SELECT seq FROM sqlite_sequence WHERE name = 'projects'"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toLongLong(), sequence);
+            QVERIFY(!query.next());
+        }
+        QSqlDatabase::removeDatabase("migrated_copy");
+    }
+
+    void testRestoreRejectsTruncatedFile()
+    {
+        Database* db = Database::instance();
+        QTemporaryDir dir;
+        QFile file(dir.filePath("truncated.json"));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QString("{\"format\": \"project-time-tracker-backup\", \"version\": %1, \"tables\": {\"projects\": [{\"id\": 1")
+                   .arg(db->currentVersion()).toUtf8());
+        file.close();
+        
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("SELECT COUNT(*) FROM projects"));
+        QVERIFY(query.next());
+        const int before = query.value(0).toInt();
+        
+        QVERIFY(!db->restoreFromJson(file.fileName()));
+        
+        QVERIFY(query.exec("SELECT COUNT(*) FROM projects"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), before);
+    }
+
+    void testRestoreRejectsOtherSchemaVersion()
+    {
+        Database* db = Database::instance();
+        QTemporaryDir dir;
+        const QString path = dir.filePath("other_version.json");
+        QVERIFY(db->backupToJson(path));
+        
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QByteArray contents = file.readAll();
+        file.close();
+        const QByteArray header = "\"version\": " + QByteArray::number(db->currentVersion());
+        QVERIFY(contents.contains(header));
+        contents.replace(header, "\"version\": " + QByteArray::number(db->currentVersion() - 1));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write(contents);
+        file.close();
+        
+        QSignalSpy failed(db, &Database::databaseError);
+        QVERIFY(!db->restoreFromJson(path));
+        QCOMPARE(failed.count(), 1);
+        QVERIFY(failed.first().at(0).toString().contains("schema version"));
+    }
+
+    void testDataGeneratorFillsTables()
+    {
+        QSqlDatabase db = Database::instance()->database();
+        QSqlQuery query(db);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries"));
+        QVERIFY(query.next());
+        const int before = query.value(0).toInt();
+        
+        QString errorMessage;
+        QVERIFY2(DataGenerator::generate(db, 1000, DataGenerator::DEFAULT_SEED, {}, &errorMessage),
+                 qPrintable(errorMessage));
+        
+        QVERIFY(query.exec("SELECT COUNT(*), COUNT(task_id), COUNT(start_epoch), MIN(duration) FROM time_entries"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), before + 1000);
+        QVERIFY(query.value(1).toInt() > 0);
+        QCOMPARE(query.value(2).toInt(), query.value(0).toInt());
+        QVERIFY(query.value(3).toInt() > 0);
+        
+        for (const QString &table : { QString("tasks"), QString("subtasks"), QString("office_presence") }) {
+            QVERIFY(query.exec("SELECT COUNT(*) FROM " + table));
+            QVERIFY(query.next());
+            QVERIFY2(query.value(0).toInt() > 0, qPrintable(table + " is empty"));
+        }
+        
+        // History ends on the fixed default day, not on the day the test runs
+        QVERIFY(query.exec("SELECT MAX(date(start_time)) FROM time_entries"));
+        QVERIFY(query.next());
+        QVERIFY(query.value(0).toString() <= DataGenerator::DEFAULT_LAST_DAY.toString(Qt::ISODate));
+        
+        // The same seed again extends the database instead of colliding on project names
+        QVERIFY2(DataGenerator::generate(db, 1000, DataGenerator::DEFAULT_SEED, {}, &errorMessage),
+                 qPrintable(errorMessage));
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), before + 2000);
+    }
+
+    void testDailyTotalsFollowTimeEntries()
+    {
+        Database* db = Database::instance();
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("INSERT INTO projects (name) VALUES ('Rollup Project')"));
+        const qint64 projectId = query.lastInsertId().toLongLong();
+        
+        query.prepare("INSERT INTO time_entries (project_id, start_time, end_time, duration) "
+                      "VALUES (:projectId, :start, '2022-02-01T12:00:00', :duration)");
+        query.bindValue(":projectId", projectId);
+        for (const QString &start : { QString("2022-02-01T09:00:00"), QString("2022-02-01T10:00:00"),
+                                      QString("2022-02-02T09:00:00") }) {
+            query.bindValue(":start", start);
+            query.bindValue(":duration", 30);
+            QVERIFY(query.exec());
+        }
+        const qint64 lastId = query.lastInsertId().toLongLong();
+        
+        QVERIFY(query.exec(QString("UPDATE time_entries SET start_time = '2022-02-01T15:00:00', duration = 45 WHERE id = %1").arg(lastId)));
+        QVERIFY(query.exec(QString("SELECT day, minutes, entry_count FROM daily_project_totals WHERE project_id = %1").arg(projectId)));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QString("2022-02-01"));
+        QCOMPARE(query.value(1).toInt(), 105);
+        QCOMPARE(query.value(2).toInt(), 3);
+        QVERIFY(!query.next());
+        
+        QVERIFY(query.exec(QString("DELETE FROM time_entries WHERE project_id = %1").arg(projectId)));
+        QVERIFY(query.exec(QString("SELECT COUNT(*) FROM daily_project_totals WHERE project_id = %1").arg(projectId)));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 0);
+        
+        QVERIFY(db->verifyDailyTotals(false));
+        QVERIFY(query.exec("UPDATE daily_project_totals SET minutes = minutes + 1"));
+        QVERIFY(!db->verifyDailyTotals(false));
+        QVERIFY(db->verifyDailyTotals());
+        QVERIFY(db->verifyDailyTotals(false));
+    }
+
+    void testSubtaskCountersFollowSubtasks()
+    {
+        Database* db = Database::instance();
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("INSERT INTO projects (name) VALUES ('Counter Project')"));
+        const qint64 projectId = query.lastInsertId().toLongLong();
+        QVERIFY(query.exec(QString("INSERT INTO tasks (name, project_id) VALUES ('First', %1)").arg(projectId)));
+        const qint64 firstId = query.lastInsertId().toLongLong();
+        QVERIFY(query.exec(QString("INSERT INTO tasks (name, project_id) VALUES ('Second', %1)").arg(projectId)));
+        const qint64 secondId = query.lastInsertId().toLongLong();
+        
+        QVERIFY(query.exec(QString("INSERT INTO subtasks (name, parent_task_id, is_completed) VALUES ('a', %1, 0), ('b', %1, 1), ('c', %1, 0)").arg(firstId)));
+        QVERIFY(query.exec(QString("UPDATE subtasks SET is_completed = 1 WHERE name = 'a' AND parent_task_id = %1").arg(firstId)));
+        QVERIFY(query.exec(QString("UPDATE subtasks SET parent_task_id = %1 WHERE name = 'b' AND parent_task_id = %2").arg(secondId).arg(firstId)));
+        QVERIFY(query.exec(QString("DELETE FROM subtasks WHERE name = 'c' AND parent_task_id = %1").arg(firstId)));
+        
+        QVERIFY(query.exec(QString("SELECT id, subtask_total, subtask_done FROM tasks WHERE id IN (%1, %2) ORDER BY id").arg(firstId).arg(secondId)));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(1).toInt(), 1);
+        QCOMPARE(query.value(2).toInt(), 1);
+        QVERIFY(query.next());
+        QCOMPARE(query.value(1).toInt(), 1);
+        QCOMPARE(query.value(2).toInt(), 1);
+        
+        QVERIFY(db->verifySubtaskCounters(false));
+        QVERIFY(query.exec(QString("UPDATE tasks SET subtask_done = 0 WHERE id = %1").arg(firstId)));
+        QVERIFY(!db->verifySubtaskCounters(false));
+        QVERIFY(db->verifySubtaskCounters());
+        QVERIFY(db->verifySubtaskCounters(false));
+    }
+
+    void testCompactPresenceSessions()
+    {
+        Database* db = Database::instance();
+        QSqlDatabase sqlDb = db->database();
+        QSqlQuery query(sqlDb);
+        query.prepare("INSERT INTO office_presence (date, start_time, end_time, duration) VALUES ('2021-05-03', :start, :end, :duration)");
+        const QList<QStringList> rows = {
+            { "2021-05-03T08:00:00", "2021-05-03T08:15:00", "15" },
+            { "2021-05-03T08:00:00", "2021-05-03T08:30:00", "30" },
+            { "2021-05-03T08:00:00", "2021-05-03T08:45:00", "45" },
+            { "2021-05-03T13:00:00", "2021-05-03T13:20:00", "20" }
+        };
+        for (const QStringList &row : rows) {
+            query.bindValue(":start", row.at(0));
+            query.bindValue(":end", row.at(1));
+            query.bindValue(":duration", row.at(2).toInt());
+            QVERIFY(query.exec());
+        }
+        
+        QCOMPARE(DatabaseMigration::compactPresenceSessions(sqlDb), 2);
+        QVERIFY(query.exec("SELECT COUNT(*), SUM(duration) FROM office_presence WHERE date = '2021-05-03'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 2);
+        QCOMPARE(query.value(1).toInt(), 65);
+        QCOMPARE(DatabaseMigration::compactPresenceSessions(sqlDb), 0);
+    }
+
+    void testChangeBusCoalescesPerTurn()
+    {
+        Database* db = Database::instance();
+        QSignalSpy changed(db->changeBus(), &ChangeBus::rowsChanged);
+        
+        qint64 projectId = -1;
+        db->writeQueue()->enqueue("INSERT INTO projects (name) VALUES ('Change Bus Project')", QVariantMap(),
+                                  [&projectId](bool success, const QVariant &lastInsertId, const QString &) {
+            QVERIFY(success);
+            projectId = lastInsertId.toLongLong();
+        });
+        db->flushPendingWrites();
+        db->writeQueue()->enqueue("UPDATE projects SET description = 'Edited' WHERE id = :id", {{":id", projectId}});
+        db->flushPendingWrites();
+        
+        QVERIFY(changed.wait(1000));
+        QCOMPARE(changed.count(), 1);
+        
+        int matches = 0;
+        const QList<RowChange> changes = changed.first().at(0).value<QList<RowChange>>();
+        for (const RowChange &change : changes) {
+            if (change.table == "projects" && change.rowId == projectId) {
+                ++matches;
+                QCOMPARE(change.operation, RowChange::Insert);
+            }
+        }
+        QCOMPARE(matches, 1);
+    }
+
+    void testWriteQueueRollsBackOnlyTheFailedWrite()
+    {
+        WriteQueue *queue = Database::instance()->writeQueue();
+        QList<bool> outcomes;
+        const auto record = [&outcomes](bool success, const QVariant &, const QString &) { outcomes << success; };
+
+        queue->enqueue("INSERT INTO projects (name) VALUES ('Queue Before')", QVariantMap(), record);
+        queue->enqueueBatch("INSERT INTO projects (name) VALUES (:name)", QList<QVariantMap>{ QVariantMap{{":name", "Queue Batch"}}, QVariantMap{{":name", QVariant()}} },
+                            [&outcomes](bool success, const QVariantList &, const QString &) { outcomes << success; });
+        queue->enqueue("INSERT INTO projects (name) VALUES ('Queue After')", QVariantMap(), record);
+        queue->flush();
+        QCOMPARE(outcomes, QList<bool>({ true, false, true }));
+
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("SELECT name FROM projects WHERE name LIKE 'Queue %' ORDER BY id"));
+        QStringList names;
+        while (query.next()) {
+            names << query.value(0).toString();
+        }
+        QCOMPARE(names, QStringList({ "Queue Before", "Queue After" }));
+    }
+
+    void testReadersFlushOnlyWritesTheyDependOn()
+    {
+        Database *db = Database::instance();
+        db->writeQueue()->enqueue("INSERT INTO projects (name) VALUES ('Scoped Flush')", QVariantMap());
+        
+        db->flushPendingWrites({ "office_presence" });
+        QCOMPARE(db->writeQueue()->pendingCount(), 1);
+        db->flushPendingWrites({ "tasks", "projects" });
+        QCOMPARE(db->writeQueue()->pendingCount(), 0);
+        
+        // A write the queue cannot attribute to a table flushes for everyone
+        db->writeQueue()->enqueue("REPLACE INTO projects (name) VALUES ('Scoped Flush')", QVariantMap());
+        db->flushPendingWrites({ "office_presence" });
+        QCOMPARE(db->writeQueue()->pendingCount(), 0);
+    }
+
+    void testDataGeneratorKeepsCommittedRowsOnFailure()
+    {
+        QSqlDatabase db = Database::instance()->database();
+        QSqlQuery query(db);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries"));
+        QVERIFY(query.next());
+        const qint64 before = query.value(0).toLongLong();
+
+        // Presence sessions come last; refusing them fails the run after the
+        // first ROWS_PER_TRANSACTION time entries have been committed
+        QVERIFY(query.exec("CREATE TEMP TRIGGER refuse_presence BEFORE INSERT ON office_presence "
+                           "BEGIN SELECT RAISE(ABORT, 'presence refused'); END"));
+        QString errorMessage;
+        QVERIFY(!DataGenerator::generate(db, DataGenerator::ROWS_PER_TRANSACTION + 100, DataGenerator::DEFAULT_SEED, {}, &errorMessage));
+        QVERIFY(errorMessage.contains("presence refused"));
+        QVERIFY(query.exec("DROP TRIGGER refuse_presence"));
+
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toLongLong() - before, qint64(DataGenerator::ROWS_PER_TRANSACTION));
+    }
+
+    void testMigrationReportsProgressInOrder()
+    {
+        QTemporaryDir dir;
+        const int taskCount = DatabaseMigration::ROWS_PER_BATCH * 2 + 7;
+        QList<QList<qint64>> reports;
+        bool migrated = false;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "migration_progress");
+            db.setDatabaseName(dir.filePath("v5.db"));
+            QVERIFY(db.open());
+            QVERIFY(createVersion5Schema(db, taskCount));
+            migrated = DatabaseMigration::migrateToVersion(db, 6, [&reports](int step, qint64 rowsDone, qint64 rowsTotal) {
+                reports << QList<qint64>{ step, rowsDone, rowsTotal };
+            });
+            QCOMPARE(DatabaseMigration::getCurrentVersion(db), 6);
+        }
+        QSqlDatabase::removeDatabase("migration_progress");
+        QVERIFY(migrated);
+
+        // The step announcement, then one report per batch
+        QCOMPARE(reports.size(), 4);
+        QCOMPARE(reports.first(), QList<qint64>({ 6, 0, 0 }));
+        qint64 previous = 0;
+        for (int i = 1; i < reports.size(); ++i) {
+            QCOMPARE(reports.at(i).at(0), qint64(6));
+            QCOMPARE(reports.at(i).at(2), qint64(taskCount));
+            QVERIFY(reports.at(i).at(1) > previous);
+            previous = reports.at(i).at(1);
+        }
+        QCOMPARE(previous, qint64(taskCount));
+    }
+
+    void testFailedMigrationStepRollsBack()
+    {
+        QTemporaryDir dir;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "migration_rollback");
+            db.setDatabaseName(dir.filePath("v5.db"));
+            QVERIFY(db.open());
+            QVERIFY(createVersion5Schema(db, 3));
+            
+            // v6 fixes up the orphaned task before it creates tasks_new;
+            // the name clash fails the step after that write
+            QSqlQuery query(db);
+            QVERIFY(query.exec("CREATE TABLE tasks_new (x INTEGER)"));
+            QVERIFY(!DatabaseMigration::migrateToVersion(db, 13));
+            
+            QCOMPARE(DatabaseMigration::getCurrentVersion(db), 5);
+            QVERIFY(query.exec("SELECT COUNT(*) FROM tasks WHERE project_id IS NULL"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 1);
+            QVERIFY(query.exec("SELECT COUNT(*) FROM projects WHERE id = 0"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 0);
+            QVERIFY(query.exec("SELECT COUNT(*) FROM sqlite_master WHERE name = 'subtasks'"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 0);
+        }
+        QSqlDatabase::removeDatabase("migration_rollback");
+    }
 };
 
 QTEST_MAIN(TestDatabase)
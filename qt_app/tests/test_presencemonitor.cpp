@@ -0,0 +1,86 @@
+#include <QtTest/QtTest>
+#include <QSqlQuery>
+#include "../include/ble/presencemonitor.h"
+#include "../include/ble/blemanager.h"
+#include "../include/database/database.h"
+
+class TestPresenceMonitor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        Database* db = Database::instance();
+        db->setDemoMode(true);
+        QVERIFY(db->initialize());
+    }
+
+    void init()
+    {
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("DELETE FROM office_presence"));
+    }
+
+    void testRepeatedSavesKeepOneRow()
+    {
+        BleManager ble;
+        PresenceMonitor monitor(&ble);
+        monitor.start();
+        monitor.onDeviceDetected("AA:BB:CC:DD:EE:01");
+        QVERIFY(monitor.isInOffice());
+        
+        const QDateTime detected = monitor.m_sessionStartTime;
+        monitor.m_sessionStartTime = detected.addSecs(-10 * 60);
+        monitor.saveCurrentSession();
+        // The INSERT is still queued: this save waits for its row id
+        monitor.saveCurrentSession();
+        monitor.m_sessionStartTime = detected.addSecs(-25 * 60);
+        const QString latestEnd = QDateTime::currentDateTime().toString(Qt::ISODate);
+        monitor.saveCurrentSession();
+        Database::instance()->flushPendingWrites();
+        
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("SELECT COUNT(*), MAX(end_time), MAX(duration) FROM office_presence"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 1);
+        QVERIFY(query.value(1).toString() >= latestEnd);
+        QCOMPARE(query.value(2).toInt(), 25);
+        
+        monitor.stop();
+    }
+
+    void testLateInsertDoesNotJoinNextSession()
+    {
+        BleManager ble;
+        PresenceMonitor monitor(&ble);
+        monitor.start();
+        monitor.onDeviceDetected("AA:BB:CC:DD:EE:01");
+        monitor.m_sessionStartTime = monitor.m_sessionStartTime.addSecs(-30 * 60);
+        monitor.saveCurrentSession();
+        
+        // A new session starts before the first session's INSERT commits
+        monitor.endSession();
+        monitor.onDeviceDetected("AA:BB:CC:DD:EE:01");
+        monitor.m_sessionStartTime = monitor.m_sessionStartTime.addSecs(-5 * 60);
+        Database::instance()->flushPendingWrites();
+        QCOMPARE(monitor.m_sessionRowId, qint64(0));
+        
+        monitor.saveCurrentSession();
+        Database::instance()->flushPendingWrites();
+        QVERIFY(monitor.m_sessionRowId > 0);
+        
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("SELECT duration FROM office_presence ORDER BY id"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 30);
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 5);
+        QVERIFY(!query.next());
+        
+        monitor.stop();
+    }
+};
+
+QTEST_MAIN(TestPresenceMonitor)
+#include "test_presencemonitor.moc"
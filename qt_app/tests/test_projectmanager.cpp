@@ -1,5 +1,6 @@
 #include <QtTest/QtTest>
 #include "../include/managers/projectmanager.h"
+#include "../include/managers/timeentrymanager.h"
 #include "../include/database/database.h"
 
 class TestProjectManager : public QObject
@@ -31,6 +32,91 @@ private slots:
         QVariantList projects = manager.getAllProjects();
         QVERIFY(projects.size() > 0);
     }
+
+    void testGetAllProjectsAsync()
+    {
+        ProjectManager manager;
+        QFuture<QVariantList> future = manager.getAllProjectsAsync();
+        // The result is handed over on this thread's event loop
+        QTRY_VERIFY(future.isFinished());
+        QCOMPARE(future.result().size(), manager.getAllProjects().size());
+    }
+
+    void testProjectStats()
+    {
+        ProjectManager manager;
+        QVariantMap projectData;
+        projectData["name"] = "Stats Project";
+        projectData["budget"] = 200;
+        projectData["hourlyRate"] = 60;
+        QVERIFY(manager.createProject(projectData));
+        
+        int projectId = 0;
+        for (const QVariant &project : manager.getAllProjects()) {
+            if (project.toMap().value("name") == "Stats Project") {
+                projectId = project.toMap().value("id").toInt();
+            }
+        }
+        QVERIFY(projectId > 0);
+        QCOMPARE(manager.getProjectStats(projectId).value("totalMinutes").toLongLong(), 0);
+        QCOMPARE(manager.getProjectStats(projectId).value("budgetRemaining").toDouble(), 200.0);
+        
+        TimeEntryManager entries;
+        QVariantMap entryData;
+        entryData["projectId"] = projectId;
+        entryData["startTime"] = "2023-02-01T09:00:00";
+        entryData["endTime"] = "2023-02-01T10:30:00";
+        entryData["duration"] = 90;
+        QVERIFY(entries.createTimeEntry(entryData));
+        entryData["startTime"] = "2023-02-02T09:00:00";
+        entryData["endTime"] = "2023-02-02T09:30:00";
+        entryData["duration"] = 30;
+        QVERIFY(entries.createTimeEntry(entryData));
+        
+        QVariantMap stats = manager.getProjectStats(projectId);
+        QCOMPARE(stats.value("totalMinutes").toLongLong(), 120);
+        QCOMPARE(stats.value("entryCount").toInt(), 2);
+        QCOMPARE(stats.value("totalEarnings").toDouble(), 120.0);
+        QCOMPARE(stats.value("budgetPercent").toDouble(), 60.0);
+        QCOMPARE(stats.value("lastActivity").toString(), QString("2023-02-02T09:30:00"));
+        
+        const QVariantList all = manager.getAllProjectStats();
+        QCOMPARE(all.size(), manager.getAllProjects().size());
+        
+        // A time entry change from the change bus makes the cached stats stale
+        int latestId = 0;
+        for (const QVariant &entry : entries.getTimeEntriesByProject(projectId)) {
+            if (entry.toMap().value("startTime") == "2023-02-02T09:00:00") {
+                latestId = entry.toMap().value("id").toInt();
+            }
+        }
+        QVERIFY(entries.deleteTimeEntry(latestId));
+        stats = manager.getProjectStats(projectId);
+        QCOMPARE(stats.value("totalMinutes").toLongLong(), 90);
+        QCOMPARE(stats.value("lastActivity").toString(), QString("2023-02-01T10:30:00"));
+        
+        // Moving an entry recomputes the project it left and the one it joined
+        projectData["name"] = "Other Stats Project";
+        QVERIFY(manager.createProject(projectData));
+        int otherId = 0;
+        for (const QVariant &project : manager.getAllProjects()) {
+            if (project.toMap().value("name") == "Other Stats Project") {
+                otherId = project.toMap().value("id").toInt();
+            }
+        }
+        QCOMPARE(manager.getProjectStats(otherId).value("totalMinutes").toLongLong(), 0);
+        const int earlierId = entries.getTimeEntriesByProject(projectId).first().toMap().value("id").toInt();
+        entryData["projectId"] = otherId;
+        entryData["startTime"] = "2023-02-01T09:00:00";
+        entryData["endTime"] = "2023-02-01T10:30:00";
+        entryData["duration"] = 90;
+        QVERIFY(entries.updateTimeEntry(earlierId, entryData));
+        QCOMPARE(manager.getProjectStats(projectId).value("totalMinutes").toLongLong(), 0);
+        QCOMPARE(manager.getProjectStats(otherId).value("totalMinutes").toLongLong(), 90);
+        
+        QVERIFY(manager.deleteProject(projectId));
+        QVERIFY(manager.getProjectStats(projectId).isEmpty());
+    }
 };
 
 QTEST_MAIN(TestProjectManager)
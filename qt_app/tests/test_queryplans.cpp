@@ -0,0 +1,250 @@
+#include <QtTest/QtTest>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRegularExpression>
+#include "../include/database/database.h"
+#include "../include/database/statements.h"
+
+// Runs EXPLAIN QUERY PLAN on the statements the managers issue, taken from
+// Statements, and fails when one falls back to a full scan of a table that
+// grows with usage or stops searching the index it was written for.
+class TestQueryPlans : public QObject
+{
+    Q_OBJECT
+
+private:
+    QStringList largeTables() const
+    {
+        return { "time_entries", "tasks", "subtasks", "office_presence", "daily_project_totals" };
+    }
+
+    QStringList queryPlan(const QString &sql)
+    {
+        // Named placeholders become literals so the statement can run unbound
+        QString statement = sql;
+        statement.replace(QRegularExpression(":[A-Za-z_][A-Za-z0-9_]*"), "1");
+
+        QStringList details;
+        QSqlQuery query(Database::instance()->database());
+        if (!query.exec("EXPLAIN QUERY PLAN " + statement)) {
+            qWarning() << "EXPLAIN failed:" << query.lastError().text() << statement;
+            return details;
+        }
+        while (query.next()) {
+            details << query.value("detail").toString();
+        }
+        return details;
+    }
+
+    void addStatement(const char *name, const QString &sql, const QString &expectedIndex, bool fullRead = false)
+    {
+        QTest::newRow(name) << sql << expectedIndex << fullRead;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        Database* db = Database::instance();
+        db->setDemoMode(true);
+        QVERIFY(db->initialize());
+
+        QSqlDatabase sqlDb = db->database();
+        QVERIFY(sqlDb.transaction());
+        QSqlQuery query(sqlDb);
+        for (int p = 1; p <= 20; ++p) {
+            QVERIFY(query.exec(QString("INSERT INTO projects (id, name) VALUES (%1, 'Project %1')").arg(p)));
+        }
+
+        query.prepare("INSERT INTO tasks (id, name, project_id, due_date) VALUES (:id, :name, :projectId, :dueDate)");
+        for (int t = 1; t <= 500; ++t) {
+            query.bindValue(":id", t);
+            query.bindValue(":name", QString("Task %1").arg(t));
+            query.bindValue(":projectId", 1 + t % 20);
+            query.bindValue(":dueDate", QDate(2024, 1, 1).addDays(t % 365).toString(Qt::ISODate));
+            QVERIFY(query.exec());
+        }
+
+        query.prepare("INSERT INTO subtasks (name, parent_task_id, is_completed) VALUES (:name, :taskId, :completed)");
+        for (int s = 1; s <= 1000; ++s) {
+            query.bindValue(":name", QString("Subtask %1").arg(s));
+            query.bindValue(":taskId", 1 + s % 500);
+            query.bindValue(":completed", s % 3 == 0);
+            QVERIFY(query.exec());
+        }
+
+        query.prepare("INSERT INTO time_entries (project_id, task_id, description, start_time, end_time, duration) "
+                      "VALUES (:projectId, :taskId, 'Work', :start, :end, 60)");
+        QDateTime start(QDate(2023, 1, 1), QTime(9, 0));
+        for (int e = 0; e < 5000; ++e) {
+            query.bindValue(":projectId", 1 + e % 20);
+            query.bindValue(":taskId", 1 + e % 500);
+            query.bindValue(":start", start.toString(Qt::ISODate));
+            query.bindValue(":end", start.addSecs(3600).toString(Qt::ISODate));
+            QVERIFY(query.exec());
+            start = start.addSecs(4 * 3600);
+        }
+
+        query.prepare("INSERT INTO office_presence (date, start_time, end_time, duration) VALUES (:date, :start, :end, 480)");
+        for (int d = 0; d < 2000; ++d) {
+            const QDate date = QDate(2020, 1, 1).addDays(d);
+            query.bindValue(":date", date.toString(Qt::ISODate));
+            query.bindValue(":start", QDateTime(date, QTime(9, 0)).toString(Qt::ISODate));
+            query.bindValue(":end", QDateTime(date, QTime(17, 0)).toString(Qt::ISODate));
+            QVERIFY(query.exec());
+        }
+        QVERIFY(sqlDb.commit());
+    }
+
+    void testMigrationIndexesExist_data()
+    {
+        QTest::addColumn<QString>("indexName");
+        const QStringList indexes = {
+            "idx_tasks_project_id", "idx_tasks_is_active", "idx_tasks_due_date",
+            "idx_subtasks_parent_task_id", "idx_subtasks_is_completed",
+            "idx_time_entries_task_start", "idx_time_entries_subtask_id",
+            "idx_time_entries_start_epoch", "idx_time_entries_project_start",
+            "idx_office_presence_date", "idx_daily_project_totals_project_day"
+        };
+        for (const QString &index : indexes) {
+            QTest::newRow(qPrintable(index)) << index;
+        }
+    }
+
+    void testMigrationIndexesExist()
+    {
+        QFETCH(QString, indexName);
+        QSqlQuery query(Database::instance()->database());
+        query.prepare("SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = :name");
+        query.bindValue(":name", indexName);
+        QVERIFY(query.exec());
+        QVERIFY2(query.next(), qPrintable(indexName + " is missing"));
+    }
+
+    void testQueryPlan_data()
+    {
+        QTest::addColumn<QString>("sql");
+        QTest::addColumn<QString>("expectedIndex");
+        QTest::addColumn<bool>("fullRead");
+
+        const QList<int> ids = { 1, 2, 3 };
+        const QVariantMap wholeDays = { { "start", "2024-01-01T00:00:00" }, { "end", "2024-01-31T23:59:59" } };
+        const QVariantMap hours = { { "start", "2024-01-01T08:00:00" }, { "end", "2024-01-31T17:00:00" } };
+        const QVariantMap byProject = { { "projectId", 1 } };
+        const QVariantMap byTask = { { "taskId", 1 } };
+        const QVariantMap searchInProject = { { "projectId", 1 }, { "description", "Work" } };
+        const QString cursor = "2024-01-01T09:00:00";
+        QVariantMap bindings;
+
+        // TimeEntryManager
+        addStatement("timeEntries.all", Statements::ALL_TIME_ENTRIES, "idx_time_entries_start_epoch", true);
+        addStatement("timeEntries.byProject", Statements::TIME_ENTRIES_BY_PROJECT, "idx_time_entries_project_start");
+        addStatement("timeEntries.byId", Statements::TIME_ENTRY_BY_ID, "PRIMARY KEY");
+        addStatement("timeEntries.update", Statements::UPDATE_TIME_ENTRY, "PRIMARY KEY");
+        addStatement("timeEntries.delete", Statements::DELETE_TIME_ENTRY, "PRIMARY KEY");
+        addStatement("timeEntries.byIds", Statements::timeEntriesByIds(ids, QVariantMap(), &bindings), "PRIMARY KEY");
+        addStatement("timeEntries.byIdsInProject", Statements::timeEntriesByIds(ids, byProject, &bindings), "PRIMARY KEY");
+        // Walks the index in order until LIMIT
+        addStatement("timeEntries.firstPage", Statements::timeEntriesPage(QVariantMap(), QString(), 0, 50, &bindings),
+                     "idx_time_entries_start_epoch", true);
+        addStatement("timeEntries.page", Statements::timeEntriesPage(QVariantMap(), cursor, 5, 50, &bindings),
+                     "idx_time_entries_start_epoch");
+        addStatement("timeEntries.pageByProject", Statements::timeEntriesPage(byProject, cursor, 5, 50, &bindings),
+                     "idx_time_entries_project_start");
+        addStatement("timeEntries.pageByTask", Statements::timeEntriesPage(byTask, cursor, 5, 50, &bindings),
+                     "idx_time_entries_task_start");
+        addStatement("timeEntries.pageByDateRange", Statements::timeEntriesPage(hours, QString(), 0, 50, &bindings),
+                     "idx_time_entries_start_epoch");
+        addStatement("timeEntries.summary", Statements::timeEntriesSummary(byProject, &bindings), "idx_time_entries_project_start");
+        addStatement("timeEntries.aggregateByProject", Statements::timeEntriesAggregate("project", hours, &bindings),
+                     "idx_time_entries_start_epoch");
+        addStatement("timeEntries.aggregateByTask", Statements::timeEntriesAggregate("task", searchInProject, &bindings),
+                     "idx_time_entries_project_start");
+        addStatement("timeEntries.aggregateByWeek", Statements::timeEntriesAggregate("week", hours, &bindings),
+                     "idx_time_entries_start_epoch");
+        addStatement("dailyTotals.byProject", Statements::timeEntriesAggregate("project", wholeDays, &bindings), "PRIMARY KEY");
+        addStatement("dailyTotals.byTask", Statements::timeEntriesAggregate("task", byProject, &bindings),
+                     "idx_daily_project_totals_project_day");
+        addStatement("dailyTotals.byWeek", Statements::timeEntriesAggregate("week", wholeDays, &bindings), "PRIMARY KEY");
+        addStatement("dailyTotals.selectedProjectsByDay",
+                     Statements::timeEntriesAggregate("day", { { "projectIds", QVariantList{ 1, 2, 3 } }, { "start", "2024-01-01T00:00:00" } }, &bindings),
+                     "idx_daily_project_totals_project_day");
+        addStatement("dailyTotals.allTime", Statements::timeEntriesAggregate("month", QVariantMap(), &bindings), QString(), true);
+        addStatement("projects.names", Statements::PROJECT_NAMES, QString(), true);
+        addStatement("timeEntries.parents", Statements::timeEntryParentsByIds(ids), "PRIMARY KEY");
+
+        // TimeEntryIntervalIndex
+        addStatement("timeEntries.spans", Statements::TIME_ENTRY_SPANS, QString(), true);
+        addStatement("timeEntries.changedSpans", Statements::timeEntrySpansByIds(ids), "PRIMARY KEY");
+
+        // ProjectManager and ProjectStatsCache
+        addStatement("projects.all", Statements::ALL_PROJECTS, QString(), true);
+        addStatement("projects.byId", Statements::PROJECT_BY_ID, "PRIMARY KEY");
+        addStatement("projects.update", Statements::UPDATE_PROJECT, "PRIMARY KEY");
+        addStatement("projects.delete", Statements::DELETE_PROJECT, "PRIMARY KEY");
+        addStatement("projects.allStats", Statements::ALL_PROJECT_STATS, "idx_daily_project_totals_project_day", true);
+        addStatement("projects.statsByIds", Statements::projectStatsByIds(ids), "idx_time_entries_project_start");
+
+        // TaskManager and TaskStatsCache
+        addStatement("tasks.all", Statements::ALL_TASKS, "idx_tasks_due_date", true);
+        addStatement("tasks.byProject", Statements::TASKS_BY_PROJECT, "idx_tasks_project_id");
+        addStatement("tasks.byId", Statements::TASK_BY_ID, "PRIMARY KEY");
+        addStatement("tasks.update", Statements::UPDATE_TASK, "PRIMARY KEY");
+        addStatement("tasks.delete", Statements::DELETE_TASK, "PRIMARY KEY");
+        addStatement("tasks.allStats", Statements::ALL_TASK_STATS, "idx_time_entries_task_start", true);
+        addStatement("tasks.statsByIds", Statements::taskStatsByIds(ids), "idx_time_entries_task_start");
+        addStatement("timeEntries.changedTasks", Statements::childParentsByIds("time_entries", "task_id", ids), "PRIMARY KEY");
+
+        // BleManager
+        addStatement("bleDevices.all", Statements::ALL_BLE_DEVICES, QString(), true);
+        addStatement("bleDevices.idByMac", Statements::BLE_DEVICE_ID_BY_MAC, "sqlite_autoindex_ble_devices_1");
+        addStatement("bleDevices.updateMac", Statements::UPDATE_BLE_DEVICE_MAC, "PRIMARY KEY");
+        addStatement("bleDevices.delete", Statements::DELETE_BLE_DEVICE, "PRIMARY KEY");
+
+        // PresenceMonitor and the v13 migration
+        addStatement("presence.byDate", Statements::PRESENCE_BY_DATE, "idx_office_presence_date");
+        addStatement("presence.totalByDate", Statements::PRESENCE_TOTAL_BY_DATE, "idx_office_presence_date");
+        addStatement("presence.updateSession", Statements::UPDATE_PRESENCE_SESSION, "PRIMARY KEY");
+        addStatement("presence.compact", Statements::COMPACT_PRESENCE_SESSIONS, "idx_office_presence_date", true);
+    }
+
+    void testQueryPlan()
+    {
+        QFETCH(QString, sql);
+        QFETCH(QString, expectedIndex);
+        QFETCH(bool, fullRead);
+
+        const QStringList plan = queryPlan(sql);
+        QVERIFY2(!plan.isEmpty(), qPrintable("No query plan for: " + sql));
+
+        static const QRegularExpression scanPattern("^SCAN (?:TABLE )?(\\w+)(.*)$");
+        for (const QString &detail : plan) {
+            const QRegularExpressionMatch match = scanPattern.match(detail);
+            if (!match.hasMatch() || fullRead) {
+                continue;
+            }
+            const bool usesIndex = match.captured(2).contains("INDEX");
+            QVERIFY2(usesIndex || !largeTables().contains(match.captured(1)),
+                     qPrintable("Full table scan: " + detail + "\n" + sql));
+        }
+
+        if (expectedIndex.isEmpty()) {
+            return;
+        }
+        // A statement that is not a full read must seek into the expected
+        // index; a full read may walk it in order
+        const QString access = expectedIndex == "PRIMARY KEY"
+            ? QString("(?:INTEGER )?PRIMARY KEY\\b")
+            : "(?:COVERING )?INDEX " + QRegularExpression::escape(expectedIndex) + "\\b";
+        const QRegularExpression usesExpected(QString("^%1 (?:TABLE )?\\w+(?: AS \\w+)? USING %2")
+                                                  .arg(fullRead ? "(?:SEARCH|SCAN)" : "SEARCH", access));
+        bool found = false;
+        for (const QString &detail : plan) {
+            found = found || usesExpected.match(detail).hasMatch();
+        }
+        QVERIFY2(found, qPrintable(QString("Expected %1 on %2 in plan:\n%3")
+                                       .arg(fullRead ? "a walk or search" : "a search", expectedIndex, plan.join('\n'))));
+    }
+};
+
+QTEST_MAIN(TestQueryPlans)
+#include "test_queryplans.moc"
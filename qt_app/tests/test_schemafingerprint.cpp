@@ -0,0 +1,139 @@
+#include <QtTest/QtTest>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include "../include/database/database.h"
+
+// Each test starts the database on a file several times, as separate
+// application runs would, and edits the file in between on a connection
+// of its own
+class TestSchemaFingerprint : public QObject
+{
+    Q_OBJECT
+
+private:
+    // One application start: a fresh Database opens path and goes away.
+    // Returns the schema version it reported, 0 on failure.
+    static int startDatabase(const QString &path)
+    {
+        Database *db = new Database();
+        const int version = db->initialize(path) ? db->currentVersion() : 0;
+        delete db;
+        QSqlDatabase::removeDatabase(QSqlDatabase::defaultConnection);
+        return version;
+    }
+
+    static bool execAll(const QString &path, const QStringList &statements)
+    {
+        bool ok = true;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "fingerprint_edit");
+            db.setDatabaseName(path);
+            ok = db.open();
+            QSqlQuery query(db);
+            for (const QString &statement : statements) {
+                if (ok && !query.exec(statement)) {
+                    qWarning() << statement << query.lastError().text();
+                    ok = false;
+                }
+            }
+        }
+        QSqlDatabase::removeDatabase("fingerprint_edit");
+        return ok;
+    }
+
+    static QVariant readValue(const QString &path, const QString &sql)
+    {
+        QVariant value;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "fingerprint_read");
+            db.setDatabaseName(path);
+            QSqlQuery query(db);
+            if (db.open() && query.exec(sql) && query.next()) {
+                value = query.value(0);
+            }
+        }
+        QSqlDatabase::removeDatabase("fingerprint_read");
+        return value;
+    }
+
+    // The migration check rewrites db_version when it runs, so a version
+    // set back here shows whether the start took the full path
+    QString setPreviousVersion() const
+    {
+        return QString("UPDATE db_version SET version = %1").arg(m_version - 1);
+    }
+
+    int m_version = 0;
+
+private slots:
+    void initTestCase()
+    {
+        QTemporaryDir dir;
+        m_version = startDatabase(dir.filePath("current.db"));
+        QVERIFY(m_version > 1);
+    }
+
+    void testMatchingFingerprintSkipsSchemaWork()
+    {
+        QTemporaryDir dir;
+        const QString path = dir.filePath("fingerprint.db");
+        QCOMPARE(startDatabase(path), m_version);
+        QCOMPARE(readValue(path, "SELECT COUNT(*) FROM schema_fingerprint").toInt(), 1);
+
+        QVERIFY(execAll(path, { setPreviousVersion() }));
+        QCOMPARE(startDatabase(path), m_version);
+        QCOMPARE(readValue(path, "SELECT version FROM db_version").toInt(), m_version - 1);
+    }
+
+    void testMovedCookieComparesTheSchema()
+    {
+        QTemporaryDir dir;
+        const QString path = dir.filePath("fingerprint.db");
+        QCOMPARE(startDatabase(path), m_version);
+
+        // The cookie moves but the schema ends up as it was
+        QVERIFY(execAll(path, { "CREATE TABLE scratch (x INTEGER)", "DROP TABLE scratch", setPreviousVersion() }));
+        const qint64 cookie = readValue(path, "PRAGMA schema_version").toLongLong();
+        QVERIFY(readValue(path, "SELECT schema_cookie FROM schema_fingerprint").toLongLong() != cookie);
+
+        QCOMPARE(startDatabase(path), m_version);
+        QCOMPARE(readValue(path, "SELECT version FROM db_version").toInt(), m_version - 1);
+        QCOMPARE(readValue(path, "SELECT schema_cookie FROM schema_fingerprint").toLongLong(), cookie);
+    }
+
+    void testSchemaChangeTakesTheFullPath()
+    {
+        QTemporaryDir dir;
+        const QString path = dir.filePath("fingerprint.db");
+        QCOMPARE(startDatabase(path), m_version);
+
+        QVERIFY(execAll(path, { "CREATE TABLE scratch (x INTEGER)", setPreviousVersion() }));
+        QCOMPARE(startDatabase(path), m_version);
+        QCOMPARE(readValue(path, "SELECT version FROM db_version").toInt(), m_version);
+        QCOMPARE(readValue(path, "SELECT schema_cookie FROM schema_fingerprint").toLongLong(),
+                 readValue(path, "PRAGMA schema_version").toLongLong());
+    }
+
+    void testMissingFingerprintTableIsRecreated()
+    {
+        QTemporaryDir dir;
+        const QString path = dir.filePath("fingerprint.db");
+        QCOMPARE(startDatabase(path), m_version);
+
+        QVERIFY(execAll(path, { "DROP TABLE schema_fingerprint", setPreviousVersion() }));
+        QCOMPARE(startDatabase(path), m_version);
+        QCOMPARE(readValue(path, "SELECT version FROM db_version").toInt(), m_version);
+        QCOMPARE(readValue(path, "SELECT db_version FROM schema_fingerprint").toInt(), m_version);
+        QCOMPARE(readValue(path, "SELECT schema_cookie FROM schema_fingerprint").toLongLong(),
+                 readValue(path, "PRAGMA schema_version").toLongLong());
+
+        // The recreated fingerprint makes the next start skip the schema work
+        QVERIFY(execAll(path, { setPreviousVersion() }));
+        QCOMPARE(startDatabase(path), m_version);
+        QCOMPARE(readValue(path, "SELECT version FROM db_version").toInt(), m_version - 1);
+    }
+};
+
+QTEST_MAIN(TestSchemaFingerprint)
+#include "test_schemafingerprint.moc"
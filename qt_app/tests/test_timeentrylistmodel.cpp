@@ -0,0 +1,111 @@
+#include <QtTest/QtTest>
+#include <QSqlQuery>
+#include "../include/managers/timeentrylistmodel.h"
+#include "../include/managers/timeentrymanager.h"
+#include "../include/database/database.h"
+
+class TestTimeEntryListModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        Database* db = Database::instance();
+        db->setDemoMode(true);
+        QVERIFY(db->initialize());
+        
+        QSqlDatabase sqlDb = db->database();
+        QSqlQuery query(sqlDb);
+        QVERIFY(query.exec("INSERT INTO projects (id, name) VALUES (1, 'Model Project')"));
+        
+        QVERIFY(sqlDb.transaction());
+        query.prepare("INSERT INTO time_entries (project_id, description, start_time, end_time, duration) "
+                      "VALUES (1, 'Seeded', :start, :end, 30)");
+        QDateTime start(QDate(2023, 1, 1), QTime(9, 0));
+        for (int i = 0; i < 450; ++i) {
+            query.bindValue(":start", start.toString(Qt::ISODate));
+            query.bindValue(":end", start.addSecs(1800).toString(Qt::ISODate));
+            QVERIFY(query.exec());
+            start = start.addSecs(3600);
+        }
+        QVERIFY(sqlDb.commit());
+        // Let the seeding batch reach the change bus before the models exist
+        QTest::qWait(50);
+    }
+
+    void testFetchesOnePageAtATime()
+    {
+        TimeEntryListModel model;
+        QCOMPARE(model.rowCount(), 0);
+        QCOMPARE(model.totalCount(), 450);
+        QCOMPARE(model.totalMinutes(), qint64(450 * 30));
+        
+        QVERIFY(model.canFetchMore(QModelIndex()));
+        model.fetchMore(QModelIndex());
+        QCOMPARE(model.rowCount(), TimeEntryListModel::PAGE_SIZE);
+        model.fetchMore(QModelIndex());
+        model.fetchMore(QModelIndex());
+        QCOMPARE(model.rowCount(), 450);
+        QVERIFY(!model.canFetchMore(QModelIndex()));
+        
+        // Newest first, no row loaded twice
+        QSet<int> ids;
+        for (int row = 0; row < model.rowCount(); ++row) {
+            ids.insert(model.get(row).value("id").toInt());
+            if (row > 0) {
+                QVERIFY(model.get(row).value("startEpoch").toLongLong() <= model.get(row - 1).value("startEpoch").toLongLong());
+            }
+        }
+        QCOMPARE(ids.size(), 450);
+    }
+
+    void testFilterIsAppliedInSql()
+    {
+        TimeEntryListModel model;
+        model.setFilter({{ "start", "2023-01-02T00:00:00" }, { "end", "2023-01-02T23:59:59" }});
+        QCOMPARE(model.totalCount(), 24);
+        model.fetchMore(QModelIndex());
+        QCOMPARE(model.rowCount(), 24);
+    }
+
+    void testWritesPatchRowsInPlace()
+    {
+        TimeEntryListModel model;
+        model.fetchMore(QModelIndex());
+        TimeEntryManager manager;
+        
+        QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+        QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+        QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+        QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+        
+        QVariantMap entryData;
+        entryData["projectId"] = 1;
+        entryData["description"] = "Newest";
+        entryData["startTime"] = "2024-06-01T09:00:00";
+        entryData["endTime"] = "2024-06-01T10:00:00";
+        entryData["duration"] = 60;
+        QVERIFY(manager.createTimeEntry(entryData));
+        QVERIFY(inserted.wait(1000));
+        QCOMPARE(model.get(0).value("description").toString(), QString("Newest"));
+        const int id = model.get(0).value("id").toInt();
+        QCOMPARE(model.totalCount(), 451);
+        
+        entryData["description"] = "Renamed";
+        QVERIFY(manager.updateTimeEntry(id, entryData));
+        QVERIFY(changed.wait(1000));
+        QCOMPARE(model.get(0).value("description").toString(), QString("Renamed"));
+        
+        QVERIFY(manager.deleteTimeEntry(id));
+        QVERIFY(removed.wait(1000));
+        QVERIFY(model.get(0).value("id").toInt() != id);
+        QCOMPARE(model.rowCount(), TimeEntryListModel::PAGE_SIZE);
+        QCOMPARE(model.totalCount(), 450);
+        
+        QCOMPARE(reset.count(), 0);
+    }
+};
+
+QTEST_MAIN(TestTimeEntryListModel)
+#include "test_timeentrylistmodel.moc"
@@ -1,7 +1,15 @@
 #include <QtTest/QtTest>
 #include "../include/managers/timeentrymanager.h"
+#include "../include/managers/taskmanager.h"
+#include "../include/managers/projectmanager.h"
+#include "../include/managers/timeentrylistmodel.h"
+#include "../include/managers/timeentryintervalindex.h"
 #include "../include/database/database.h"
+#include "../include/database/writequeue.h"
+#include "../include/database/changebus.h"
 #include <QSqlQuery>
+#include <QTemporaryDir>
+#include <limits>
 
 class TestTimeEntryManager : public QObject
 {
@@ -46,6 +54,433 @@ private slots:
         
         manager.stopTimer();
     }
+
+    void testDateRangeUsesEpochColumns()
+    {
+        TimeEntryManager manager;
+        QVariantMap entryData;
+        entryData["projectId"] = 1;
+        entryData["description"] = "Range entry";
+        entryData["startTime"] = "2023-03-15T09:00:00";
+        entryData["endTime"] = "2023-03-15T11:00:00";
+        entryData["duration"] = 120;
+        QVERIFY(manager.createTimeEntry(entryData));
+        
+        QVariantList inRange = manager.getTimeEntriesByDateRange(
+            QDateTime(QDate(2023, 3, 15), QTime(0, 0)), QDateTime(QDate(2023, 3, 15), QTime(23, 59, 59)));
+        QCOMPARE(inRange.size(), 1);
+        QCOMPARE(inRange.first().toMap().value("description").toString(), QString("Range entry"));
+        QVERIFY(inRange.first().toMap().value("startEpoch").toLongLong() > 0);
+        
+        QVariantList outOfRange = manager.getTimeEntriesByDateRange(
+            QDateTime(QDate(2023, 3, 16), QTime(0, 0)), QDateTime(QDate(2023, 3, 16), QTime(23, 59, 59)));
+        QCOMPARE(outOfRange.size(), 0);
+    }
+
+    void testQueuedWritesCommitAsOneBatch()
+    {
+        TimeEntryManager manager;
+        QSignalSpy created(&manager, &TimeEntryManager::timeEntryCreated);
+        QSignalSpy changed(&manager, &TimeEntryManager::timeEntriesChanged);
+        QSignalSpy errors(&manager, &TimeEntryManager::error);
+        QSignalSpy flushed(Database::instance()->writeQueue(), &WriteQueue::flushed);
+        
+        QVariantMap entryData;
+        entryData["projectId"] = 1;
+        entryData["description"] = "Batched entry";
+        entryData["duration"] = 30;
+        for (int i = 0; i < 3; ++i) {
+            entryData["startTime"] = QString("2023-04-0%1T09:00:00").arg(i + 1);
+            entryData["endTime"] = QString("2023-04-0%1T09:30:00").arg(i + 1);
+            QVERIFY(manager.createTimeEntry(entryData));
+        }
+        // start_time is NOT NULL: this write fails on its own
+        entryData.remove("startTime");
+        QVERIFY(manager.createTimeEntry(entryData));
+        QCOMPARE(created.count(), 0);
+        
+        QVERIFY(flushed.wait(1000));
+        QCOMPARE(flushed.count(), 1);
+        QCOMPARE(flushed.first().at(0).toInt(), 4);
+        QCOMPARE(created.count(), 3);
+        QVERIFY(created.first().at(0).toInt() > 0);
+        QCOMPARE(errors.count(), 1);
+        QCOMPARE(changed.count(), 1);
+        
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries WHERE description = 'Batched entry'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 3);
+    }
+
+    void testBulkWritesApplyTogether()
+    {
+        TimeEntryManager manager;
+        QSignalSpy created(&manager, &TimeEntryManager::timeEntriesCreated);
+        QSignalSpy updated(&manager, &TimeEntryManager::timeEntriesUpdated);
+        QSignalSpy deleted(&manager, &TimeEntryManager::timeEntriesDeleted);
+        QSignalSpy singleCreated(&manager, &TimeEntryManager::timeEntryCreated);
+        QSignalSpy changed(&manager, &TimeEntryManager::timeEntriesChanged);
+        QSignalSpy errors(&manager, &TimeEntryManager::error);
+        
+        QVariantList entries;
+        for (int i = 0; i < 3; ++i) {
+            QVariantMap entryData;
+            entryData["projectId"] = 1;
+            entryData["description"] = "Bulk entry";
+            entryData["startTime"] = QString("2023-08-0%1T09:00:00").arg(i + 1);
+            entryData["endTime"] = QString("2023-08-0%1T10:00:00").arg(i + 1);
+            entryData["duration"] = 60;
+            entries.append(entryData);
+        }
+        QVERIFY(manager.createTimeEntries(entries));
+        Database::instance()->flushPendingWrites();
+        QCOMPARE(created.count(), 1);
+        QCOMPARE(singleCreated.count(), 0);
+        QCOMPARE(changed.count(), 1);
+        const QList<int> ids = created.first().at(0).value<QList<int>>();
+        QCOMPARE(ids.size(), 3);
+        
+        // Overlap checks apply to every entry of a batch
+        QVariantMap clash = entries.first().toMap();
+        clash["id"] = ids.first();
+        clash["startTime"] = "2023-08-02T09:30:00";
+        clash["endTime"] = "2023-08-02T09:45:00";
+        clash["rejectOverlap"] = true;
+        QVERIFY(!manager.updateTimeEntries({ clash }));
+        clash.remove("id");
+        QVERIFY(!manager.createTimeEntries({ clash }));
+        QCOMPARE(errors.count(), 2);
+        
+        // One bad row rolls back the whole call
+        QVariantList edits;
+        for (int i = 0; i < ids.size(); ++i) {
+            QVariantMap entryData = entries.at(i).toMap();
+            entryData["id"] = ids.at(i);
+            entryData["description"] = "Bulk edit";
+            edits.append(entryData);
+        }
+        QVariantMap broken = edits.last().toMap();
+        broken.remove("startTime");
+        edits.last() = broken;
+        QVERIFY(manager.updateTimeEntries(edits));
+        Database::instance()->flushPendingWrites();
+        QCOMPARE(updated.count(), 0);
+        QCOMPARE(errors.count(), 3);
+        
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries WHERE description = 'Bulk edit'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 0);
+        
+        QVERIFY(manager.deleteTimeEntries(ids));
+        Database::instance()->flushPendingWrites();
+        QCOMPARE(deleted.count(), 1);
+        QCOMPARE(deleted.first().at(0).value<QList<int>>(), ids);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM time_entries WHERE description = 'Bulk entry'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 0);
+    }
+
+    void testKeysetPagination()
+    {
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("INSERT INTO projects (id, name) VALUES (2, 'Paged Project')"));
+        
+        TimeEntryManager manager;
+        QVariantMap entryData;
+        entryData["projectId"] = 2;
+        entryData["duration"] = 60;
+        // Two entries share a start time so the id tie-breaker is exercised
+        const QStringList starts = { "2023-05-01T09:00:00", "2023-05-02T09:00:00", "2023-05-02T09:00:00",
+                                     "2023-05-03T09:00:00", "2023-05-04T09:00:00" };
+        for (const QString &start : starts) {
+            entryData["startTime"] = start;
+            entryData["endTime"] = start.left(11) + "10:00:00";
+            QVERIFY(manager.createTimeEntry(entryData));
+        }
+        
+        const QVariantMap filter = {{ "projectId", 2 }};
+        QList<int> seen;
+        QString afterStart;
+        int afterId = 0;
+        qint64 previousEpoch = std::numeric_limits<qint64>::max();
+        for (int page = 0; page < 5; ++page) {
+            const QVariantList entries = manager.getTimeEntriesPage(filter, afterStart, afterId, 2);
+            if (entries.isEmpty()) {
+                break;
+            }
+            QVERIFY(entries.size() <= 2);
+            for (const QVariant &value : entries) {
+                const QVariantMap entry = value.toMap();
+                QVERIFY(!seen.contains(entry.value("id").toInt()));
+                QVERIFY(entry.value("startEpoch").toLongLong() <= previousEpoch);
+                previousEpoch = entry.value("startEpoch").toLongLong();
+                seen << entry.value("id").toInt();
+            }
+            afterStart = entries.last().toMap().value("startTime").toString();
+            afterId = entries.last().toMap().value("id").toInt();
+        }
+        QCOMPARE(seen.size(), starts.size());
+    }
+
+    void testOverlapQueries()
+    {
+        TimeEntryManager manager;
+        QSignalSpy created(&manager, &TimeEntryManager::timeEntryCreated);
+        QVariantMap entryData;
+        entryData["projectId"] = 1;
+        entryData["description"] = "Overlap entry";
+        entryData["startTime"] = "2023-07-01T23:00:00";
+        entryData["endTime"] = "2023-07-02T01:00:00";
+        entryData["duration"] = 120;
+        QVERIFY(manager.createTimeEntry(entryData));
+        entryData["startTime"] = "2023-07-02T09:00:00";
+        entryData["endTime"] = "2023-07-02T10:00:00";
+        entryData["duration"] = 60;
+        QVERIFY(manager.createTimeEntry(entryData));
+        
+        // The entry crossing midnight belongs to both days
+        const QVariantList day = manager.getTimeEntriesByDateRange(
+            QDateTime(QDate(2023, 7, 2), QTime(0, 0)), QDateTime(QDate(2023, 7, 2), QTime(23, 59, 59)));
+        QCOMPARE(day.size(), 2);
+        QCOMPARE(day.first().toMap().value("startTime").toString(), QString("2023-07-02T09:00:00"));
+        QCOMPARE(created.count(), 2);
+        const int morningId = created.last().at(0).toInt();
+        
+        QVERIFY(manager.hasOverlap("2023-07-02T09:30:00", "2023-07-02T09:45:00"));
+        QVERIFY(!manager.hasOverlap("2023-07-02T10:00:00", "2023-07-02T11:00:00"));
+        QVERIFY(!manager.hasOverlap("2023-07-02T09:30:00", "2023-07-02T09:45:00", morningId));
+        
+        entryData["startTime"] = "2023-07-02T09:30:00";
+        entryData["endTime"] = "2023-07-02T10:30:00";
+        entryData["rejectOverlap"] = true;
+        QVERIFY(!manager.createTimeEntry(entryData));
+        
+        // Moving an entry is picked up without reloading the index
+        entryData["startTime"] = "2023-07-02T14:00:00";
+        entryData["endTime"] = "2023-07-02T15:00:00";
+        QVERIFY(manager.updateTimeEntry(morningId, entryData));
+        QVERIFY(!manager.hasOverlap("2023-07-02T09:30:00", "2023-07-02T09:45:00"));
+        QVERIFY(manager.hasOverlap("2023-07-02T14:30:00", "2023-07-02T14:45:00"));
+    }
+
+    void testAggregateGroupsInSql()
+    {
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("INSERT INTO projects (id, name) VALUES (3, 'Aggregate Project')"));
+        
+        TimeEntryManager manager;
+        const QList<QPair<int, QString>> entries = {
+            { 3, "2023-06-05T09:00:00" }, { 3, "2023-06-06T09:00:00" },
+            { 3, "2023-06-12T09:00:00" }, { 1, "2023-06-07T09:00:00" }
+        };
+        const QList<int> durations = { 60, 90, 30, 45 };
+        for (int i = 0; i < entries.size(); ++i) {
+            QVariantMap entryData;
+            entryData["projectId"] = entries.at(i).first;
+            entryData["startTime"] = entries.at(i).second;
+            entryData["endTime"] = entries.at(i).second.left(11) + "12:00:00";
+            entryData["duration"] = durations.at(i);
+            QVERIFY(manager.createTimeEntry(entryData));
+        }
+        
+        const QVariantMap june = {{ "start", "2023-06-01T00:00:00" }, { "end", "2023-06-30T23:59:59" }};
+        const QVariantList byProject = manager.aggregate("project", june);
+        QCOMPARE(byProject.size(), 2);
+        QCOMPARE(byProject.first().toMap().value("key").toInt(), 3);
+        QCOMPARE(byProject.first().toMap().value("label").toString(), QString("Aggregate Project"));
+        QCOMPARE(byProject.first().toMap().value("minutes").toLongLong(), 180);
+        QCOMPARE(byProject.first().toMap().value("entryCount").toInt(), 3);
+        
+        QVariantMap onlyProject = june;
+        onlyProject["projectIds"] = QVariantList{ 3 };
+        QCOMPARE(manager.aggregate("day", onlyProject).size(), 3);
+        
+        const QVariantList byWeek = manager.aggregate("week", onlyProject);
+        QCOMPARE(byWeek.size(), 2);
+        QCOMPARE(byWeek.first().toMap().value("key").toString(), QString("2023-06-05"));
+        QCOMPARE(byWeek.first().toMap().value("label").toString(), QString("2023-W23"));
+        QCOMPARE(byWeek.first().toMap().value("minutes").toLongLong(), 150);
+        
+        const QVariantList byMonth = manager.aggregate("month", onlyProject);
+        QCOMPARE(byMonth.size(), 1);
+        QCOMPARE(byMonth.first().toMap().value("key").toString(), QString("2023-06"));
+        QCOMPARE(byMonth.first().toMap().value("minutes").toLongLong(), 180);
+        
+        QSignalSpy errors(&manager, &TimeEntryManager::error);
+        QVERIFY(manager.aggregate("year").isEmpty());
+        QCOMPARE(errors.count(), 1);
+    }
+
+    void testAggregatePathsAttributeToStartDay()
+    {
+        TimeEntryManager manager;
+        QVariantMap lateEntry;
+        lateEntry["projectId"] = 1;
+        lateEntry["startTime"] = "2023-11-30T22:00:00";
+        lateEntry["endTime"] = "2023-12-01T01:00:00";
+        lateEntry["duration"] = 180;
+        QVERIFY(manager.createTimeEntry(lateEntry));
+
+        // Whole days read the rollup; an hour bound reads time_entries
+        const QVariantMap wholeDays = {{ "start", "2023-11-01T00:00:00" }, { "end", "2023-11-30T23:59:59" }};
+        const QVariantMap fromNine = {{ "start", "2023-11-01T09:00:00" }, { "end", "2023-11-30T23:59:59" }};
+        for (const QVariantMap &filter : { wholeDays, fromNine }) {
+            const QVariantList byDay = manager.aggregate("day", filter);
+            QCOMPARE(byDay.size(), 1);
+            QCOMPARE(byDay.first().toMap().value("key").toString(), QString("2023-11-30"));
+            QCOMPARE(byDay.first().toMap().value("minutes").toLongLong(), 180);
+            QCOMPARE(byDay.first().toMap().value("entryCount").toInt(), 1);
+        }
+
+        const QVariantMap december = {{ "start", "2023-12-01T00:00:00" }, { "end", "2023-12-31T23:59:59" }};
+        QVERIFY(manager.aggregate("day", december).isEmpty());
+    }
+    
+    void testCalendarSummarySplitsAtMidnight()
+    {
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("INSERT INTO projects (id, name) VALUES (4, 'Calendar Project')"));
+        
+        TimeEntryManager manager;
+        QVariantMap overnight;
+        overnight["projectId"] = 4;
+        overnight["startTime"] = "2023-09-01T22:00:00";
+        overnight["endTime"] = "2023-09-02T02:00:00";
+        overnight["duration"] = 240;
+        QVERIFY(manager.createTimeEntry(overnight));
+        
+        QVariantMap morning;
+        morning["projectId"] = 1;
+        morning["startTime"] = "2023-09-02T09:00:00";
+        morning["endTime"] = "2023-09-02T09:30:00";
+        morning["duration"] = 30;
+        QVERIFY(manager.createTimeEntry(morning));
+        
+        const QVariantList days = manager.getCalendarSummary(QDate(2023, 9, 1), QDate(2023, 9, 3));
+        QCOMPARE(days.size(), 3);
+        QCOMPARE(days.at(0).toMap().value("minutes").toInt(), 120);
+        QCOMPARE(days.at(0).toMap().value("entryCount").toInt(), 1);
+        const QVariantMap secondDay = days.at(1).toMap();
+        QCOMPARE(secondDay.value("date").toString(), QString("2023-09-02"));
+        QCOMPARE(secondDay.value("minutes").toInt(), 150);
+        QCOMPARE(secondDay.value("entryCount").toInt(), 2);
+        const QVariantList top = secondDay.value("topProjects").toList();
+        QCOMPARE(top.size(), 2);
+        QCOMPARE(top.first().toMap().value("name").toString(), QString("Calendar Project"));
+        QCOMPARE(top.first().toMap().value("minutes").toInt(), 120);
+        QCOMPARE(days.at(2).toMap().value("entryCount").toInt(), 0);
+        
+        const QVariantList weeks = manager.getCalendarSummary(QDate(2023, 8, 27), QDate(2023, 9, 9), "week");
+        QCOMPARE(weeks.size(), 2);
+        QCOMPARE(weeks.first().toMap().value("minutes").toInt(), 270);
+        QCOMPARE(weeks.first().toMap().value("entryCount").toInt(), 2);
+        
+        // A year of days is cut off at the bucket limit
+        QCOMPARE(manager.getCalendarSummary(QDate(2023, 1, 1), QDate(2023, 12, 31)).size(), 42);
+        
+        // A cached summary does not outlive a change to the entries
+        morning["startTime"] = "2023-09-03T09:00:00";
+        morning["endTime"] = "2023-09-03T09:30:00";
+        QVERIFY(manager.createTimeEntry(morning));
+        QCOMPARE(manager.getCalendarSummary(QDate(2023, 9, 1), QDate(2023, 9, 3)).at(2).toMap().value("entryCount").toInt(), 1);
+    }
+    
+    void testTaskStatsFollowEntries()
+    {
+        QSqlQuery query(Database::instance()->database());
+        QVERIFY(query.exec("INSERT INTO tasks (id, name, project_id, allocated_time, due_date) VALUES (101, 'Planned', 1, 120, '2000-01-01')"));
+        QVERIFY(query.exec("INSERT INTO tasks (id, name, project_id, allocated_time) VALUES (102, 'Unplanned', 1, 0)"));
+        QVERIFY(query.exec("INSERT INTO subtasks (name, parent_task_id, is_completed) VALUES ('a', 101, 1), ('b', 101, 0)"));
+        
+        TaskManager tasks;
+        TimeEntryManager manager;
+        QVariantMap entryData;
+        entryData["projectId"] = 1;
+        entryData["taskId"] = 101;
+        entryData["startTime"] = "2023-10-02T09:00:00";
+        entryData["endTime"] = "2023-10-02T10:30:00";
+        entryData["duration"] = 90;
+        QVERIFY(manager.createTimeEntry(entryData));
+        
+        QVariantMap stats = tasks.getTaskStats(101);
+        QCOMPARE(stats.value("spentMinutes").toLongLong(), 90);
+        QCOMPARE(stats.value("allocatedMinutes").toInt(), 120);
+        QCOMPARE(stats.value("percentUsed").toDouble(), 75.0);
+        QCOMPARE(stats.value("subtaskTotal").toInt(), 2);
+        QCOMPARE(stats.value("subtaskDone").toInt(), 1);
+        QVERIFY(stats.value("overdue").toBool());
+
+        // A subtask change arrives as the counter trigger's update of the task
+        if (Database::instance()->changeBus()->isHooked()) {
+            QVERIFY(query.exec("UPDATE subtasks SET is_completed = 1 WHERE parent_task_id = 101"));
+            QCOMPARE(tasks.getTaskStats(101).value("subtaskDone").toInt(), 2);
+        }
+
+        QVariantMap onlyProject;
+        onlyProject["projectId"] = 1;
+        QCOMPARE(tasks.getAllTaskStats(onlyProject).size(), tasks.getTasksByProject(1).size());
+        
+        // Moving the entry to another task recomputes both
+        const int entryId = manager.getTimeEntriesByDateRange(
+            QDateTime(QDate(2023, 10, 2), QTime(0, 0)), QDateTime(QDate(2023, 10, 2), QTime(23, 59, 59))).first().toMap().value("id").toInt();
+        entryData["taskId"] = 102;
+        QVERIFY(manager.updateTimeEntry(entryId, entryData));
+        QCOMPARE(tasks.getTaskStats(101).value("spentMinutes").toLongLong(), 0);
+        QCOMPARE(tasks.getTaskStats(102).value("spentMinutes").toLongLong(), 90);
+        QVERIFY(!tasks.getTaskStats(102).value("overdue").toBool());
+        QVERIFY(tasks.getTaskStats(999).isEmpty());
+        
+        // A deleted entry no longer names its task; the write reports it
+        QVERIFY(manager.deleteTimeEntry(entryId));
+        QCOMPARE(tasks.getTaskStats(102).value("spentMinutes").toLongLong(), 0);
+    }
+    
+    void testRestoreReachesEveryCache()
+    {
+        Database* db = Database::instance();
+        QSqlQuery query(db->database());
+        QVERIFY(query.exec("INSERT INTO projects (id, name) VALUES (6, 'Restore Project')"));
+        QVERIFY(query.exec("INSERT INTO tasks (id, name, project_id, allocated_time) VALUES (601, 'Restore Task', 6, 60)"));
+        
+        TimeEntryManager manager;
+        TaskManager tasks;
+        ProjectManager projects;
+        TimeEntryListModel list;
+        list.setFilter({{ "projectId", 6 }});
+        
+        QVariantMap entryData;
+        entryData["projectId"] = 6;
+        entryData["taskId"] = 601;
+        entryData["startTime"] = "2023-11-06T09:00:00";
+        entryData["endTime"] = "2023-11-06T10:00:00";
+        entryData["duration"] = 60;
+        QVERIFY(manager.createTimeEntry(entryData));
+        
+        QTemporaryDir dir;
+        const QString path = dir.filePath("caches.json");
+        QVERIFY(db->backupToJson(path));
+        
+        // An entry the restore takes away again, read through every cache
+        entryData["startTime"] = "2023-11-07T09:00:00";
+        entryData["endTime"] = "2023-11-07T10:00:00";
+        QVERIFY(manager.createTimeEntry(entryData));
+        const qint64 start = TimeEntryIntervalIndex::toEpoch("2023-11-07T09:00:00");
+        const qint64 end = TimeEntryIntervalIndex::toEpoch("2023-11-07T10:00:00");
+        QCOMPARE(TimeEntryIntervalIndex::instance()->overlapping(start, end).size(), 1);
+        QTRY_COMPARE(list.totalCount(), 2);
+        QCOMPARE(tasks.getTaskStats(601).value("spentMinutes").toLongLong(), 120);
+        QCOMPARE(projects.getProjectStats(6).value("totalMinutes").toLongLong(), 120);
+        QCOMPARE(manager.getCalendarSummary(QDate(2023, 11, 7), QDate(2023, 11, 7)).first().toMap().value("entryCount").toInt(), 1);
+        
+        QVERIFY(db->restoreFromJson(path));
+        QVERIFY(TimeEntryIntervalIndex::instance()->overlapping(start, end).isEmpty());
+        QCOMPARE(tasks.getTaskStats(601).value("spentMinutes").toLongLong(), 60);
+        QCOMPARE(projects.getProjectStats(6).value("totalMinutes").toLongLong(), 60);
+        QCOMPARE(manager.getCalendarSummary(QDate(2023, 11, 7), QDate(2023, 11, 7)).first().toMap().value("entryCount").toInt(), 0);
+        QTRY_COMPARE(list.totalCount(), 1);
+    }
 };
 
 QTEST_MAIN(TestTimeEntryManager)
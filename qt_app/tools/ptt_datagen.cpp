@@ -0,0 +1,51 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDebug>
+#include "database/database.h"
+#include "utils/datagenerator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Fills a Project Time Tracker database with synthetic data.");
+    parser.addHelpOption();
+    QCommandLineOption entriesOption("entries", "Number of time entries to generate.", "count", "100000");
+    QCommandLineOption seedOption("seed", "Random seed.", "seed", QString::number(DataGenerator::DEFAULT_SEED));
+    QCommandLineOption untilOption("until", "Last day of the generated history (YYYY-MM-DD).", "date",
+                                   DataGenerator::DEFAULT_LAST_DAY.toString(Qt::ISODate));
+    parser.addOption(entriesOption);
+    parser.addOption(seedOption);
+    parser.addOption(untilOption);
+    parser.addPositionalArgument("database", "Database file to create or extend.");
+    parser.process(app);
+
+    const QStringList positional = parser.positionalArguments();
+    const QDate lastDay = QDate::fromString(parser.value(untilOption), Qt::ISODate);
+    if (positional.size() != 1 || !lastDay.isValid()) {
+        parser.showHelp(1);
+    }
+
+    Database *database = Database::instance();
+    if (!database->initialize(positional.first())) {
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QSqlDatabase db = database->database();
+    QString errorMessage;
+    const bool ok = DataGenerator::generate(db, parser.value(entriesOption).toLongLong(),
+                                            parser.value(seedOption).toUInt(),
+                                            [](qint64 done, qint64 total) {
+        qInfo().noquote() << QString("%1 / %2 time entries").arg(done).arg(total);
+    }, &errorMessage, lastDay);
+    if (!ok) {
+        qCritical().noquote() << errorMessage;
+        return 1;
+    }
+    qInfo() << "Done in" << timer.elapsed() << "ms";
+    return 0;
+}